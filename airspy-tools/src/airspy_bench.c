@@ -0,0 +1,1705 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+ * Microbenchmarks of the host conversion path, linked against the library
+ * sources so that every SIMD level the CPU offers can be timed in turn.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <unistd.h>
+#endif
+
+#if defined(__linux__)
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/syscall.h>
+  #define HAVE_PERF_EVENT
+#endif
+
+#include "airspy.h"
+#include "cpu_features.h"
+#include "unpacker.h"
+#include "iqconverter_float.h"
+#include "iqconverter_int16.h"
+#include "decimator.h"
+#include "spsc_ring.h"
+#include "time_filter.h"
+
+#if defined(CPU_X86)
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #else
+    #include <x86intrin.h>
+  #endif
+  #define HAVE_TSC
+#endif
+
+#define AIRSPY_BENCH_VERSION "1.0.0"
+
+#ifndef bool
+typedef int bool;
+#define true 1
+#define false 0
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define MAX_LIST (16)
+#define MAX_SAMPLES (4 * 1024 * 1024)
+#define RING_BATCH (65536)
+#define RING_PACE_NS (5000)
+#define RING_TIMEOUT_MS (1000)
+#define CAPTURE_BYTES (4 * 1024 * 1024)
+#define SEARCH_STEPS (6)
+#define VERIFY_SAMPLES (16384)
+#define VERIFY_MAX_PARTS (5)
+/* The float converter sums its taps in a different order per ISA and fuses
+ * multiply-adds, so it is held to a bound against full scale, not to equality */
+#define VERIFY_FLOAT_TOLERANCE (1e-5f)
+
+/* History layouts of the float converter: before, a delay line of SIZE_FACTOR
+ * kernel lengths copied back on wrap, now a mirrored ring of FIR_RUN_SIZE runs */
+#define HISTORY_SIZE_FACTOR (32)
+#define HISTORY_RUN_SIZE (256)
+
+enum bench_kernel
+{
+	KERNEL_UNPACK,
+	KERNEL_CONVERT_FLOAT,
+	KERNEL_CONVERT_INT16,
+	KERNEL_UNPACK_FLOAT,
+	KERNEL_UNPACK_INT16,
+	KERNEL_IQ_FLOAT,
+	KERNEL_IQ_INT16,
+	KERNEL_DECIMATE_FLOAT,
+	KERNEL_DECIMATE_INT16,
+	KERNEL_HISTORY_COPY,
+	KERNEL_HISTORY_MIRROR,
+	KERNEL_RING,
+	KERNEL_RING_PACED,
+	KERNEL_RING_BURST,
+	KERNEL_COUNT
+};
+
+static const char* kernel_names[KERNEL_COUNT] =
+{
+	"unpack", "convert_float", "convert_int16", "unpack_float", "unpack_int16", "iq_float", "iq_int16", "decimate_float",
+	"decimate_int16", "history_copy", "history_mirror", "ring", "ring_paced", "ring_burst"
+};
+
+/* Bytes read per sample, for the bandwidth column */
+static const double kernel_input_bytes[KERNEL_COUNT] = { 1.5, 2.0, 2.0, 1.5, 1.5, 4.0, 2.0, 4.0, 2.0, 4.0, 4.0, 0.0, 0.0, 0.0 };
+
+/* Each level adds to the one before, the kernels bind the best variant of the mask */
+typedef struct
+{
+	const char* name;
+	uint32_t features;
+} isa_level_t;
+
+static const isa_level_t isa_levels[] =
+{
+	{ "scalar", 0 },
+#if defined(CPU_X86)
+	{ "sse2", CPU_FEATURE_SSE2 },
+	{ "ssse3", CPU_FEATURE_SSE2 | CPU_FEATURE_SSSE3 },
+	{ "sse41", CPU_FEATURE_SSE2 | CPU_FEATURE_SSSE3 | CPU_FEATURE_SSE41 },
+	{ "avx", CPU_FEATURE_SSE2 | CPU_FEATURE_SSSE3 | CPU_FEATURE_SSE41 | CPU_FEATURE_AVX },
+	{ "avx2", CPU_FEATURE_SSE2 | CPU_FEATURE_SSSE3 | CPU_FEATURE_SSE41 | CPU_FEATURE_AVX | CPU_FEATURE_AVX2 | CPU_FEATURE_FMA },
+	{ "avx512", CPU_FEATURE_SSE2 | CPU_FEATURE_SSSE3 | CPU_FEATURE_SSE41 | CPU_FEATURE_AVX | CPU_FEATURE_AVX2 | CPU_FEATURE_FMA |
+		CPU_FEATURE_AVX512F | CPU_FEATURE_AVX512BW },
+#endif
+#if defined(CPU_NEON)
+	{ "neon", CPU_FEATURE_NEON },
+#endif
+};
+
+#define ISA_LEVEL_COUNT ((int) (sizeof(isa_levels) / sizeof(isa_levels[0])))
+
+typedef struct
+{
+	double ns_per_sample;
+	double ticks_per_sample;
+	double latency_ns;
+	double l1d_misses_per_sample;
+} bench_result_t;
+
+/* The even sample FIR of the float converter on one of the two history layouts */
+typedef struct
+{
+	float* kernel;
+	float* queue;
+	int len;
+	int size;
+	int index;
+} history_fir_t;
+
+typedef struct
+{
+	uint32_t* packed;
+	uint16_t* words;
+	uint16_t* unpacked;
+	float* f32;
+	int16_t* i16;
+	float* f32_input;
+	int16_t* i16_input;
+	float* f32_split;
+	int16_t* i16_split;
+} bench_buffers_t;
+
+static const char* sample_type_names[AIRSPY_SAMPLE_END] =
+{
+	"float32_iq", "float32_real", "int16_iq", "int16_real", "uint16_real", "raw"
+};
+
+typedef struct
+{
+	uint64_t work_ns;
+} pipeline_ctx_t;
+
+/* One timed run of the host path at a given replay rate */
+typedef struct
+{
+	double adc_rate;
+	airspy_stream_stats_t stats;
+} pipeline_run_t;
+
+typedef struct
+{
+	uint64_t stamp;
+	uint32_t sequence;
+} ring_slot_t;
+
+typedef struct
+{
+	spsc_ring_t ring;
+	ring_slot_t* slots;
+	uint32_t count;
+	uint32_t received;
+	uint32_t errors;
+	uint32_t empty;
+	uint64_t latency_sum;
+} ring_bench_t;
+
+/*
+ * Outputs of every kernel, recorded on the scalar path and then compared with
+ * the same run on a SIMD level
+ */
+typedef struct
+{
+	uint8_t* reference;
+	size_t size;
+	size_t offset;
+	bool check;
+	const char* isa;
+	int failures;
+} verify_state_t;
+
+/* One part of a split conversion, filtered on its own thread */
+typedef struct
+{
+	iqconverter_float_t* cnv_f;
+	iqconverter_int16_t* cnv_i;
+	float* f32;
+	int16_t* i16;
+	int count;
+} split_part_t;
+
+/* A short buffer for the tails of the SIMD loops and one long enough to carry state across blocks */
+static const uint32_t verify_sizes[] = { 48, VERIFY_SAMPLES };
+/* Part counts for the split conversion check, 5 parts of 48 samples are uneven */
+static const int verify_parts[] = { 2, 3, VERIFY_MAX_PARTS };
+
+static uint64_t min_time_ns = 200000000ULL;
+static bool csv_output = false;
+static const char* capture_path = "airspy_bench.raw";
+static char lib_version[32];
+static int l1d_counter = -1;
+
+static uint64_t read_ticks(void)
+{
+#if defined(HAVE_TSC)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "airspy_bench v%s\n", AIRSPY_BENCH_VERSION);
+	fprintf(stderr, "Usage:\n");
+	fprintf(stderr, "[-k kernels]: Comma separated, default all:\n");
+	fprintf(stderr, " unpack,convert_float,convert_int16,unpack_float,unpack_int16,iq_float,iq_int16,\n");
+	fprintf(stderr, " decimate_float,decimate_int16,history_copy,history_mirror,ring,ring_paced,ring_burst\n");
+	fprintf(stderr, "[-s samples]: Samples per buffer, comma separated (default 16384,65536,262144)\n");
+	fprintf(stderr, "[-l lengths]: Half-band kernel lengths for iq_*, decimate_* and history_*, 4n+3\n");
+	fprintf(stderr, " (default 15,31,47,63,95,127)\n");
+	fprintf(stderr, "[-q slots]: Ring sizes for ring*, powers of two (default 8,64)\n");
+	fprintf(stderr, "[-i isa]: Only this SIMD level: scalar, sse2, ssse3, sse41, avx, avx2, avx512, neon, best\n");
+	fprintf(stderr, "[-t ms]: Minimum time per measurement (default 200)\n");
+	fprintf(stderr, "[-m]: Machine readable output, CSV with a header line\n");
+	fprintf(stderr, "[-V]: Only check every SIMD level against the scalar kernels, no timing\n");
+	fprintf(stderr, "[-P]: Pipeline mode, replays a synthetic capture through the whole host path and\n");
+	fprintf(stderr, " finds the highest ADC rate without drops for every sample type and packing\n");
+	fprintf(stderr, "[-w ns]: Pipeline mode, busy time spent in each sample callback (default 0)\n");
+	fprintf(stderr, "[-f path]: Pipeline mode, scratch capture file (default %s)\n", capture_path);
+	fprintf(stderr, "Each SIMD level is checked against the scalar kernels before it is timed, a mismatch\n");
+	fprintf(stderr, " skips the level and makes the exit status non-zero. Outputs must be identical, except\n");
+	fprintf(stderr, " iq_float which must stay within 1e-5 of full scale. The IQ converters of every level,\n");
+	fprintf(stderr, " scalar included, must also match themselves when split into parts on several threads.\n");
+	fprintf(stderr, "Times are the best call of the measurement. cycles are TSC ticks, x86 only.\n");
+	fprintf(stderr, "L1D are data cache read misses per sample over all calls, Linux perf events only.\n");
+}
+
+/* Comma separated unsigned values, returns how many or -1 */
+static int parse_list(char* s, uint32_t* values, int max)
+{
+	int count = 0;
+	char* end;
+	unsigned long value;
+
+	while (*s != 0)
+	{
+		if (count == max)
+		{
+			return -1;
+		}
+
+		value = strtoul(s, &end, 10);
+		if (end == s || (*end != ',' && *end != 0))
+		{
+			return -1;
+		}
+		values[count++] = (uint32_t) value;
+
+		s = *end == ',' ? end + 1 : end;
+	}
+
+	return count;
+}
+
+static int parse_kernels(char* s, bool* enabled)
+{
+	char* name;
+	int i;
+
+	memset(enabled, 0, KERNEL_COUNT * sizeof(bool));
+
+	for (name = strtok(s, ","); name != NULL; name = strtok(NULL, ","))
+	{
+		for (i = 0; i < KERNEL_COUNT && strcmp(name, kernel_names[i]) != 0; i++)
+		{
+		}
+
+		if (i == KERNEL_COUNT)
+		{
+			return -1;
+		}
+		enabled[i] = true;
+	}
+
+	return 0;
+}
+
+/* Windowed sinc half-band of len taps, every other tap zero apart from the center */
+static void make_halfband(float* kernel, int16_t* kernel_int16, int len)
+{
+	int i;
+	int n;
+	double window;
+	double value;
+
+	for (i = 0; i < len; i++)
+	{
+		n = i - len / 2;
+		window = 0.42 - 0.5 * cos(2.0 * M_PI * i / (len - 1)) + 0.08 * cos(4.0 * M_PI * i / (len - 1));
+		value = n == 0 ? 0.5 : (n % 2 == 0 ? 0.0 : sin(M_PI * n / 2.0) / (M_PI * n) * window);
+
+		kernel[i] = (float) value;
+		kernel_int16[i] = (int16_t) floor(value * 32768.0 + 0.5);
+	}
+}
+
+/* Per thread L1D read miss counter, -1 when perf events are not available */
+static int l1d_counter_open(void)
+{
+#if defined(HAVE_PERF_EVENT)
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+	return -1;
+#endif
+}
+
+static void l1d_counter_start(void)
+{
+#if defined(HAVE_PERF_EVENT)
+	if (l1d_counter >= 0)
+	{
+		ioctl(l1d_counter, PERF_EVENT_IOC_RESET, 0);
+		ioctl(l1d_counter, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+static uint64_t l1d_counter_stop(void)
+{
+	uint64_t misses = 0;
+
+#if defined(HAVE_PERF_EVENT)
+	if (l1d_counter >= 0)
+	{
+		ioctl(l1d_counter, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(l1d_counter, &misses, sizeof(misses)) != sizeof(misses))
+		{
+			misses = 0;
+		}
+	}
+#endif
+
+	return misses;
+}
+
+static history_fir_t* history_fir_create(const float* hb_kernel, int hb_len, bool mirrored)
+{
+	history_fir_t* fir;
+	int queue_size;
+	int i;
+
+	fir = (history_fir_t*) malloc(sizeof(history_fir_t));
+	if (fir == NULL)
+	{
+		return NULL;
+	}
+
+	fir->len = hb_len / 2 + 1;
+	fir->size = mirrored ? fir->len - 1 + HISTORY_RUN_SIZE : 0;
+	queue_size = mirrored ? fir->size * 2 : fir->len * HISTORY_SIZE_FACTOR;
+	fir->index = mirrored ? fir->size - 1 : fir->len * (HISTORY_SIZE_FACTOR - 1);
+	fir->kernel = (float*) malloc(fir->len * sizeof(float));
+	fir->queue = (float*) calloc(queue_size, sizeof(float));
+	if (fir->kernel == NULL || fir->queue == NULL)
+	{
+		free(fir->kernel);
+		free(fir->queue);
+		free(fir);
+		return NULL;
+	}
+
+	for (i = 0; i < fir->len; i++)
+	{
+		fir->kernel[i] = hb_kernel[i * 2];
+	}
+
+	return fir;
+}
+
+static void history_fir_free(history_fir_t* fir)
+{
+	free(fir->kernel);
+	free(fir->queue);
+	free(fir);
+}
+
+static void history_copy_process(history_fir_t* fir, float* samples, int len)
+{
+	int i, j;
+	int index = fir->index;
+	float* queue;
+	float acc;
+
+	for (i = 0; i < len; i += 2)
+	{
+		queue = fir->queue + index;
+		queue[0] = samples[i];
+
+		acc = 0.0f;
+		for (j = 0; j < fir->len; j++)
+		{
+			acc += fir->kernel[j] * queue[j];
+		}
+		samples[i] = acc;
+
+		if (--index < 0)
+		{
+			index = fir->len * (HISTORY_SIZE_FACTOR - 1);
+			memcpy(fir->queue + index + 1, fir->queue, (fir->len - 1) * sizeof(float));
+		}
+	}
+
+	fir->index = index;
+}
+
+static void history_mirror_process(history_fir_t* fir, float* samples, int len)
+{
+	int i, j;
+	int index = fir->index;
+	float* queue;
+	float acc;
+
+	for (i = 0; i < len; i += 2)
+	{
+		queue = fir->queue + index;
+		queue[0] = samples[i];
+		queue[fir->size] = samples[i];
+
+		acc = 0.0f;
+		for (j = 0; j < fir->len; j++)
+		{
+			acc += fir->kernel[j] * queue[j];
+		}
+		samples[i] = acc;
+
+		if (--index < 0)
+		{
+			index = fir->size - 1;
+		}
+	}
+
+	fir->index = index;
+}
+
+static void report_header(void)
+{
+	if (csv_output)
+	{
+		printf("kernel,isa,samples,taps,msps,ns_per_sample,cycles_per_sample,input_gbps,latency_ns,"
+			"l1d_misses_per_sample,version\n");
+	}
+	else
+	{
+		printf("%-14s %-7s %8s %5s %10s %10s %10s %8s %10s %8s\n",
+			"kernel", "isa", "samples", "taps", "MSPS", "ns/sample", "cyc/sample", "GB/s", "latency_ns", "L1D");
+	}
+}
+
+static void report(int kernel, const char* isa, uint32_t samples, uint32_t taps, const bench_result_t* result)
+{
+	double msps = 1e3 / result->ns_per_sample;
+	double gbps = kernel_input_bytes[kernel] / result->ns_per_sample;
+	char misses[32];
+
+	if (result->l1d_misses_per_sample < 0.0)
+	{
+		strcpy(misses, csv_output ? "" : "-");
+	}
+	else
+	{
+		sprintf(misses, "%.4f", result->l1d_misses_per_sample);
+	}
+
+	if (csv_output)
+	{
+		printf("%s,%s,%u,%u,%.3f,%.4f,%.4f,%.3f,%.1f,%s,%s\n", kernel_names[kernel], isa, samples, taps,
+			msps, result->ns_per_sample, result->ticks_per_sample, gbps, result->latency_ns, misses, lib_version);
+	}
+	else
+	{
+		printf("%-14s %-7s %8u %5u %10.2f %10.4f %10.4f %8.3f %10.1f %8s\n", kernel_names[kernel], isa, samples, taps,
+			msps, result->ns_per_sample, result->ticks_per_sample, gbps, result->latency_ns, misses);
+	}
+	fflush(stdout);
+}
+
+static void dsp_init_level(uint32_t features)
+{
+	unpacker_init(features);
+	iqconverter_float_init(features);
+	iqconverter_int16_init(features);
+	decimator_init(features);
+}
+
+static bool verify_matches(int kernel, const void* reference, const void* output, size_t bytes)
+{
+	const float* expected;
+	const float* actual;
+	size_t i;
+
+	if (kernel != KERNEL_IQ_FLOAT)
+	{
+		return memcmp(reference, output, bytes) == 0;
+	}
+
+	expected = (const float*) reference;
+	actual = (const float*) output;
+	for (i = 0; i < bytes / sizeof(float); i++)
+	{
+		if (!(fabsf(actual[i] - expected[i]) <= VERIFY_FLOAT_TOLERANCE))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void verify_output(verify_state_t* state, int kernel, uint32_t samples, uint32_t taps, const void* output, size_t bytes)
+{
+	if (!state->check)
+	{
+		if (state->offset + bytes > state->size)
+		{
+			state->size = (state->offset + bytes) * 2;
+			state->reference = (uint8_t*) realloc(state->reference, state->size);
+			if (state->reference == NULL)
+			{
+				fprintf(stderr, "out of memory\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+		memcpy(state->reference + state->offset, output, bytes);
+	}
+	else if (!verify_matches(kernel, state->reference + state->offset, output, bytes))
+	{
+		fprintf(stderr, "%s %s: %u samples, %u taps: output differs from scalar\n", kernel_names[kernel], state->isa,
+			samples, taps);
+		state->failures++;
+	}
+
+	state->offset += bytes;
+}
+
+static void* split_part_thread(void* arg)
+{
+	split_part_t* part = (split_part_t*)arg;
+
+	if (part->cnv_f != NULL)
+	{
+		iqconverter_float_filter(part->cnv_f, part->f32, part->count);
+	}
+	else
+	{
+		iqconverter_int16_filter(part->cnv_i, part->i16, part->count);
+	}
+	return NULL;
+}
+
+/* Filters the parts on their own threads, the first one on this thread */
+static void run_split_parts(split_part_t* parts, int part_count)
+{
+	pthread_t threads[VERIFY_MAX_PARTS];
+	bool started[VERIFY_MAX_PARTS];
+	int p;
+
+	for (p = 1; p < part_count; p++)
+	{
+		started[p] = pthread_create(&threads[p], NULL, split_part_thread, &parts[p]) == 0;
+		if (!started[p])
+		{
+			split_part_thread(&parts[p]);
+		}
+	}
+
+	split_part_thread(&parts[0]);
+
+	for (p = 1; p < part_count; p++)
+	{
+		if (started[p])
+		{
+			pthread_join(threads[p], NULL);
+		}
+	}
+}
+
+/* Even start of a part, the same rounding for every buffer size */
+static int split_start(uint32_t samples, int part, int part_count)
+{
+	return (int) ((uint64_t) samples * part / part_count) & ~1;
+}
+
+/*
+ * Runs two buffers through iqconverter_*_process() and through the split
+ * path that the conversion threads of the library use, and compares the two
+ * byte for byte. Returns the number of mismatching buffers.
+ */
+static int verify_split(const char* isa, bench_buffers_t* buffers, uint32_t samples, const float* kernel_float,
+	const int16_t* kernel_int16, int len, bool int16, int part_count)
+{
+	iqconverter_float_t* seq_f = NULL;
+	iqconverter_float_t* cnv_f = NULL;
+	iqconverter_int16_t* seq_i = NULL;
+	iqconverter_int16_t* cnv_i = NULL;
+	split_part_t parts[VERIFY_MAX_PARTS];
+	int failures = 0;
+	int start;
+	int p, call;
+
+	memset(parts, 0, sizeof(parts));
+
+	if (int16)
+	{
+		seq_i = iqconverter_int16_create(kernel_int16, len);
+		cnv_i = iqconverter_int16_create(kernel_int16, len);
+		for (p = 0; p < part_count; p++)
+		{
+			parts[p].cnv_i = iqconverter_int16_clone(cnv_i);
+		}
+	}
+	else
+	{
+		seq_f = iqconverter_float_create(kernel_float, len);
+		cnv_f = iqconverter_float_create(kernel_float, len);
+		for (p = 0; p < part_count; p++)
+		{
+			parts[p].cnv_f = iqconverter_float_clone(cnv_f);
+		}
+	}
+
+	for (call = 0; call < 2; call++)
+	{
+		if (int16)
+		{
+			memcpy(buffers->i16, buffers->i16_input, samples * sizeof(int16_t));
+			memcpy(buffers->i16_split, buffers->i16_input, samples * sizeof(int16_t));
+			iqconverter_int16_process(seq_i, buffers->i16, (int) samples);
+
+			iqconverter_int16_prepare(cnv_i, buffers->i16_split, (int) samples);
+			for (p = 0; p < part_count; p++)
+			{
+				start = split_start(samples, p, part_count);
+				iqconverter_int16_seek(parts[p].cnv_i, cnv_i, buffers->i16_split, start);
+				parts[p].i16 = buffers->i16_split + start;
+				parts[p].count = split_start(samples, p + 1, part_count) - start;
+			}
+			iqconverter_int16_seek(cnv_i, cnv_i, buffers->i16_split, (int) samples);
+		}
+		else
+		{
+			memcpy(buffers->f32, buffers->f32_input, samples * sizeof(float));
+			memcpy(buffers->f32_split, buffers->f32_input, samples * sizeof(float));
+			iqconverter_float_process(seq_f, buffers->f32, (int) samples);
+
+			iqconverter_float_prepare(cnv_f, buffers->f32_split, (int) samples);
+			for (p = 0; p < part_count; p++)
+			{
+				start = split_start(samples, p, part_count);
+				iqconverter_float_seek(parts[p].cnv_f, cnv_f, buffers->f32_split, start);
+				parts[p].f32 = buffers->f32_split + start;
+				parts[p].count = split_start(samples, p + 1, part_count) - start;
+			}
+			iqconverter_float_seek(cnv_f, cnv_f, buffers->f32_split, (int) samples);
+		}
+
+		run_split_parts(parts, part_count);
+
+		if (int16 ? memcmp(buffers->i16, buffers->i16_split, samples * sizeof(int16_t)) != 0 :
+			memcmp(buffers->f32, buffers->f32_split, samples * sizeof(float)) != 0)
+		{
+			fprintf(stderr, "%s %s: %u samples, %d taps, %d parts, buffer %d: split output differs from single threaded\n",
+				int16 ? kernel_names[KERNEL_IQ_INT16] : kernel_names[KERNEL_IQ_FLOAT], isa, samples, len, part_count, call);
+			failures++;
+		}
+	}
+
+	for (p = 0; p < part_count; p++)
+	{
+		if (int16)
+		{
+			iqconverter_int16_free(parts[p].cnv_i);
+		}
+		else
+		{
+			iqconverter_float_free(parts[p].cnv_f);
+		}
+	}
+	if (int16)
+	{
+		iqconverter_int16_free(seq_i);
+		iqconverter_int16_free(cnv_i);
+	}
+	else
+	{
+		iqconverter_float_free(seq_f);
+		iqconverter_float_free(cnv_f);
+	}
+
+	return failures;
+}
+
+/*
+ * The converters and decimators run two buffers in a row so that the state
+ * they carry is checked too. On the checked pass the IQ converters are also
+ * split into parts as the conversion threads do, and must match themselves.
+ */
+static void verify_kernels(verify_state_t* state, const bool* enabled, bench_buffers_t* buffers, const uint32_t* lengths, int length_count)
+{
+	float kernel_float[256];
+	int16_t kernel_int16[256];
+	iqconverter_float_t* cnv_f;
+	iqconverter_int16_t* cnv_i;
+	decimator_float_t* dec_f;
+	decimator_int16_t* dec_i;
+	uint32_t samples;
+	int count;
+	int i, j, call, part;
+
+	for (i = 0; i < (int) (sizeof(verify_sizes) / sizeof(verify_sizes[0])); i++)
+	{
+		samples = verify_sizes[i];
+
+		if (enabled[KERNEL_UNPACK])
+		{
+			unpack_samples(buffers->packed, buffers->unpacked, (int) samples);
+			verify_output(state, KERNEL_UNPACK, samples, 0, buffers->unpacked, samples * sizeof(uint16_t));
+		}
+		if (enabled[KERNEL_CONVERT_FLOAT])
+		{
+			convert_samples_float(buffers->words, buffers->f32, (int) samples);
+			verify_output(state, KERNEL_CONVERT_FLOAT, samples, 0, buffers->f32, samples * sizeof(float));
+		}
+		if (enabled[KERNEL_CONVERT_INT16])
+		{
+			convert_samples_int16(buffers->words, buffers->i16, (int) samples);
+			verify_output(state, KERNEL_CONVERT_INT16, samples, 0, buffers->i16, samples * sizeof(int16_t));
+		}
+		if (enabled[KERNEL_UNPACK_FLOAT])
+		{
+			unpack_samples_float(buffers->packed, buffers->f32, (int) samples);
+			verify_output(state, KERNEL_UNPACK_FLOAT, samples, 0, buffers->f32, samples * sizeof(float));
+		}
+		if (enabled[KERNEL_UNPACK_INT16])
+		{
+			unpack_samples_int16(buffers->packed, buffers->i16, (int) samples);
+			verify_output(state, KERNEL_UNPACK_INT16, samples, 0, buffers->i16, samples * sizeof(int16_t));
+		}
+
+		for (j = 0; j < length_count; j++)
+		{
+			make_halfband(kernel_float, kernel_int16, (int) lengths[j]);
+
+			if (enabled[KERNEL_IQ_FLOAT])
+			{
+				cnv_f = iqconverter_float_create(kernel_float, (int) lengths[j]);
+				for (call = 0; call < 2; call++)
+				{
+					memcpy(buffers->f32, buffers->f32_input, samples * sizeof(float));
+					iqconverter_float_process(cnv_f, buffers->f32, (int) samples);
+					verify_output(state, KERNEL_IQ_FLOAT, samples, lengths[j], buffers->f32, samples * sizeof(float));
+				}
+				iqconverter_float_free(cnv_f);
+
+				for (part = 0; state->check && part < (int) (sizeof(verify_parts) / sizeof(verify_parts[0])); part++)
+				{
+					state->failures += verify_split(state->isa, buffers, samples, kernel_float, kernel_int16,
+						(int) lengths[j], false, verify_parts[part]);
+				}
+			}
+
+			if (enabled[KERNEL_IQ_INT16])
+			{
+				cnv_i = iqconverter_int16_create(kernel_int16, (int) lengths[j]);
+				for (call = 0; call < 2; call++)
+				{
+					memcpy(buffers->i16, buffers->i16_input, samples * sizeof(int16_t));
+					iqconverter_int16_process(cnv_i, buffers->i16, (int) samples);
+					verify_output(state, KERNEL_IQ_INT16, samples, lengths[j], buffers->i16, samples * sizeof(int16_t));
+				}
+				iqconverter_int16_free(cnv_i);
+
+				for (part = 0; state->check && part < (int) (sizeof(verify_parts) / sizeof(verify_parts[0])); part++)
+				{
+					state->failures += verify_split(state->isa, buffers, samples, kernel_float, kernel_int16,
+						(int) lengths[j], true, verify_parts[part]);
+				}
+			}
+
+			if (enabled[KERNEL_DECIMATE_FLOAT])
+			{
+				dec_f = decimator_float_create(1, kernel_float, (int) lengths[j], kernel_float, (int) lengths[j]);
+				for (call = 0; call < 2; call++)
+				{
+					memcpy(buffers->f32, buffers->f32_input, samples * sizeof(float));
+					count = decimator_float_process(dec_f, buffers->f32, (int) samples / 2);
+					verify_output(state, KERNEL_DECIMATE_FLOAT, samples, lengths[j], buffers->f32, count * 2 * sizeof(float));
+				}
+				decimator_float_free(dec_f);
+			}
+
+			if (enabled[KERNEL_DECIMATE_INT16])
+			{
+				dec_i = decimator_int16_create(1, kernel_int16, (int) lengths[j], kernel_int16, (int) lengths[j]);
+				for (call = 0; call < 2; call++)
+				{
+					memcpy(buffers->i16, buffers->i16_input, samples * sizeof(int16_t));
+					count = decimator_int16_process(dec_i, buffers->i16, (int) samples / 2);
+					verify_output(state, KERNEL_DECIMATE_INT16, samples, lengths[j], buffers->i16, count * 2 * sizeof(int16_t));
+				}
+				decimator_int16_free(dec_i);
+			}
+		}
+	}
+}
+
+/* Returns the number of mismatches and leaves the kernels of the level selected */
+static int verify_level(const isa_level_t* level, const bool* enabled, bench_buffers_t* buffers, const uint32_t* lengths, int length_count)
+{
+	verify_state_t state;
+
+	memset(&state, 0, sizeof(state));
+	state.isa = level->name;
+
+	dsp_init_level(0);
+	verify_kernels(&state, enabled, buffers, lengths, length_count);
+
+	state.check = true;
+	state.offset = 0;
+	dsp_init_level(level->features);
+	verify_kernels(&state, enabled, buffers, lengths, length_count);
+
+	free(state.reference);
+
+	return state.failures;
+}
+
+/*
+ * Times single calls until min_time_ns has passed and keeps the fastest, so
+ * that preemption and frequency ramps do not show up in the result. The in
+ * place converters get a fresh copy of the input before every call, untimed.
+ */
+static void run_kernel(int kernel, bench_buffers_t* buffers, uint32_t samples, void* cnv, bench_result_t* result)
+{
+	uint64_t start_ns;
+	uint64_t end_ns;
+	uint64_t start_ticks;
+	uint64_t end_ticks;
+	uint64_t total_ns = 0;
+	uint64_t best_ns = UINT64_MAX;
+	uint64_t best_ticks = 0;
+	uint64_t misses;
+	uint64_t total_misses = 0;
+	int calls = 0;
+
+	while (calls < 3 || total_ns < min_time_ns)
+	{
+		if (kernel == KERNEL_IQ_FLOAT || kernel == KERNEL_DECIMATE_FLOAT ||
+			kernel == KERNEL_HISTORY_COPY || kernel == KERNEL_HISTORY_MIRROR)
+		{
+			memcpy(buffers->f32, buffers->f32_input, samples * sizeof(float));
+		}
+		else if (kernel == KERNEL_IQ_INT16 || kernel == KERNEL_DECIMATE_INT16)
+		{
+			memcpy(buffers->i16, buffers->i16_input, samples * sizeof(int16_t));
+		}
+
+		l1d_counter_start();
+		start_ns = time_monotonic_ns();
+		start_ticks = read_ticks();
+
+		switch (kernel)
+		{
+		case KERNEL_UNPACK:
+			unpack_samples(buffers->packed, buffers->words, (int) samples);
+			break;
+		case KERNEL_CONVERT_FLOAT:
+			convert_samples_float(buffers->words, buffers->f32, (int) samples);
+			break;
+		case KERNEL_CONVERT_INT16:
+			convert_samples_int16(buffers->words, buffers->i16, (int) samples);
+			break;
+		case KERNEL_UNPACK_FLOAT:
+			unpack_samples_float(buffers->packed, buffers->f32, (int) samples);
+			break;
+		case KERNEL_UNPACK_INT16:
+			unpack_samples_int16(buffers->packed, buffers->i16, (int) samples);
+			break;
+		case KERNEL_IQ_FLOAT:
+			iqconverter_float_process((iqconverter_float_t*) cnv, buffers->f32, (int) samples);
+			break;
+		case KERNEL_IQ_INT16:
+			iqconverter_int16_process((iqconverter_int16_t*) cnv, buffers->i16, (int) samples);
+			break;
+		case KERNEL_DECIMATE_FLOAT:
+			decimator_float_process((decimator_float_t*) cnv, buffers->f32, (int) samples / 2);
+			break;
+		case KERNEL_DECIMATE_INT16:
+			decimator_int16_process((decimator_int16_t*) cnv, buffers->i16, (int) samples / 2);
+			break;
+		case KERNEL_HISTORY_COPY:
+			history_copy_process((history_fir_t*) cnv, buffers->f32, (int) samples);
+			break;
+		case KERNEL_HISTORY_MIRROR:
+			history_mirror_process((history_fir_t*) cnv, buffers->f32, (int) samples);
+			break;
+		}
+
+		end_ticks = read_ticks();
+		end_ns = time_monotonic_ns();
+		misses = l1d_counter_stop();
+
+		/* The first call warms the caches and is not counted */
+		if (calls++ == 0)
+		{
+			continue;
+		}
+
+		total_ns += end_ns - start_ns;
+		total_misses += misses;
+		if (end_ns - start_ns < best_ns)
+		{
+			best_ns = end_ns - start_ns;
+			best_ticks = end_ticks - start_ticks;
+		}
+	}
+
+	result->ns_per_sample = (double) best_ns / samples;
+	result->ticks_per_sample = (double) best_ticks / samples;
+	result->latency_ns = 0.0;
+	result->l1d_misses_per_sample = l1d_counter >= 0 ? (double) total_misses / ((double) (calls - 1) * samples) : -1.0;
+}
+
+/*
+ * Every slot carries the sequence number the producer gave it, so a lost,
+ * repeated or reordered hand-off shows as a mismatch. A wait that times out
+ * is a lost wake up.
+ */
+static void* ring_consumer(void* arg)
+{
+	ring_bench_t* bench = (ring_bench_t*)arg;
+	struct timespec deadline;
+	uint32_t i;
+	int slot;
+
+	for (i = 0; i < bench->count; i++)
+	{
+		slot = spsc_ring_peek(&bench->ring);
+		if (slot < 0)
+		{
+			bench->empty++;
+			spsc_ring_deadline(&deadline, RING_TIMEOUT_MS);
+			slot = spsc_ring_wait(&bench->ring, &deadline);
+			if (slot < 0)
+			{
+				break;
+			}
+		}
+
+		if (bench->slots[slot].sequence != i)
+		{
+			bench->errors++;
+		}
+
+		bench->latency_sum += time_monotonic_ns() - bench->slots[slot].stamp;
+		bench->received++;
+		spsc_ring_release(&bench->ring);
+	}
+
+	return NULL;
+}
+
+/*
+ * The USB callback to consumer hand-off: one thread publishes stamped slots,
+ * the other waits for them the way the consumer thread does. ring publishes
+ * as fast as the ring takes them, ring_paced one slot every RING_PACE_NS and
+ * ring_burst a full ring at once at the same mean rate, so that the consumer
+ * runs dry and parks. Reports the cost of a hand-off and the mean publish to
+ * wake up latency; returns -1 when a hand-off went missing or out of order.
+ */
+static int run_ring(int kernel, uint32_t slots, bench_result_t* result)
+{
+	ring_bench_t bench;
+	pthread_t consumer;
+	uint64_t start_ns;
+	uint64_t next_ns;
+	uint64_t elapsed_ns = 0;
+	uint64_t handoffs = 0;
+	uint64_t latency_sum = 0;
+	uint64_t empty = 0;
+	uint32_t i;
+	int slot;
+	int failed = 0;
+
+	if (spsc_ring_init(&bench.ring, slots) != 0)
+	{
+		fprintf(stderr, "%s: ring sizes must be powers of two\n", kernel_names[kernel]);
+		return -1;
+	}
+
+	bench.slots = (ring_slot_t*) calloc(slots, sizeof(ring_slot_t));
+	if (bench.slots == NULL)
+	{
+		fprintf(stderr, "%s: out of memory\n", kernel_names[kernel]);
+		spsc_ring_destroy(&bench.ring);
+		return -1;
+	}
+	bench.count = RING_BATCH;
+
+	while (!failed && elapsed_ns < min_time_ns)
+	{
+		spsc_ring_reset(&bench.ring);
+		bench.received = 0;
+		bench.errors = 0;
+		bench.empty = 0;
+		bench.latency_sum = 0;
+
+		start_ns = time_monotonic_ns();
+		if (pthread_create(&consumer, NULL, ring_consumer, &bench) != 0)
+		{
+			fprintf(stderr, "%s: cannot start the consumer thread\n", kernel_names[kernel]);
+			failed = 1;
+			break;
+		}
+
+		next_ns = start_ns;
+		for (i = 0; i < bench.count; i++)
+		{
+			if (kernel == KERNEL_RING_PACED || (kernel == KERNEL_RING_BURST && (i & (slots - 1)) == 0))
+			{
+				while (time_monotonic_ns() < next_ns)
+				{
+				}
+				next_ns += kernel == KERNEL_RING_PACED ? RING_PACE_NS : (uint64_t) RING_PACE_NS * slots;
+			}
+
+			while ((slot = spsc_ring_acquire(&bench.ring)) < 0)
+			{
+			}
+			bench.slots[slot].sequence = i;
+			bench.slots[slot].stamp = time_monotonic_ns();
+			spsc_ring_publish(&bench.ring);
+		}
+
+		pthread_join(consumer, NULL);
+		elapsed_ns += time_monotonic_ns() - start_ns;
+		handoffs += bench.count;
+		latency_sum += bench.latency_sum;
+		empty += bench.empty;
+
+		if (bench.received != bench.count || bench.errors != 0)
+		{
+			fprintf(stderr, "%s: %u slots, %u of %u hand-offs received, %u out of sequence\n", kernel_names[kernel],
+				slots, bench.received, bench.count, bench.errors);
+			failed = 1;
+		}
+	}
+
+	if (!failed && kernel != KERNEL_RING && empty == 0)
+	{
+		fprintf(stderr, "%s: %u slots, the consumer never ran dry, the wake up path was not exercised\n",
+			kernel_names[kernel], slots);
+	}
+
+	result->ns_per_sample = handoffs != 0 ? (double) elapsed_ns / handoffs : 0.0;
+	result->ticks_per_sample = 0.0;
+	result->latency_ns = handoffs != 0 ? (double) latency_sum / handoffs : 0.0;
+	result->l1d_misses_per_sample = -1.0;
+
+	free(bench.slots);
+	spsc_ring_destroy(&bench.ring);
+
+	return failed ? -1 : 0;
+}
+
+static void* alloc_buffer(size_t size)
+{
+	void* buffer = malloc(size);
+
+	if (buffer == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	return buffer;
+}
+
+static void sleep_ms(int ms)
+{
+#ifdef _WIN32
+	Sleep(ms);
+#else
+	usleep(ms * 1000);
+#endif
+}
+
+/* Random 12 bit words, or the same amount of random packed data */
+static int write_capture(const char* path)
+{
+	FILE* file;
+	uint16_t* data;
+	int i;
+	size_t written;
+
+	data = (uint16_t*) alloc_buffer(CAPTURE_BYTES);
+	for (i = 0; i < CAPTURE_BYTES / 2; i++)
+	{
+		data[i] = (uint16_t) (rand() & 0xfff);
+	}
+
+	file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		free(data);
+		return -1;
+	}
+
+	written = fwrite(data, 1, CAPTURE_BYTES, file);
+	fclose(file);
+	free(data);
+
+	return written == CAPTURE_BYTES ? 0 : -1;
+}
+
+static int pipeline_callback(airspy_transfer_t* transfer)
+{
+	pipeline_ctx_t* ctx = (pipeline_ctx_t*)transfer->ctx;
+	uint64_t end_ns;
+
+	if (ctx->work_ns != 0)
+	{
+		end_ns = time_monotonic_ns() + ctx->work_ns;
+		while (time_monotonic_ns() < end_ns)
+		{
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Streams for min_time_ns at adc_rate words per second, 0 unpaced, and
+ * reports the rate the consumer actually delivered.
+ */
+static int run_pipeline(struct airspy_device* device, pipeline_ctx_t* ctx, uint32_t adc_rate, uint32_t buffer_words, pipeline_run_t* run)
+{
+	uint64_t start_ns;
+	uint64_t elapsed_ns;
+	int streaming;
+	int result;
+
+	airspy_set_replay_rate(device, adc_rate);
+
+	start_ns = time_monotonic_ns();
+	result = airspy_start_rx(device, pipeline_callback, ctx);
+	if (result != AIRSPY_SUCCESS)
+	{
+		return result;
+	}
+
+	while (time_monotonic_ns() - start_ns < min_time_ns && airspy_is_streaming(device) == AIRSPY_TRUE)
+	{
+		sleep_ms(10);
+	}
+
+	streaming = airspy_is_streaming(device);
+	airspy_get_stream_stats(device, &run->stats);
+	elapsed_ns = time_monotonic_ns() - start_ns;
+	airspy_stop_rx(device);
+
+	/* A replay that stopped on its own ran short, its stats are not comparable */
+	if (streaming != AIRSPY_TRUE)
+	{
+		return AIRSPY_ERROR_STREAMING_STOPPED;
+	}
+
+	run->adc_rate = (double) run->stats.buffers_delivered * buffer_words * 1e9 / elapsed_ns;
+
+	return AIRSPY_SUCCESS;
+}
+
+static double mean_ns(const airspy_timing_stats_t* timing)
+{
+	return timing->count != 0 ? (double) timing->total_ns / timing->count : 0.0;
+}
+
+static void report_pipeline_header(void)
+{
+	if (csv_output)
+	{
+		printf("sample_type,packing,unpaced_msps,threshold_msps,completion_ns,conversion_ns,conversion_p99_ns,"
+			"callback_ns,buffer_period_ns,queue_high_water,version\n");
+	}
+	else
+	{
+		printf("%-12s %4s %9s %9s %10s %10s %10s %10s %10s %5s\n", "sample_type", "pack", "unpaced", "threshold",
+			"complet_ns", "convert_ns", "conv_p99", "callbk_ns", "period_ns", "queue");
+	}
+}
+
+/*
+ * The time columns are per USB buffer at the threshold rate; their sum against
+ * the buffer period shows how much headroom the consumer thread has left.
+ */
+static void report_pipeline(int sample_type, int packing, double unpaced, uint32_t threshold, const pipeline_run_t* run, uint32_t buffer_words)
+{
+	double period_ns = threshold != 0 ? buffer_words * 1e9 / threshold : 0.0;
+
+	if (csv_output)
+	{
+		printf("%s,%d,%.3f,%.3f,%.0f,%.0f,%llu,%.0f,%.0f,%u,%s\n", sample_type_names[sample_type], packing,
+			unpaced * 1e-6, threshold * 1e-6, mean_ns(&run->stats.completion), mean_ns(&run->stats.conversion),
+			(unsigned long long) run->stats.conversion.p99_ns, mean_ns(&run->stats.callback), period_ns,
+			run->stats.queue_high_water, lib_version);
+	}
+	else
+	{
+		printf("%-12s %4d %9.2f %9.2f %10.0f %10.0f %10llu %10.0f %10.0f %5u\n", sample_type_names[sample_type], packing,
+			unpaced * 1e-6, threshold * 1e-6, mean_ns(&run->stats.completion), mean_ns(&run->stats.conversion),
+			(unsigned long long) run->stats.conversion.p99_ns, mean_ns(&run->stats.callback), period_ns,
+			run->stats.queue_high_water);
+	}
+	fflush(stdout);
+}
+
+/*
+ * Replays a synthetic capture through the USB callback, queue, consumer and
+ * converters with the file device. An unpaced run gives the rate the consumer
+ * keeps up with at best, then a bisection of paced runs finds the highest
+ * ADC rate that streams for min_time_ns without a dropped buffer.
+ */
+static int run_pipeline_mode(uint64_t work_ns)
+{
+	struct airspy_device* device;
+	airspy_stream_config_t config;
+	pipeline_ctx_t ctx;
+	pipeline_run_t run;
+	pipeline_run_t best;
+	uint32_t low, high, rate;
+	uint32_t buffer_words;
+	double unpaced;
+	double limit;
+	int packing, sample_type, step;
+	int result;
+
+	ctx.work_ns = work_ns;
+
+	if (write_capture(capture_path) != 0)
+	{
+		fprintf(stderr, "cannot write %s\n", capture_path);
+		return EXIT_FAILURE;
+	}
+
+	report_pipeline_header();
+
+	for (packing = 0; packing < 2; packing++)
+	{
+		for (sample_type = 0; sample_type < AIRSPY_SAMPLE_END; sample_type++)
+		{
+			result = airspy_open_file(&device, capture_path, AIRSPY_FILE_LOOP | (packing ? AIRSPY_FILE_PACKED : 0));
+			if (result != AIRSPY_SUCCESS)
+			{
+				fprintf(stderr, "airspy_open_file() failed: %s (%d)\n", airspy_error_name(result), result);
+				remove(capture_path);
+				return EXIT_FAILURE;
+			}
+
+			airspy_set_sample_type(device, (enum airspy_sample_type) sample_type);
+			airspy_get_stream_config(device, &config);
+			buffer_words = packing ? config.buffer_size / 2 * 4 / 3 : config.buffer_size / 2;
+
+			/* Paced at the largest rate a replay can ask for, effectively unpaced */
+			result = run_pipeline(device, &ctx, UINT32_MAX, buffer_words, &run);
+			unpaced = result == AIRSPY_SUCCESS ? run.adc_rate : 0.0;
+			memset(&best, 0, sizeof(best));
+
+			/* The replay rate is a uint32_t, the unpaced rate can be above it */
+			low = 0;
+			limit = unpaced * 1.25;
+			high = limit < (double) UINT32_MAX ? (uint32_t) limit : UINT32_MAX;
+			for (step = 0; result == AIRSPY_SUCCESS && step < SEARCH_STEPS; step++)
+			{
+				rate = low + (high - low) / 2;
+				result = run_pipeline(device, &ctx, rate, buffer_words, &run);
+				if (result != AIRSPY_SUCCESS)
+				{
+					break;
+				}
+
+				if (run.stats.buffers_dropped == 0)
+				{
+					low = rate;
+					best = run;
+				}
+				else
+				{
+					high = rate;
+				}
+			}
+
+			airspy_close(device);
+
+			if (result != AIRSPY_SUCCESS)
+			{
+				fprintf(stderr, "%s %s: replay failed: %s (%d)\n", sample_type_names[sample_type],
+					packing ? "packed" : "unpacked", airspy_error_name(result), result);
+				remove(capture_path);
+				return EXIT_FAILURE;
+			}
+
+			report_pipeline(sample_type, packing, unpaced, low, &best, buffer_words);
+		}
+	}
+
+	remove(capture_path);
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	int i, j, k, level;
+	int size_count = 3;
+	int length_count = 6;
+	int slot_count = 2;
+	int exit_code = EXIT_SUCCESS;
+	uint32_t sizes[MAX_LIST] = { 16384, 65536, 262144 };
+	uint32_t lengths[MAX_LIST] = { 15, 31, 47, 63, 95, 127 };
+	uint32_t slots[MAX_LIST] = { 8, 64 };
+	uint32_t max_samples = 0;
+	uint32_t value;
+	uint32_t host_features;
+	const char* isa = NULL;
+	bool pipeline_mode = false;
+	bool verify_only = false;
+	uint64_t work_ns = 0;
+	bool enabled[KERNEL_COUNT];
+	bench_buffers_t buffers;
+	bench_result_t result;
+	airspy_lib_version_t version;
+	float kernel_float[256];
+	int16_t kernel_int16[256];
+	iqconverter_float_t* cnv_f;
+	iqconverter_int16_t* cnv_i;
+	decimator_float_t* dec_f;
+	decimator_int16_t* dec_i;
+	history_fir_t* history;
+
+	for (i = 0; i < KERNEL_COUNT; i++)
+	{
+		enabled[i] = true;
+	}
+
+	while ((opt = getopt(argc, argv, "k:s:l:q:i:t:mVPw:f:")) != EOF)
+	{
+		switch (opt)
+		{
+		case 'k':
+			if (parse_kernels(optarg, enabled) != 0)
+			{
+				fprintf(stderr, "argument error: unknown kernel in '%s'\n", optarg);
+				usage();
+				return EXIT_FAILURE;
+			}
+			break;
+
+		case 's':
+			size_count = parse_list(optarg, sizes, MAX_LIST);
+			break;
+
+		case 'l':
+			length_count = parse_list(optarg, lengths, MAX_LIST);
+			break;
+
+		case 'q':
+			slot_count = parse_list(optarg, slots, MAX_LIST);
+			break;
+
+		case 'i':
+			isa = optarg;
+			break;
+
+		case 't':
+			if (parse_list(optarg, &value, 1) != 1 || value == 0)
+			{
+				usage();
+				return EXIT_FAILURE;
+			}
+			min_time_ns = (uint64_t) value * 1000000ULL;
+			break;
+
+		case 'm':
+			csv_output = true;
+			break;
+
+		case 'V':
+			verify_only = true;
+			break;
+
+		case 'P':
+			pipeline_mode = true;
+			break;
+
+		case 'w':
+			if (parse_list(optarg, &value, 1) != 1)
+			{
+				usage();
+				return EXIT_FAILURE;
+			}
+			work_ns = value;
+			break;
+
+		case 'f':
+			capture_path = optarg;
+			break;
+
+		default:
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (size_count <= 0 || length_count <= 0 || slot_count <= 0)
+	{
+		fprintf(stderr, "argument error: bad list\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	/* The packed kernels work in groups of 8 samples, the converters in pairs of IQ groups */
+	for (i = 0; i < size_count; i++)
+	{
+		if (sizes[i] == 0 || sizes[i] % 16 != 0 || sizes[i] > MAX_SAMPLES)
+		{
+			fprintf(stderr, "argument error: samples must be a multiple of 16 up to %d\n", MAX_SAMPLES);
+			return EXIT_FAILURE;
+		}
+		if (sizes[i] > max_samples)
+		{
+			max_samples = sizes[i];
+		}
+	}
+
+	for (i = 0; i < length_count; i++)
+	{
+		if (lengths[i] < 7 || lengths[i] > 255 || lengths[i] % 4 != 3)
+		{
+			fprintf(stderr, "argument error: kernel lengths must be 4n+3 between 7 and 255\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	for (i = 0; i < slot_count; i++)
+	{
+		if (slots[i] == 0 || (slots[i] & (slots[i] - 1)) != 0)
+		{
+			fprintf(stderr, "argument error: ring sizes must be powers of two\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	airspy_lib_version(&version);
+	sprintf(lib_version, "%u.%u.%u", version.major_version, version.minor_version, version.revision);
+	host_features = cpu_features_get();
+	l1d_counter = l1d_counter_open();
+
+	if (!csv_output)
+	{
+		printf("airspy_bench v%s, libairspy %s, cpu features 0x%x%s\n", AIRSPY_BENCH_VERSION, lib_version, host_features,
+			l1d_counter < 0 && !pipeline_mode ? ", no L1D miss counter" : "");
+	}
+
+	if (pipeline_mode)
+	{
+		return run_pipeline_mode(work_ns);
+	}
+
+	if (max_samples < VERIFY_SAMPLES)
+	{
+		max_samples = VERIFY_SAMPLES;
+	}
+
+	buffers.packed = (uint32_t*) alloc_buffer((size_t) max_samples / 8 * 3 * sizeof(uint32_t));
+	buffers.words = (uint16_t*) alloc_buffer((size_t) max_samples * sizeof(uint16_t));
+	buffers.unpacked = (uint16_t*) alloc_buffer((size_t) max_samples * sizeof(uint16_t));
+	buffers.f32 = (float*) alloc_buffer((size_t) max_samples * sizeof(float));
+	buffers.i16 = (int16_t*) alloc_buffer((size_t) max_samples * sizeof(int16_t));
+	buffers.f32_input = (float*) alloc_buffer((size_t) max_samples * sizeof(float));
+	buffers.i16_input = (int16_t*) alloc_buffer((size_t) max_samples * sizeof(int16_t));
+	buffers.f32_split = (float*) alloc_buffer(VERIFY_SAMPLES * sizeof(float));
+	buffers.i16_split = (int16_t*) alloc_buffer(VERIFY_SAMPLES * sizeof(int16_t));
+
+	/* ADC like input: a tone plus noise around mid scale */
+	srand(1);
+	for (i = 0; i < (int) max_samples; i++)
+	{
+		buffers.words[i] = (uint16_t) (2048 + (int) (1500.0 * sin(i * 0.01)) + rand() % 64 - 32);
+	}
+	for (i = 0; i < (int) (max_samples / 8 * 3); i++)
+	{
+		buffers.packed[i] = ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+	}
+	convert_samples_float_scalar(buffers.words, buffers.f32_input, (int) max_samples);
+	convert_samples_int16_scalar(buffers.words, buffers.i16_input, (int) max_samples);
+
+	if (!verify_only)
+	{
+		report_header();
+	}
+
+	for (level = 0; level < ISA_LEVEL_COUNT; level++)
+	{
+		if ((isa_levels[level].features & host_features) != isa_levels[level].features)
+		{
+			continue;
+		}
+
+		if (isa != NULL && strcmp(isa, isa_levels[level].name) != 0 &&
+			!(strcmp(isa, "best") == 0 && (level + 1 == ISA_LEVEL_COUNT ||
+			(isa_levels[level + 1].features & host_features) != isa_levels[level + 1].features)))
+		{
+			continue;
+		}
+
+		if (verify_level(&isa_levels[level], enabled, &buffers, lengths, length_count) != 0)
+		{
+			exit_code = EXIT_FAILURE;
+			continue;
+		}
+
+		dsp_init_level(isa_levels[level].features);
+
+		if (verify_only)
+		{
+			if (!csv_output)
+			{
+				printf("%s: %s\n", isa_levels[level].name, isa_levels[level].features != 0 ? "matches scalar" : "reference");
+			}
+			continue;
+		}
+
+		for (k = 0; k < KERNEL_IQ_FLOAT; k++)
+		{
+			for (i = 0; enabled[k] && i < size_count; i++)
+			{
+				run_kernel(k, &buffers, sizes[i], NULL, &result);
+				report(k, isa_levels[level].name, sizes[i], 0, &result);
+			}
+		}
+
+		/* Kernel length sets the FIR history footprint, the cache behaviour shows across buffer sizes */
+		for (j = 0; j < length_count; j++)
+		{
+			make_halfband(kernel_float, kernel_int16, (int) lengths[j]);
+
+			for (i = 0; enabled[KERNEL_IQ_FLOAT] && i < size_count; i++)
+			{
+				cnv_f = iqconverter_float_create(kernel_float, (int) lengths[j]);
+				run_kernel(KERNEL_IQ_FLOAT, &buffers, sizes[i], cnv_f, &result);
+				iqconverter_float_free(cnv_f);
+				report(KERNEL_IQ_FLOAT, isa_levels[level].name, sizes[i], lengths[j], &result);
+			}
+
+			for (i = 0; enabled[KERNEL_IQ_INT16] && i < size_count; i++)
+			{
+				cnv_i = iqconverter_int16_create(kernel_int16, (int) lengths[j]);
+				run_kernel(KERNEL_IQ_INT16, &buffers, sizes[i], cnv_i, &result);
+				iqconverter_int16_free(cnv_i);
+				report(KERNEL_IQ_INT16, isa_levels[level].name, sizes[i], lengths[j], &result);
+			}
+
+			/* One decimate by 2 stage, samples counts the interleaved input values */
+			for (i = 0; enabled[KERNEL_DECIMATE_FLOAT] && i < size_count; i++)
+			{
+				dec_f = decimator_float_create(1, kernel_float, (int) lengths[j], kernel_float, (int) lengths[j]);
+				run_kernel(KERNEL_DECIMATE_FLOAT, &buffers, sizes[i], dec_f, &result);
+				decimator_float_free(dec_f);
+				report(KERNEL_DECIMATE_FLOAT, isa_levels[level].name, sizes[i], lengths[j], &result);
+			}
+
+			for (i = 0; enabled[KERNEL_DECIMATE_INT16] && i < size_count; i++)
+			{
+				dec_i = decimator_int16_create(1, kernel_int16, (int) lengths[j], kernel_int16, (int) lengths[j]);
+				run_kernel(KERNEL_DECIMATE_INT16, &buffers, sizes[i], dec_i, &result);
+				decimator_int16_free(dec_i);
+				report(KERNEL_DECIMATE_INT16, isa_levels[level].name, sizes[i], lengths[j], &result);
+			}
+		}
+	}
+
+	/*
+	 * Same scalar FIR on both history layouts, so that only the footprint and
+	 * the copy on wrap differ between the two
+	 */
+	for (j = 0; !verify_only && exit_code == EXIT_SUCCESS && j < length_count; j++)
+	{
+		make_halfband(kernel_float, kernel_int16, (int) lengths[j]);
+
+		for (k = KERNEL_HISTORY_COPY; k <= KERNEL_HISTORY_MIRROR; k++)
+		{
+			for (i = 0; enabled[k] && i < size_count; i++)
+			{
+				history = history_fir_create(kernel_float, (int) lengths[j], k == KERNEL_HISTORY_MIRROR);
+				if (history == NULL)
+				{
+					fprintf(stderr, "%s: out of memory\n", kernel_names[k]);
+					exit_code = EXIT_FAILURE;
+					break;
+				}
+				run_kernel(k, &buffers, sizes[i], history, &result);
+				history_fir_free(history);
+				report(k, "scalar", sizes[i], lengths[j], &result);
+			}
+		}
+	}
+
+	for (k = KERNEL_RING; !verify_only && exit_code == EXIT_SUCCESS && k <= KERNEL_RING_BURST; k++)
+	{
+		for (i = 0; enabled[k] && i < slot_count; i++)
+		{
+			if (run_ring(k, slots[i], &result) != 0)
+			{
+				exit_code = EXIT_FAILURE;
+				break;
+			}
+			report(k, "-", slots[i], 0, &result);
+		}
+	}
+
+	free(buffers.packed);
+	free(buffers.words);
+	free(buffers.unpacked);
+	free(buffers.f32);
+	free(buffers.i16);
+	free(buffers.f32_input);
+	free(buffers.i16_input);
+	free(buffers.f32_split);
+	free(buffers.i16_split);
+
+#if defined(HAVE_PERF_EVENT)
+	if (l1d_counter >= 0)
+	{
+		close(l1d_counter);
+	}
+#endif
+
+	return exit_code;
+}
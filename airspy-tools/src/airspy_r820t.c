@@ -115,7 +115,13 @@ int dump_register(struct airspy_device* device, const uint8_t register_number)
 int dump_registers(struct airspy_device* device)
 {
 	uint8_t register_number;
-	int result = AIRSPY_SUCCESS;
+	int result;
+
+	/* One pipelined batch, the reads below are then answered from the shadow */
+	result = airspy_refresh_registers(device, AIRSPY_REGISTERS_R820T);
+	if( result != AIRSPY_SUCCESS ) {
+		return result;
+	}
 
 	for(register_number=0; register_number<32; register_number++)
 	{
@@ -239,18 +239,32 @@ uint64_t bytes_to_xfer = 0;
 bool call_set_packing = false;
 uint32_t packing_val = 0;
 
+bool call_set_stream_config = false;
+airspy_stream_config_t stream_config = { 0, 0, 0 };
+
+bool call_set_thread_params = false;
+airspy_thread_params_t event_thread_params;
+airspy_thread_params_t consumer_thread_params;
+airspy_stream_stats_t stream_stats;
+
 bool sample_rate = false;
 uint32_t sample_rate_val;
 
 bool sample_type = false;
 enum airspy_sample_type sample_type_val = AIRSPY_SAMPLE_INT16_IQ;
 
+bool decimation = false;
+uint32_t decimation_val = 1;
+
 bool biast = false;
 uint32_t biast_val;
 
 bool serial_number = false;
 uint64_t serial_number_val;
 
+const char* replay_path = NULL;
+bool replay_fast = false;
+
 static float
 TimevalDiff(const struct timeval *a, const struct timeval *b)
 {
@@ -312,6 +326,69 @@ int parse_u32(char* s, uint32_t* const value)
 	}
 }
 
+/* Comma separated cores or core ranges, "2" or "0,2-3" */
+int parse_cpu_list(char* s, uint64_t* const mask)
+{
+	char* s_end;
+	unsigned long first;
+	unsigned long last;
+	uint64_t value = 0;
+
+	for (;;) {
+		first = strtoul(s, &s_end, 10);
+		if( s_end == s ) {
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+		last = first;
+		s = s_end;
+		if( *s == '-' ) {
+			s++;
+			last = strtoul(s, &s_end, 10);
+			if( s_end == s ) {
+				return AIRSPY_ERROR_INVALID_PARAM;
+			}
+			s = s_end;
+		}
+		if( (first > last) || (last > 63) ) {
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+		for (; first <= last; first++) {
+			value |= (uint64_t)1 << first;
+		}
+		if( *s == 0 ) {
+			*mask = value;
+			return AIRSPY_SUCCESS;
+		}
+		if( *s != ',' ) {
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+		s++;
+	}
+}
+
+/* "fifo:priority" or "rr:priority" */
+int parse_sched(char* s, enum airspy_sched_policy* const policy, int* const priority)
+{
+	uint32_t value;
+
+	if( strncmp(s, "fifo:", 5) == 0 ) {
+		*policy = AIRSPY_SCHED_FIFO;
+		s += 5;
+	} else if( strncmp(s, "rr:", 3) == 0 ) {
+		*policy = AIRSPY_SCHED_RR;
+		s += 3;
+	} else {
+		return AIRSPY_ERROR_INVALID_PARAM;
+	}
+
+	if( parse_u32(s, &value) != AIRSPY_SUCCESS ) {
+		return AIRSPY_ERROR_INVALID_PARAM;
+	}
+	*priority = (int)value;
+
+	return AIRSPY_SUCCESS;
+}
+
 static char *stringrev(char *str)
 {
 	char *p1, *p2;
@@ -487,6 +564,17 @@ static void usage(void)
 	fprintf(stderr, "[-g linearity_gain]: Set linearity simplified gain, 0-%d\n", LINEARITY_GAIN_MAX);
 	fprintf(stderr, "[-h sensivity_gain]: Set sensitivity simplified gain, 0-%d\n", SENSITIVITY_GAIN_MAX);
 	fprintf(stderr, "[-n num_samples]: Number of samples to transfer (default is unlimited)\n");
+	fprintf(stderr, "[-X transfer_count]: Number of USB transfers in flight (default 16)\n");
+	fprintf(stderr, "[-B buffer_size]: Bytes per USB transfer, multiple of 512 (default 262144, 147456 packed)\n");
+	fprintf(stderr, "[-Q queue_depth]: Buffers queued for the consumer before dropping (default 8)\n");
+	fprintf(stderr, "[-E cpu_list]: Pin the USB event thread to cores, e.g. 2 or 0,2-3\n");
+	fprintf(stderr, "[-C cpu_list]: Pin the sample consumer thread to cores\n");
+	fprintf(stderr, "[-P policy:priority]: Realtime scheduling of both threads, fifo:N or rr:N\n");
+	fprintf(stderr, "[-F filename]: Replay a file instead of a device. The file must be an AIRSPY_SAMPLE_RAW\n");
+	fprintf(stderr, " capture (as written with -t 5), unpacked 16bits, or 12bits packed when also given -p 1.\n");
+	fprintf(stderr, " -t picks the output type independently of the capture format\n");
+	fprintf(stderr, "[-U]: Replay as fast as possible instead of at the sample rate\n");
+	fprintf(stderr, "[-D factor]: Decimate IQ output by 2, 4, ... 256 in the library (default 1)\n");
 	fprintf(stderr, "[-d]: Verbose mode\n");
 }
 
@@ -538,7 +626,7 @@ int main(int argc, char** argv)
 	double freq_hz_temp;
 	char str[20];
 
-	while( (opt = getopt(argc, argv, "r:ws:p:f:a:t:b:v:m:l:g:h:n:d")) != EOF )
+	while( (opt = getopt(argc, argv, "r:ws:p:f:a:t:b:v:m:l:g:h:n:dX:B:Q:E:C:P:F:UD:")) != EOF )
 	{
 		result = AIRSPY_SUCCESS;
 		switch( opt ) 
@@ -682,6 +770,51 @@ int main(int argc, char** argv)
 				verbose = true;
 			break;
 
+			case 'X':
+				call_set_stream_config = true;
+				result = parse_u32(optarg, &stream_config.transfer_count);
+			break;
+
+			case 'B':
+				call_set_stream_config = true;
+				result = parse_u32(optarg, &stream_config.buffer_size);
+			break;
+
+			case 'Q':
+				call_set_stream_config = true;
+				result = parse_u32(optarg, &stream_config.queue_depth);
+			break;
+
+			case 'E':
+				call_set_thread_params = true;
+				result = parse_cpu_list(optarg, &event_thread_params.cpu_mask);
+			break;
+
+			case 'C':
+				call_set_thread_params = true;
+				result = parse_cpu_list(optarg, &consumer_thread_params.cpu_mask);
+			break;
+
+			case 'P':
+				call_set_thread_params = true;
+				result = parse_sched(optarg, &event_thread_params.policy, &event_thread_params.priority);
+				consumer_thread_params.policy = event_thread_params.policy;
+				consumer_thread_params.priority = event_thread_params.priority;
+			break;
+
+			case 'F':
+				replay_path = optarg;
+			break;
+
+			case 'U':
+				replay_fast = true;
+			break;
+
+			case 'D':
+				decimation = true;
+				result = parse_u32(optarg, &decimation_val);
+			break;
+
 			default:
 				fprintf(stderr, "unknown argument '-%c %s'\n", opt, optarg);
 				usage();
@@ -851,7 +984,16 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
-	if(serial_number == true)
+	if(replay_path != NULL)
+	{
+		result = airspy_open_file(&device, replay_path,
+			(packing_val ? AIRSPY_FILE_PACKED : 0) | (replay_fast ? AIRSPY_FILE_FAST : 0));
+		if( result != AIRSPY_SUCCESS ) {
+			fprintf(stderr, "airspy_open_file() failed: %s (%d)\n", airspy_error_name(result), result);
+			airspy_exit();
+			return EXIT_FAILURE;
+		}
+	}else if(serial_number == true)
 	{
 		result = airspy_open_sn(&device, serial_number_val);
 		if( result != AIRSPY_SUCCESS ) {
@@ -904,6 +1046,22 @@ int main(int argc, char** argv)
 
 	free(supported_samplerates);
 
+	if (decimation)
+	{
+		result = airspy_set_decimation(device, decimation_val);
+		if (result != AIRSPY_SUCCESS) {
+			fprintf(stderr, "airspy_set_decimation() failed: %s (%d)\n", airspy_error_name(result), result);
+			airspy_close(device);
+			airspy_exit();
+			return EXIT_FAILURE;
+		}
+
+		if (wav_nb_channels == 2)
+		{
+			wav_sample_per_sec /= decimation_val;
+		}
+	}
+
 	result = airspy_set_samplerate(device, sample_rate_val);
 	if (result != AIRSPY_SUCCESS) {
 		fprintf(stderr, "airspy_set_samplerate() failed: %s (%d)\n", airspy_error_name(result), result);
@@ -940,6 +1098,28 @@ int main(int argc, char** argv)
 		}
 	}
 
+	if( call_set_stream_config == true )
+	{
+		result = airspy_set_stream_config(device, &stream_config);
+		if( result != AIRSPY_SUCCESS ) {
+			fprintf(stderr, "airspy_set_stream_config() failed: %s (%d)\n", airspy_error_name(result), result);
+			airspy_close(device);
+			airspy_exit();
+			return EXIT_FAILURE;
+		}
+
+		if (verbose)
+		{
+			airspy_get_stream_config(device, &stream_config);
+			fprintf(stderr, "stream_config -X %u -B %u -Q %u\n", stream_config.transfer_count, stream_config.buffer_size, stream_config.queue_depth);
+		}
+	}
+
+	if (verbose)
+	{
+		fprintf(stderr, "USB buffers: %s\n", airspy_is_zero_copy(device) == AIRSPY_TRUE ? "kernel mapped (zero copy)" : "heap");
+	}
+
 	result = airspy_set_rf_bias(device, biast_val);
 	if( result != AIRSPY_SUCCESS ) {
 		fprintf(stderr, "airspy_set_rf_bias() failed: %s (%d)\n", airspy_error_name(result), result);
@@ -1027,6 +1207,21 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
+	/* Set while streaming so that a refused realtime policy is reported */
+	if( call_set_thread_params == true )
+	{
+		result = airspy_set_thread_params(device, AIRSPY_THREAD_EVENT, &event_thread_params);
+		if( result == AIRSPY_SUCCESS ) {
+			result = airspy_set_thread_params(device, AIRSPY_THREAD_CONSUMER, &consumer_thread_params);
+		}
+		if( result != AIRSPY_SUCCESS ) {
+			fprintf(stderr, "airspy_set_thread_params() failed: %s (%d)\n", airspy_error_name(result), result);
+			airspy_close(device);
+			airspy_exit();
+			return EXIT_FAILURE;
+		}
+	}
+
 	result = airspy_set_freq(device, freq_hz);
 	if( result != AIRSPY_SUCCESS ) {
 		fprintf(stderr, "airspy_set_freq() failed: %s (%d)\n", airspy_error_name(result), result);
@@ -1077,6 +1272,26 @@ int main(int argc, char** argv)
 			fprintf(stderr, "airspy_stop_rx() failed: %s (%d)\n", airspy_error_name(result), result);
 		}
 
+		if (verbose && airspy_get_stream_stats(device, &stream_stats) == AIRSPY_SUCCESS)
+		{
+			fprintf(stderr, "Transfers: %llu completed, %llu failed, %llu resubmitted\n",
+				(unsigned long long) stream_stats.transfers_completed,
+				(unsigned long long) stream_stats.transfers_failed,
+				(unsigned long long) stream_stats.transfers_resubmitted);
+			fprintf(stderr, "Buffers: %llu delivered, %llu dropped, queue high water %u/%u\n",
+				(unsigned long long) stream_stats.buffers_delivered,
+				(unsigned long long) stream_stats.buffers_dropped,
+				stream_stats.queue_high_water, stream_stats.queue_depth);
+			fprintf(stderr, "Conversion: p50 %llu us, p99 %llu us, max %llu us\n",
+				(unsigned long long) stream_stats.conversion.p50_ns / 1000,
+				(unsigned long long) stream_stats.conversion.p99_ns / 1000,
+				(unsigned long long) stream_stats.conversion.max_ns / 1000);
+			fprintf(stderr, "Callback: p50 %llu us, p99 %llu us, max %llu us\n",
+				(unsigned long long) stream_stats.callback.p50_ns / 1000,
+				(unsigned long long) stream_stats.callback.p99_ns / 1000,
+				(unsigned long long) stream_stats.callback.max_ns / 1000);
+		}
+
 		result = airspy_close(device);
 		if( result != AIRSPY_SUCCESS ) 
 		{
@@ -110,7 +110,13 @@ int dump_register(struct airspy_device* device, const uint8_t register_number) {
 
 int dump_registers(struct airspy_device* device) {
 	int register_number;
-	int result = AIRSPY_SUCCESS;
+	int result;
+	
+	/* One pipelined batch, the reads below are then answered from the shadow */
+	result = airspy_refresh_registers(device, AIRSPY_REGISTERS_SI5351C);
+	if( result != AIRSPY_SUCCESS ) {
+		return result;
+	}
 	
 	for(register_number=0; register_number<256; register_number++) {
 		result = dump_register(device, (uint8_t)register_number);
@@ -28,6 +28,10 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 #include <string.h>
 #include <libusb.h>
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 #if _MSC_VER > 1700  // To avoid error with Visual Studio 2017/2019 or more define which define timespec as it is already defined in pthread.h
 #define HAVE_STRUCT_TIMESPEC
 #endif
@@ -37,7 +41,18 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 #include "airspy.h"
 #include "iqconverter_float.h"
 #include "iqconverter_int16.h"
+#include "decimator.h"
 #include "filters.h"
+#include "cpu_features.h"
+#include "unpacker.h"
+#include "spsc_ring.h"
+#include "buffer_pool.h"
+#include "time_filter.h"
+#include "work_pool.h"
+#include "fork_join.h"
+#include "thread_params.h"
+#include "register_shadow.h"
+#include "atomics.h"
 
 #ifndef bool
 typedef int bool;
@@ -48,6 +63,89 @@ typedef int bool;
 #define PACKET_SIZE (12)
 #define UNPACKED_SIZE (16)
 #define RAW_BUFFER_COUNT (8)
+#define TRANSFER_COUNT (16)
+#define UNPACKED_BUFFER_SIZE (262144)
+#define PACKED_BUFFER_SIZE (6144 * 24)
+
+/* Limits for airspy_set_stream_config() */
+#define MAX_TRANSFER_COUNT (256)
+#define MAX_QUEUE_DEPTH (1024)
+#define MIN_BUFFER_SIZE (1536)
+#define MAX_BUFFER_SIZE (4 * 1024 * 1024)
+#define BUFFER_SIZE_ALIGN (512)
+#define PACKED_BUFFER_SIZE_ALIGN (1536)
+
+/* Limit for airspy_set_buffer_pool() */
+#define MAX_POOL_COUNT (1024)
+
+/* Limit for airspy_set_decimation() */
+#define MAX_DECIMATION (1 << DECIMATOR_MAX_STAGES)
+
+/* USB words converted and decimated at a time, small enough to stay in L1 */
+#define DECIMATION_CHUNK (4096)
+
+/* Limits for airspy_context_create() */
+#define MAX_EVENT_THREADS (16)
+#define MAX_WORKER_THREADS (64)
+
+/* Limit for airspy_set_conversion_threads() */
+#define MAX_CONVERSION_THREADS (16)
+
+/* One thread_params_t per enum airspy_thread_role */
+#define THREAD_ROLE_COUNT (3)
+
+/* Split points of a parallel conversion, keeps packed words and SIMD blocks whole */
+#define CONVERSION_PART_ALIGN (64)
+
+/* Async control requests a device keeps in flight before airspy_*_async() reports busy */
+#define MAX_CONTROLS_IN_FLIGHT (256)
+
+/* Fields of the gain cache, in the order airspy_set_gains() sends them */
+enum gain_field
+{
+	GAIN_FIELD_MIXER_AGC = 0,
+	GAIN_FIELD_LNA_AGC,
+	GAIN_FIELD_VGA,
+	GAIN_FIELD_MIXER,
+	GAIN_FIELD_LNA,
+	GAIN_FIELD_COUNT,
+	GAIN_FIELD_NONE = -1,
+};
+
+/*
+ * Published gain word: AIRSPY_GAIN_STATE_* bits, GAIN_WORD_PENDING while an
+ * update is in flight, and a counter in the high half bumped by every update
+ * start and end, so the USB callback sees any update since the last block.
+ */
+#define GAIN_WORD_STATE_MASK (0x7FFF)
+#define GAIN_WORD_PENDING (1 << 15)
+#define GAIN_WORD_COUNTER_SHIFT (16)
+
+#define R820T_REGISTER_COUNT (32)
+#define SI5351C_REGISTER_COUNT (256)
+
+/* R820T registers the firmware gain commands write */
+#define R820T_LNA_GAIN_REGISTER (0x05)
+#define R820T_MIXER_GAIN_REGISTER (0x07)
+#define R820T_VGA_GAIN_REGISTER (0x0C)
+
+/* Register reads kept in flight by airspy_refresh_registers() */
+#define REGISTER_REFRESH_WINDOW (64)
+
+/* How long a device on a shared context waits for its cancelled transfers */
+#define TRANSFER_DRAIN_TIMEOUT_MS (1000)
+
+/* Retunes the sweep thread may run ahead of the consumer, power of two */
+#define SWEEP_EVENT_COUNT (1024)
+#define MAX_SWEEP_STEPS (65536)
+
+/* Longest sleep between checks for a stop request */
+#define SLEEP_SLICE_US (10000)
+
+/* libusb_dev_mem_alloc() appeared in libusb 1.0.21 */
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+#define HAVE_LIBUSB_DEV_MEM
+#endif
 
 #ifdef AIRSPY_BIG_ENDIAN
 #define TO_LE(x) __builtin_bswap32(x)
@@ -55,12 +153,6 @@ typedef int bool;
 #define TO_LE(x) x
 #endif
 
-#define SAMPLE_RESOLUTION 12
-#define SAMPLE_ENCAPSULATION 16
-
-#define SAMPLE_SHIFT (SAMPLE_ENCAPSULATION - SAMPLE_RESOLUTION)
-#define SAMPLE_SCALE (1.0f / (1 << (15 - SAMPLE_SHIFT)))
-
 #define SERIAL_NUMBER_UNUSED (0ULL)
 #define FILE_DESCRIPTOR_UNUSED (-1)
 
@@ -76,6 +168,51 @@ typedef struct {
 	uint32_t freq_hz;
 } set_freq_params_t;
 
+struct airspy_context;
+
+/* One libusb context and the thread that handles its events */
+typedef struct airspy_event_loop
+{
+	struct airspy_context* context;
+	libusb_context* usb_context;
+	pthread_t thread;
+	bool thread_running;
+	uint32_t device_count;
+} airspy_event_loop_t;
+
+typedef struct airspy_context
+{
+	airspy_event_loop_t* event_loops;
+	uint32_t event_loop_count;
+	uint32_t device_count;
+	volatile bool running;
+	bool workers_running;
+	work_pool_t workers;
+	thread_params_t thread_params[THREAD_ROLE_COUNT];
+	pthread_mutex_t mutex;
+} airspy_context_t;
+
+/* A retune issued by the sweep thread, in host monotonic time */
+typedef struct sweep_event
+{
+	/* Samples from here on may be at the new frequency */
+	uint64_t start_ns;
+	/* ... and are settled from here on */
+	uint64_t settle_end_ns;
+	uint32_t freq_hz;
+	uint32_t step;
+} sweep_event_t;
+
+/* One buffer being converted by the conversion team */
+typedef struct conversion_job
+{
+	uint16_t* input;
+	void* dest;
+	int sample_count;
+	int parts;
+	int phase;
+} conversion_job_t;
+
 typedef struct airspy_device
 {
 	libusb_context* usb_context;
@@ -88,30 +225,100 @@ typedef struct airspy_device
 	pthread_t consumer_thread;
 	bool transfer_thread_running;
 	bool consumer_thread_running;
-	pthread_cond_t consumer_cv;
-	pthread_mutex_t consumer_mp;
 	uint32_t supported_samplerate_count;
 	uint32_t *supported_samplerates;
 	uint32_t transfer_count;
 	uint32_t buffer_size;
+	uint32_t requested_buffer_size;
+	uint32_t queue_depth;
 	uint32_t dropped_buffers;
-	uint32_t dropped_buffers_queue[RAW_BUFFER_COUNT];
-	uint16_t *received_samples_queue[RAW_BUFFER_COUNT];
-	volatile int received_samples_queue_head;
-	volatile int received_samples_queue_tail;
-	volatile int received_buffer_count;
+	uint32_t *dropped_buffers_queue;
+	uint64_t *sample_index_queue;
+	uint64_t *timestamp_queue;
+	uint32_t *gain_state_queue;
+	uint64_t sample_counter;
+	uint64_t clock_base_ns;
+	int64_t realtime_offset_ns;
+	uint32_t raw_samplerate;
+	time_filter_t time_filter;
+	airspy_stream_stats_t stats;
+	airspy_context_t* context;
+	airspy_event_loop_t* event_loop;
+	work_item_t work;
+	volatile uint32_t transfers_in_flight;
+	uint16_t **received_samples_queue;
+	unsigned char *usb_buffers;
+	size_t usb_buffers_size;
+	bool usb_buffers_mapped;
+	spsc_ring_t received_ring;
+	int pull_slot;
+	int pull_count;
+	uint8_t *pull_samples;
 	void *output_buffer;
-	uint16_t *unpacked_samples;
+	uint32_t pool_count;
+	bool pool_active;
+	/* Set by a shared worker that left a slot queued for want of a pool buffer */
+	volatile uint32_t pool_starved;
+	buffer_pool_t pool;
 	bool packing_enabled;
 	iqconverter_float_t *cnv_f;
 	iqconverter_int16_t *cnv_i;
+	uint32_t decimation;
+	decimator_float_t *dec_f;
+	decimator_int16_t *dec_i;
+	void *decimation_scratch;
+	uint32_t conversion_threads;
+	bool conversion_active;
+	fork_join_t conversion_team;
+	conversion_job_t conversion_job;
+	iqconverter_float_t **cnv_f_parts;
+	iqconverter_int16_t **cnv_i_parts;
+	thread_params_t thread_params[THREAD_ROLE_COUNT];
+	pthread_t control_thread;
+	bool control_thread_running;
+	bool control_stopping;
+	uint32_t controls_in_flight;
+	pthread_mutex_t control_mutex;
+	pthread_cond_t control_cond;
+	uint8_t gain_values[GAIN_FIELD_COUNT];
+	uint32_t gain_known;
+	uint32_t gain_changes_pending;
+	volatile uint32_t gain_word;
+	uint32_t gain_word_seen;
+	pthread_mutex_t gain_mutex;
+	FILE* file;
+	uint32_t file_flags;
+	uint32_t replay_rate;
+	register_shadow_t r820t_shadow;
+	register_shadow_t si5351c_shadow;
+	pthread_mutex_t register_mutex;
+	volatile uint32_t freq_hz;
+	airspy_sweep_step_t* sweep_steps;
+	uint32_t sweep_step_count;
+	uint32_t sweep_flags;
+	pthread_t sweep_thread;
+	bool sweep_thread_running;
+	volatile bool sweep_running;
+	spsc_ring_t sweep_ring;
+	sweep_event_t sweep_events[SWEEP_EVENT_COUNT];
+	bool sweep_tagging;
+	uint32_t sweep_tag_freq_hz;
+	uint32_t sweep_tag_step;
+	uint32_t sweep_tag_flags;
+	uint64_t sweep_settle_end_ns;
 	void* ctx;
 	enum airspy_sample_type sample_type;
 } airspy_device_t;
 
+/* Status registers and the Si5351C PLL reset (self clearing) always go to the chip */
+static const uint8_t r820t_uncached_registers[] = { 0x00, 0x01, 0x02, 0x03, 0x04 };
+static const uint8_t si5351c_uncached_registers[] = { 0, 1, 177 };
+
 static const uint16_t airspy_usb_vid = 0x1d50;
 static const uint16_t airspy_usb_pid = 0x60a1;
 
+static pthread_once_t dsp_init_once = PTHREAD_ONCE_INIT;
+
 #define STR_PREFIX_SERIAL_AIRSPY_SIZE (10)
 
 #define SERIAL_AIRSPY_EXPECTED_SIZE (26)
@@ -125,10 +332,26 @@ uint8_t airspy_sensitivity_vga_gains[GAIN_COUNT] = { 13, 12, 11, 10, 9, 8, 7, 6,
 uint8_t airspy_sensitivity_mixer_gains[GAIN_COUNT] = { 12, 12, 12, 12, 11, 10, 10, 9, 9, 8, 7, 4, 4, 4, 3, 2, 2, 1, 0, 0, 0, 0 };
 uint8_t airspy_sensitivity_lna_gains[GAIN_COUNT] = { 14, 14, 14, 14, 14, 14, 14, 14, 14, 13, 12, 12, 9, 9, 8, 7, 6, 5, 3, 2, 1, 0 };
 
+static void dsp_init(void)
+{
+	uint32_t cpu_features = cpu_features_get();
+
+	unpacker_init(cpu_features);
+	iqconverter_float_init(cpu_features);
+	iqconverter_int16_init(cpu_features);
+	decimator_init(cpu_features);
+}
+
 static int cancel_transfers(airspy_device_t* device)
 {
 	uint32_t transfer_index;
 
+	/* A replayed capture never submits its transfers */
+	if (device->file != NULL)
+	{
+		return AIRSPY_SUCCESS;
+	}
+
 	if (device->transfers != NULL)
 	{
 		for (transfer_index = 0; transfer_index<device->transfer_count; transfer_index++)
@@ -147,7 +370,6 @@ static int cancel_transfers(airspy_device_t* device)
 
 static int free_transfers(airspy_device_t* device)
 {
-	int i;
 	uint32_t transfer_index;
 
 	if (device->transfers != NULL)
@@ -157,7 +379,6 @@ static int free_transfers(airspy_device_t* device)
 		{
 			if (device->transfers[transfer_index] != NULL)
 			{
-				free(device->transfers[transfer_index]->buffer);
 				libusb_free_transfer(device->transfers[transfer_index]);
 				device->transfers[transfer_index] = NULL;
 			}
@@ -170,67 +391,155 @@ static int free_transfers(airspy_device_t* device)
 			free(device->output_buffer);
 			device->output_buffer = NULL;
 		}
+	}
+
+	free(device->received_samples_queue);
+	device->received_samples_queue = NULL;
+
+	free(device->dropped_buffers_queue);
+	device->dropped_buffers_queue = NULL;
+
+	free(device->sample_index_queue);
+	device->sample_index_queue = NULL;
 
-		if (device->unpacked_samples != NULL)
+	free(device->timestamp_queue);
+	device->timestamp_queue = NULL;
+	free(device->gain_state_queue);
+	device->gain_state_queue = NULL;
+
+	if (device->usb_buffers != NULL)
+	{
+#ifdef HAVE_LIBUSB_DEV_MEM
+		if (device->usb_buffers_mapped)
+		{
+			libusb_dev_mem_free(device->usb_device, device->usb_buffers, device->usb_buffers_size);
+		}
+		else
+#endif
 		{
-			free(device->unpacked_samples);
-			device->unpacked_samples = NULL;
+			free(device->usb_buffers);
 		}
+		device->usb_buffers = NULL;
+		device->usb_buffers_mapped = false;
+	}
+
+	return AIRSPY_SUCCESS;
+}
+
+/*
+ * Every transfer and consumer queue buffer is carved from one block. On
+ * Linux the block is first requested from usbfs with libusb_dev_mem_alloc(),
+ * so that completed transfers land in memory mapped into the process and
+ * the kernel does not copy them. The buffers are swapped between the
+ * transfers and the queue, so they must all come from the same kind of
+ * memory; the heap is used for everything when the mapping is refused.
+ */
+static int allocate_usb_buffers(airspy_device_t* device)
+{
+	size_t size = (size_t) (device->transfer_count + device->queue_depth) * device->buffer_size;
+
+	device->usb_buffers = NULL;
+	device->usb_buffers_mapped = false;
+
+#ifdef HAVE_LIBUSB_DEV_MEM
+	if (device->usb_device != NULL)
+	{
+		device->usb_buffers = libusb_dev_mem_alloc(device->usb_device, size);
+		device->usb_buffers_mapped = device->usb_buffers != NULL;
+	}
+#endif
 
-		for (i = 0; i < RAW_BUFFER_COUNT; i++)
+	if (device->usb_buffers == NULL)
+	{
+		device->usb_buffers = (unsigned char *) malloc(size);
+		if (device->usb_buffers == NULL)
 		{
-			if (device->received_samples_queue[i] != NULL)
-			{
-				free(device->received_samples_queue[i]);
-				device->received_samples_queue[i] = NULL;
-			}
+			return AIRSPY_ERROR_NO_MEM;
 		}
 	}
 
+	device->usb_buffers_size = size;
+	memset(device->usb_buffers, 0, size);
+
 	return AIRSPY_SUCCESS;
 }
 
+/*
+ * Without a configured size the historical defaults are kept. A configured
+ * size is trimmed in packed mode so that every buffer holds whole 12-bit
+ * packets and stays a multiple of the USB packet size.
+ */
+static uint32_t stream_buffer_size(const airspy_device_t* device)
+{
+	uint32_t size = device->requested_buffer_size;
+
+	if (size == 0)
+	{
+		return device->packing_enabled ? PACKED_BUFFER_SIZE : UNPACKED_BUFFER_SIZE;
+	}
+
+	if (device->packing_enabled)
+	{
+		size -= size % PACKED_BUFFER_SIZE_ALIGN;
+	}
+
+	return size;
+}
+
+/* 12 bit ADC samples carried by one USB buffer */
+static uint32_t buffer_word_count(const airspy_device_t* device)
+{
+	if (device->packing_enabled)
+	{
+		return ((device->buffer_size / 2) * 4) / 3;
+	}
+
+	return device->buffer_size / 2;
+}
+
+/* Large enough for one USB buffer converted to any sample type */
+static size_t output_buffer_size(const airspy_device_t* device)
+{
+	return (size_t) buffer_word_count(device) * sizeof(float);
+}
+
 static int allocate_transfers(airspy_device_t* const device)
 {
 	int i;
-	size_t sample_count;
 	uint32_t transfer_index;
 
 	if (device->transfers == NULL)
 	{
-		for (i = 0; i < RAW_BUFFER_COUNT; i++)
+		if (spsc_ring_resize(&device->received_ring, device->queue_depth) != 0)
 		{
-			device->received_samples_queue[i] = (uint16_t *)malloc(device->buffer_size);
-			if (device->received_samples_queue[i] == NULL)
-			{
-				return AIRSPY_ERROR_NO_MEM;
-			}
-
-			memset(device->received_samples_queue[i], 0, device->buffer_size);
+			return AIRSPY_ERROR_INVALID_PARAM;
 		}
 
-		if (device->packing_enabled)
+		device->dropped_buffers_queue = (uint32_t *) calloc(device->queue_depth, sizeof(uint32_t));
+		device->received_samples_queue = (uint16_t **) calloc(device->queue_depth, sizeof(uint16_t *));
+		device->sample_index_queue = (uint64_t *) calloc(device->queue_depth, sizeof(uint64_t));
+		device->timestamp_queue = (uint64_t *) calloc(device->queue_depth, sizeof(uint64_t));
+		device->gain_state_queue = (uint32_t *) calloc(device->queue_depth, sizeof(uint32_t));
+		if (device->dropped_buffers_queue == NULL || device->received_samples_queue == NULL ||
+			device->sample_index_queue == NULL || device->timestamp_queue == NULL || device->gain_state_queue == NULL)
 		{
-			sample_count = ((device->buffer_size / 2) * 4) / 3;
+			return AIRSPY_ERROR_NO_MEM;
 		}
-		else
+
+		if (allocate_usb_buffers(device) != AIRSPY_SUCCESS)
 		{
-			sample_count = device->buffer_size / 2;
+			return AIRSPY_ERROR_NO_MEM;
 		}
 
-		device->output_buffer = (float *)malloc(sample_count * sizeof(float));
-		if (device->output_buffer == NULL)
+		for (i = 0; i < (int) device->queue_depth; i++)
 		{
-			return AIRSPY_ERROR_NO_MEM;
+			device->received_samples_queue[i] = (uint16_t *) (device->usb_buffers + (size_t) i * device->buffer_size);
 		}
 
-		if (device->packing_enabled)
+		device->output_buffer = (float *)malloc(output_buffer_size(device));
+		if (device->output_buffer == NULL)
 		{
-			device->unpacked_samples = (uint16_t*)malloc(sample_count * sizeof(uint16_t));
-			if (device->unpacked_samples == NULL)
-			{
-				return AIRSPY_ERROR_NO_MEM;
-			}
+			return AIRSPY_ERROR_NO_MEM;
 		}
 
 		device->transfers = (struct libusb_transfer**) calloc(device->transfer_count, sizeof(struct libusb_transfer));
@@ -251,17 +560,13 @@ static int allocate_transfers(airspy_device_t* const device)
 				device->transfers[transfer_index],
 				device->usb_device,
 				0,
-				(unsigned char*)malloc(device->buffer_size),
+				device->usb_buffers + (size_t) (device->queue_depth + transfer_index) * device->buffer_size,
 				device->buffer_size,
 				NULL,
 				device,
 				0
 				);
 
-			if (device->transfers[transfer_index]->buffer == NULL)
-			{
-				return AIRSPY_ERROR_NO_MEM;
-			}
 		}
 		return AIRSPY_SUCCESS;
 	}
@@ -282,9 +587,11 @@ static int prepare_transfers(airspy_device_t* device, const uint_fast8_t endpoin
 			device->transfers[transfer_index]->endpoint = endpoint_address;
 			device->transfers[transfer_index]->callback = callback;
 
+			atomic_add_fetch(&device->transfers_in_flight, 1);
 			error = libusb_submit_transfer(device->transfers[transfer_index]);
 			if (error != 0)
 			{
+				atomic_add_fetch(&device->transfers_in_flight, (uint32_t) -1);
 				return AIRSPY_ERROR_LIBUSB;
 			}
 		}
@@ -296,302 +603,1952 @@ static int prepare_transfers(airspy_device_t* device, const uint_fast8_t endpoin
 	}
 }
 
-static void convert_samples_int16(uint16_t *src, int16_t *dest, int count)
+/* Only IQ output is decimated */
+static uint32_t sample_decimation(const airspy_device_t* device)
 {
-	int i;
-	for (i = 0; i < count; i += 4)
-	{
-		dest[i + 0] = (src[i + 0] - 2048) << SAMPLE_SHIFT;
-		dest[i + 1] = (src[i + 1] - 2048) << SAMPLE_SHIFT;
-		dest[i + 2] = (src[i + 2] - 2048) << SAMPLE_SHIFT;
-		dest[i + 3] = (src[i + 3] - 2048) << SAMPLE_SHIFT;
-	}
+	return SAMPLE_TYPE_IS_IQ(device->sample_type) ? device->decimation : 1;
 }
 
-static void convert_samples_float(uint16_t *src, float *dest, int count)
+/*
+ * Samples in one USB buffer once converted, IQ types count complex samples.
+ * A decimated buffer can give one more when the count does not divide.
+ */
+static int buffer_sample_count(const airspy_device_t* device)
 {
-	int i;
-	for (i = 0; i < count; i += 4)
+	int sample_count = (int) buffer_word_count(device);
+
+	if (SAMPLE_TYPE_IS_IQ(device->sample_type))
 	{
-		dest[i + 0] = (src[i + 0] - 2048) * SAMPLE_SCALE;
-		dest[i + 1] = (src[i + 1] - 2048) * SAMPLE_SCALE;
-		dest[i + 2] = (src[i + 2] - 2048) * SAMPLE_SCALE;
-		dest[i + 3] = (src[i + 3] - 2048) * SAMPLE_SCALE;
+		sample_count /= 2;
 	}
+
+	return (sample_count + (int) sample_decimation(device) - 1) / (int) sample_decimation(device);
 }
 
-static inline void unpack_samples(uint32_t *input, uint16_t *output, int length)
+static size_t sample_type_size(enum airspy_sample_type sample_type)
 {
-	int i, j;
-
-	for (i = 0, j = 0; j < length; i += 3, j += 8)
+	switch (sample_type)
 	{
-		output[j + 0] = (input[i] >> 20) & 0xfff;
-		output[j + 1] = (input[i] >> 8) & 0xfff;
-		output[j + 2] = ((input[i] & 0xff) << 4) | ((input[i + 1] >> 28) & 0xf);
-		output[j + 3] = ((input[i + 1] & 0xfff0000) >> 16);
-		output[j + 4] = ((input[i + 1] & 0xfff0) >> 4);
-		output[j + 5] = ((input[i + 1] & 0xf) << 8) | ((input[i + 2] & 0xff000000) >> 24);
-		output[j + 6] = ((input[i + 2] >> 12) & 0xfff);
-		output[j + 7] = ((input[i + 2] & 0xfff));
+	case AIRSPY_SAMPLE_FLOAT32_IQ:
+		return 2 * sizeof(float);
+	case AIRSPY_SAMPLE_FLOAT32_REAL:
+		return sizeof(float);
+	case AIRSPY_SAMPLE_INT16_IQ:
+		return 2 * sizeof(int16_t);
+	default:
+		return sizeof(int16_t);
 	}
 }
 
-static void* consumer_threadproc(void *arg)
+/* Sample types that are handed out straight from the USB buffer */
+static bool sample_type_in_place(const airspy_device_t* device)
 {
-	int sample_count;
-	uint16_t* input_samples;
-	uint32_t dropped_buffers;
-	airspy_device_t* device = (airspy_device_t*)arg;
-	airspy_transfer_t transfer;
+	return device->sample_type == AIRSPY_SAMPLE_RAW ||
+		(device->sample_type == AIRSPY_SAMPLE_UINT16_REAL && !device->packing_enabled);
+}
 
-#ifdef _WIN32
+/* Single writer per timing, a few ns per sample block */
+static void record_timing(airspy_timing_stats_t* timing, uint64_t start_ns)
+{
+	int bin = 0;
+	uint64_t ns = time_monotonic_ns() - start_ns;
+	uint64_t v = ns >> 1;
 
-	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+	while (v != 0 && bin < AIRSPY_STATS_HISTOGRAM_BINS - 1)
+	{
+		v >>= 1;
+		bin++;
+	}
 
-#endif
+	timing->histogram[bin]++;
+	timing->count++;
+	timing->total_ns += ns;
+	if (ns > timing->max_ns)
+	{
+		timing->max_ns = ns;
+	}
+}
 
-	pthread_mutex_lock(&device->consumer_mp);
+static void compute_percentiles(airspy_timing_stats_t* timing)
+{
+	int bin;
+	uint64_t bound;
+	uint64_t cumulative = 0;
 
-	while (device->streaming && !device->stop_requested)
+	timing->p50_ns = 0;
+	timing->p99_ns = 0;
+
+	for (bin = 0; bin < AIRSPY_STATS_HISTOGRAM_BINS && timing->count != 0; bin++)
 	{
-		while (device->received_buffer_count == 0 && device->streaming && !device->stop_requested)
+		cumulative += timing->histogram[bin];
+		bound = (uint64_t) 2 << bin;
+		if (bound > timing->max_ns)
+		{
+			bound = timing->max_ns;
+		}
+
+		if (timing->p50_ns == 0 && cumulative * 2 >= timing->count)
 		{
-			pthread_cond_wait(&device->consumer_cv, &device->consumer_mp);
+			timing->p50_ns = bound;
 		}
-		if (!device->streaming || device->stop_requested)
+		if (timing->p99_ns == 0 && cumulative * 100 >= timing->count * 99)
 		{
+			timing->p99_ns = bound;
 			break;
 		}
+	}
+}
 
-		input_samples = device->received_samples_queue[device->received_samples_queue_tail];
-		dropped_buffers = device->dropped_buffers_queue[device->received_samples_queue_tail];
-		device->received_samples_queue_tail = (device->received_samples_queue_tail + 1) & (RAW_BUFFER_COUNT - 1);
-
-		pthread_mutex_unlock(&device->consumer_mp);
+/* Unpacks or converts samples [start, start + count) of a USB buffer, both multiples of 8 */
+static void convert_range(airspy_device_t* device, uint16_t* input_samples, void* dest, int start, int count)
+{
+	const uint32_t* packed = (const uint32_t*)input_samples + start / 8 * 3;
 
+	switch (device->sample_type)
+	{
+	case AIRSPY_SAMPLE_FLOAT32_IQ:
+	case AIRSPY_SAMPLE_FLOAT32_REAL:
 		if (device->packing_enabled)
 		{
-			sample_count = ((device->buffer_size / 2) * 4) / 3;
-
-			if (device->sample_type != AIRSPY_SAMPLE_RAW)
-			{
-				unpack_samples((uint32_t*)input_samples, device->unpacked_samples, sample_count);
-
-				input_samples = device->unpacked_samples;
-			}
+			unpack_samples_float(packed, (float *)dest + start, count);
 		}
 		else
 		{
-			sample_count = device->buffer_size / 2;
+			convert_samples_float(input_samples + start, (float *)dest + start, count);
 		}
+		break;
 
-		switch (device->sample_type)
+	case AIRSPY_SAMPLE_INT16_IQ:
+	case AIRSPY_SAMPLE_INT16_REAL:
+		if (device->packing_enabled)
 		{
-		case AIRSPY_SAMPLE_FLOAT32_IQ:
-			convert_samples_float(input_samples, (float *)device->output_buffer, sample_count);
-			iqconverter_float_process(device->cnv_f, (float *) device->output_buffer, sample_count);
-			sample_count /= 2;
-			transfer.samples = device->output_buffer;
-			break;
-
-		case AIRSPY_SAMPLE_FLOAT32_REAL:
-			convert_samples_float(input_samples, (float *)device->output_buffer, sample_count);
-			transfer.samples = device->output_buffer;
-			break;
-
-		case AIRSPY_SAMPLE_INT16_IQ:
-			convert_samples_int16(input_samples, (int16_t *)device->output_buffer, sample_count);
-			iqconverter_int16_process(device->cnv_i, (int16_t *) device->output_buffer, sample_count);
-			sample_count /= 2;
-			transfer.samples = device->output_buffer;
-			break;
-
-		case AIRSPY_SAMPLE_INT16_REAL:
-			convert_samples_int16(input_samples, (int16_t *)device->output_buffer, sample_count);
-			transfer.samples = device->output_buffer;
-			break;
-
-		case AIRSPY_SAMPLE_UINT16_REAL:
-		case AIRSPY_SAMPLE_RAW:
-			transfer.samples = input_samples;
-			break;
-
-		case AIRSPY_SAMPLE_END:
-			// Just to shut GCC's moaning
-			break;
+			unpack_samples_int16(packed, (int16_t *)dest + start, count);
 		}
+		else
+		{
+			convert_samples_int16(input_samples + start, (int16_t *)dest + start, count);
+		}
+		break;
 
-		transfer.device = device;
-		transfer.ctx = device->ctx;
-		transfer.sample_count = sample_count;
-		transfer.sample_type = device->sample_type;
-		transfer.dropped_samples = (uint64_t) dropped_buffers * (uint64_t) sample_count;
-
-		if (device->callback(&transfer) != 0)
+	case AIRSPY_SAMPLE_UINT16_REAL:
+		if (device->packing_enabled)
 		{
-			device->streaming = false;
+			unpack_samples(packed, (uint16_t *)dest + start, count);
 		}
+		break;
 
-		pthread_mutex_lock(&device->consumer_mp);
-		device->received_buffer_count--;
+	default:
+		break;
 	}
+}
 
-	device->streaming = false;
-
-	pthread_mutex_unlock(&device->consumer_mp);
+static void conversion_part_range(const conversion_job_t* job, uint32_t part, int* start, int* count)
+{
+	int chunk = (job->sample_count / job->parts) & ~(CONVERSION_PART_ALIGN - 1);
 
-	return NULL;
+	*start = chunk * (int) part;
+	*count = (int) part == job->parts - 1 ? job->sample_count - *start : chunk;
 }
 
-static void airspy_libusb_transfer_callback(struct libusb_transfer* usb_transfer)
+static void conversion_part(void* arg, uint32_t part)
 {
-	uint16_t *temp;
-	airspy_device_t* device = (airspy_device_t*)usb_transfer->user_data;
+	int start;
+	int count;
+	airspy_device_t* device = (airspy_device_t*)arg;
+	conversion_job_t* job = &device->conversion_job;
 
-	if (!device->streaming || device->stop_requested)
+	conversion_part_range(job, part, &start, &count);
+
+	if (job->phase == 0)
 	{
-		return;
+		convert_range(device, job->input, job->dest, start, count);
 	}
-
-	if (usb_transfer->status == LIBUSB_TRANSFER_COMPLETED && usb_transfer->actual_length == usb_transfer->length)
+	else if (device->sample_type == AIRSPY_SAMPLE_FLOAT32_IQ)
+	{
+		iqconverter_float_filter(device->cnv_f_parts[part], (float *)job->dest + start, count);
+	}
+	else
 	{
-		pthread_mutex_lock(&device->consumer_mp);
+		iqconverter_int16_filter(device->cnv_i_parts[part], (int16_t *)job->dest + start, count);
+	}
+}
 
-		if (device->received_buffer_count < RAW_BUFFER_COUNT)
-		{
-			temp = device->received_samples_queue[device->received_samples_queue_head];
-			device->received_samples_queue[device->received_samples_queue_head] = (uint16_t *)usb_transfer->buffer;
-			usb_transfer->buffer = (uint8_t *)temp;
+/*
+ * The conversion team unpacks the parts of the buffer, this thread runs the
+ * DC removal over all of it since its state chains through every sample,
+ * then the team filters the parts again, each from the filter history the
+ * single threaded run would have at its start. The output is bit exact.
+ */
+static void convert_parallel(airspy_device_t* device, uint16_t* input_samples, void* dest, int sample_count)
+{
+	int start;
+	int count;
+	uint32_t part;
+	conversion_job_t* job = &device->conversion_job;
 
-			device->dropped_buffers_queue[device->received_samples_queue_head] = device->dropped_buffers;
-			device->dropped_buffers = 0;
-			
-			device->received_samples_queue_head = (device->received_samples_queue_head + 1) & (RAW_BUFFER_COUNT - 1);
-			device->received_buffer_count++;
+	job->input = input_samples;
+	job->dest = dest;
+	job->sample_count = sample_count;
+	job->parts = (int) device->conversion_threads;
+	job->phase = 0;
 
-			pthread_cond_signal(&device->consumer_cv);
-		}
-		else
+	fork_join_run(&device->conversion_team, conversion_part, device);
+
+	if (device->sample_type == AIRSPY_SAMPLE_FLOAT32_IQ)
+	{
+		iqconverter_float_prepare(device->cnv_f, (float *)dest, sample_count);
+		for (part = 0; part < device->conversion_threads; part++)
 		{
-			device->dropped_buffers++;
+			conversion_part_range(job, part, &start, &count);
+			iqconverter_float_seek(device->cnv_f_parts[part], device->cnv_f, (float *)dest, start);
 		}
-
-		pthread_mutex_unlock(&device->consumer_mp);
-
-		if (libusb_submit_transfer(usb_transfer) != 0)
+		iqconverter_float_seek(device->cnv_f, device->cnv_f, (float *)dest, sample_count);
+	}
+	else if (device->sample_type == AIRSPY_SAMPLE_INT16_IQ)
+	{
+		iqconverter_int16_prepare(device->cnv_i, (int16_t *)dest, sample_count);
+		for (part = 0; part < device->conversion_threads; part++)
 		{
-			device->streaming = false;
+			conversion_part_range(job, part, &start, &count);
+			iqconverter_int16_seek(device->cnv_i_parts[part], device->cnv_i, (int16_t *)dest, start);
 		}
+		iqconverter_int16_seek(device->cnv_i, device->cnv_i, (int16_t *)dest, sample_count);
 	}
 	else
 	{
-		device->streaming = false;
+		return;
 	}
+
+	job->phase = 1;
+	fork_join_run(&device->conversion_team, conversion_part, device);
 }
 
-static void* transfer_threadproc(void* arg)
+/* The USB words from sample start on, start a multiple of 8 */
+static uint16_t* input_at(const airspy_device_t* device, uint16_t* input_samples, int start)
 {
-	airspy_device_t* device = (airspy_device_t*)arg;
-	int error;
-	struct timeval timeout = { 0, 500000 };
-
-#ifdef _WIN32
-
-	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
-
-#endif
+	return input_samples + (device->packing_enabled ? start / 8 * 6 : start);
+}
 
-	while (device->streaming && !device->stop_requested)
+/* Decimates count complex samples in place and returns how many are left */
+static int decimate_samples(airspy_device_t* device, void* samples, int count)
+{
+	if (device->sample_type == AIRSPY_SAMPLE_FLOAT32_IQ)
 	{
-		error = libusb_handle_events_timeout_completed(device->usb_context, &timeout, NULL);
-		if (error < 0)
-		{
-			if (error != LIBUSB_ERROR_INTERRUPTED)
-				device->streaming = false;
-		}
+		return decimator_float_process(device->dec_f, (float *) samples, count);
 	}
-	
-	device->streaming = false;
 
-	return NULL;
+	return decimator_int16_process(device->dec_i, (int16_t *) samples, count);
 }
 
-static int kill_io_threads(airspy_device_t* device)
+/*
+ * Runs each chunk of the buffer through the converter, the half-band IQ
+ * filter and the decimator while it is in L1, and only writes the decimated
+ * samples to dest, which then needs no room for the full rate samples.
+ */
+static int convert_decimated(airspy_device_t* device, uint16_t* input_samples, void* dest, int word_count)
 {
-	struct timeval timeout = { 0, 0 };
+	int start;
+	int words;
+	int count;
+	int produced = 0;
+	size_t size = sample_type_size(device->sample_type);
 
-	if (device->stop_requested)
+	for (start = 0; start < word_count; start += words)
 	{
-		device->stop_requested = false;
-		device->streaming = false;
-		cancel_transfers(device);
-
-		pthread_mutex_lock(&device->consumer_mp);
-		pthread_cond_signal(&device->consumer_cv);
-		pthread_mutex_unlock(&device->consumer_mp);
+		words = word_count - start < DECIMATION_CHUNK ? word_count - start : DECIMATION_CHUNK;
+		convert_range(device, input_at(device, input_samples, start), device->decimation_scratch, 0, words);
 
-		if (device->transfer_thread_running) {
-		    pthread_join(device->transfer_thread, NULL);
-		    device->transfer_thread_running = false;
+		if (device->sample_type == AIRSPY_SAMPLE_FLOAT32_IQ)
+		{
+			iqconverter_float_process(device->cnv_f, (float *) device->decimation_scratch, words);
 		}
-		if (device->consumer_thread_running) {
-		    pthread_join(device->consumer_thread, NULL);
-		    device->consumer_thread_running = false;
+		else
+		{
+			iqconverter_int16_process(device->cnv_i, (int16_t *) device->decimation_scratch, words);
 		}
 
-		libusb_handle_events_timeout_completed(device->usb_context, &timeout, NULL);
+		count = decimate_samples(device, device->decimation_scratch, words / 2);
+		memcpy((uint8_t *) dest + produced * size, device->decimation_scratch, count * size);
+		produced += count;
 	}
 
-	return AIRSPY_SUCCESS;
+	return produced;
 }
 
-static int create_io_threads(airspy_device_t* device, airspy_sample_block_cb_fn callback)
+/*
+ * Converts one USB buffer to the configured sample type into dest and returns
+ * the sample count. Packed buffers are unpacked, offset and scaled in one pass
+ * without an intermediate uint16 copy. For in place types *samples is set to
+ * the USB buffer itself and dest is not touched.
+ */
+static int convert_buffer(airspy_device_t* device, uint16_t* input_samples, void* dest, void** samples)
 {
-	int result;
-	pthread_attr_t attr;
-
-	if (!device->streaming && !device->stop_requested)
-	{
-		device->callback = callback;
-		device->streaming = true;
+	int sample_count = (int) buffer_word_count(device);
+	uint64_t start_ns = time_monotonic_ns();
 
-		result = prepare_transfers(device, LIBUSB_ENDPOINT_IN | 1, (libusb_transfer_cb_fn)airspy_libusb_transfer_callback);
-		if (result != AIRSPY_SUCCESS)
-		{
-			return result;
-		}
+	*samples = dest;
 
-		device->received_samples_queue_head = 0;
-		device->received_samples_queue_tail = 0;
-		device->received_buffer_count = 0;
+	if (sample_type_in_place(device))
+	{
+		*samples = input_samples;
+	}
+	else if (sample_decimation(device) > 1 && !device->conversion_active)
+	{
+		sample_count = convert_decimated(device, input_samples, dest, sample_count);
+	}
+	else if (sample_decimation(device) > 1)
+	{
+		/* The conversion team works on the full rate samples, which only fit the output buffer */
+		convert_parallel(device, input_samples, device->output_buffer, sample_count);
+		sample_count = decimate_samples(device, device->output_buffer, sample_count / 2);
+		if (dest != device->output_buffer)
+		{
+			memcpy(dest, device->output_buffer, sample_count * sample_type_size(device->sample_type));
+		}
+	}
+	else if (device->conversion_active)
+	{
+		convert_parallel(device, input_samples, dest, sample_count);
+	}
+	else
+	{
+		convert_range(device, input_samples, dest, 0, sample_count);
+
+		if (device->sample_type == AIRSPY_SAMPLE_FLOAT32_IQ)
+		{
+			iqconverter_float_process(device->cnv_f, (float *) dest, sample_count);
+		}
+		else if (device->sample_type == AIRSPY_SAMPLE_INT16_IQ)
+		{
+			iqconverter_int16_process(device->cnv_i, (int16_t *) dest, sample_count);
+		}
+	}
+
+	if (SAMPLE_TYPE_IS_IQ(device->sample_type) && sample_decimation(device) == 1)
+	{
+		sample_count /= 2;
+	}
+
+	record_timing(&device->stats.conversion, start_ns);
+
+	return sample_count;
+}
+
+static void run_callback(airspy_device_t* device, airspy_transfer_t* transfer)
+{
+	uint64_t start_ns = time_monotonic_ns();
+
+	if (device->callback(transfer) != 0)
+	{
+		device->streaming = false;
+	}
+	record_timing(&device->stats.callback, start_ns);
+}
+
+/* First sample of the block taken at or after time_ns, sample_count when none is */
+static int sample_at(const airspy_transfer_t* block, double ns_per_sample, uint64_t time_ns)
+{
+	double offset;
+	int sample;
+
+	if (time_ns <= block->timestamp_ns || ns_per_sample == 0.0)
+	{
+		return 0;
+	}
+
+	offset = (double) (time_ns - block->timestamp_ns) / ns_per_sample;
+	if (offset >= block->sample_count)
+	{
+		return block->sample_count;
+	}
+
+	sample = (int) offset;
+	return sample < offset ? sample + 1 : sample;
+}
+
+static void adopt_sweep_event(airspy_device_t* device, const sweep_event_t* event)
+{
+	device->sweep_tag_freq_hz = event->freq_hz;
+	device->sweep_tag_step = event->step;
+	device->sweep_tag_flags = AIRSPY_SWEEP_STEP;
+	device->sweep_settle_end_ns = event->settle_end_ns;
+}
+
+/* Delivers samples [start, end) of the block under the current sweep tags */
+static void deliver_part(airspy_device_t* device, airspy_transfer_t* block, int start, int end, double ns_per_sample, uint32_t flags)
+{
+	airspy_transfer_t part;
+	uint64_t offset_ns;
+
+	if (start >= end || !device->streaming)
+	{
+		return;
+	}
+
+	if ((flags & AIRSPY_SWEEP_SETTLING) && (device->sweep_flags & AIRSPY_SWEEP_DISCARD_SETTLING))
+	{
+		return;
+	}
+
+	offset_ns = (uint64_t) (start * ns_per_sample);
+
+	part = *block;
+	part.samples = (uint8_t*) block->samples + (size_t) start * sample_type_size(block->sample_type);
+	part.sample_count = end - start;
+	part.sample_index = block->sample_index + start;
+	part.timestamp_ns = block->timestamp_ns + offset_ns;
+	part.realtime_ns = block->realtime_ns + offset_ns;
+	part.freq_hz = device->sweep_tag_freq_hz;
+	part.sweep_step = device->sweep_tag_step;
+	part.sweep_flags = flags;
+	run_callback(device, &part);
+
+	/* Drops are reported once, ahead of the first part delivered */
+	block->dropped_samples = 0;
+}
+
+/*
+ * Hands a converted block to the callback. While sweep retunes are queued the
+ * block is split where a retune was requested and where it settled, mapping
+ * host times onto samples through the block timestamp and the sample rate.
+ */
+static void deliver_block(airspy_device_t* device, airspy_transfer_t* block)
+{
+	int slot;
+	int start = 0;
+	int end;
+	int settled;
+	bool split;
+	double ns_per_sample;
+
+	if (!device->sweep_tagging)
+	{
+		block->freq_hz = atomic_load_acquire(&device->freq_hz);
+		block->sweep_step = 0;
+		block->sweep_flags = 0;
+		if (spsc_ring_peek(&device->sweep_ring) < 0)
+		{
+			run_callback(device, block);
+			return;
+		}
+
+		device->sweep_tagging = true;
+		device->sweep_tag_freq_hz = block->freq_hz;
+		device->sweep_tag_step = 0;
+		device->sweep_tag_flags = 0;
+		device->sweep_settle_end_ns = 0;
+	}
+
+	ns_per_sample = 0.0;
+	if (device->raw_samplerate != 0)
+	{
+		ns_per_sample = (SAMPLE_TYPE_IS_IQ(device->sample_type) ? 2e9 : 1e9) * sample_decimation(device) / device->raw_samplerate;
+	}
+
+	/* Packed samples cannot be cut at an arbitrary sample */
+	split = !(device->sample_type == AIRSPY_SAMPLE_RAW && device->packing_enabled);
+
+	while (start < block->sample_count && device->streaming)
+	{
+		end = block->sample_count;
+		slot = spsc_ring_peek(&device->sweep_ring);
+		if (slot >= 0)
+		{
+			end = sample_at(block, ns_per_sample, device->sweep_events[slot].start_ns);
+			if (end <= start)
+			{
+				adopt_sweep_event(device, &device->sweep_events[slot]);
+				spsc_ring_release(&device->sweep_ring);
+				continue;
+			}
+		}
+
+		settled = sample_at(block, ns_per_sample, device->sweep_settle_end_ns);
+		if (!split)
+		{
+			/* Tags of the first sample, then the retunes that begin inside the block take over */
+			deliver_part(device, block, 0, block->sample_count, ns_per_sample,
+				device->sweep_tag_flags | (settled > 0 || end < block->sample_count ? AIRSPY_SWEEP_SETTLING : 0));
+			while ((slot = spsc_ring_peek(&device->sweep_ring)) >= 0 &&
+				sample_at(block, ns_per_sample, device->sweep_events[slot].start_ns) < block->sample_count)
+			{
+				adopt_sweep_event(device, &device->sweep_events[slot]);
+				spsc_ring_release(&device->sweep_ring);
+			}
+			break;
+		}
+
+		settled = settled < start ? start : settled > end ? end : settled;
+		deliver_part(device, block, start, settled, ns_per_sample, device->sweep_tag_flags | AIRSPY_SWEEP_SETTLING);
+		deliver_part(device, block, settled, end, ns_per_sample, device->sweep_tag_flags);
+		start = end;
+	}
+
+	/* Plain blocks again once the sweep stopped and its last step settled */
+	if (!device->sweep_running && spsc_ring_peek(&device->sweep_ring) < 0 &&
+		sample_at(block, ns_per_sample, device->sweep_settle_end_ns) < block->sample_count)
+	{
+		device->sweep_tagging = false;
+	}
+}
+
+/*
+ * Converts the buffer in a filled ring slot, hands it to the callback and
+ * gives the slot back. pool_buffer is the block to convert into when the pool
+ * is active. Returns false once the stream has to stop.
+ */
+static bool consume_slot(airspy_device_t* device, int slot, void* pool_buffer)
+{
+	int sample_count;
+	uint32_t dropped_buffers;
+	airspy_transfer_t transfer;
+
+	dropped_buffers = device->dropped_buffers_queue[slot];
+	transfer.sample_index = device->sample_index_queue[slot];
+	transfer.timestamp_ns = device->timestamp_queue[slot];
+	transfer.realtime_ns = transfer.timestamp_ns + device->realtime_offset_ns;
+	transfer.gain_state = device->gain_state_queue[slot];
+
+	if (device->pool_active)
+	{
+		sample_count = convert_buffer(device, device->received_samples_queue[slot], pool_buffer, &transfer.samples);
+		if (transfer.samples != pool_buffer)
+		{
+			memcpy(pool_buffer, transfer.samples, device->buffer_size);
+			transfer.samples = pool_buffer;
+		}
+
+		/* The block no longer refers to the USB buffer */
+		spsc_ring_release(&device->received_ring);
+	}
+	else
+	{
+		sample_count = convert_buffer(device, device->received_samples_queue[slot], device->output_buffer, &transfer.samples);
+	}
+
+	transfer.device = device;
+	transfer.ctx = device->ctx;
+	transfer.sample_count = sample_count;
+	transfer.sample_type = device->sample_type;
+	transfer.dropped_samples = (uint64_t) dropped_buffers * (uint64_t) sample_count;
+	if (SAMPLE_TYPE_IS_IQ(device->sample_type))
+	{
+		transfer.sample_index /= 2 * sample_decimation(device);
+	}
+
+	deliver_block(device, &transfer);
+	device->stats.buffers_delivered++;
+
+	if (device->pool_active)
+	{
+		/* The block stays out of the pool while the application retains it */
+		buffer_pool_release(&device->pool, pool_buffer);
+	}
+	else
+	{
+		/* The slot, and the buffer it holds, go back to the producer */
+		spsc_ring_release(&device->received_ring);
+	}
+
+	return device->streaming;
+}
+
+static void* consumer_threadproc(void *arg)
+{
+	int slot;
+	void* pool_buffer = NULL;
+	airspy_device_t* device = (airspy_device_t*)arg;
+
+#ifdef _WIN32
+
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+#endif
+
+	while (device->streaming && !device->stop_requested)
+	{
+		slot = spsc_ring_wait(&device->received_ring, NULL);
+		if (slot < 0 || !device->streaming || device->stop_requested)
+		{
+			break;
+		}
+
+		if (device->pool_active)
+		{
+			/* Every buffer still held by the application: wait, the ring absorbs the backlog */
+			pool_buffer = buffer_pool_acquire(&device->pool);
+			if (pool_buffer == NULL)
+			{
+				break;
+			}
+		}
+
+		if (!consume_slot(device, slot, pool_buffer))
+		{
+			break;
+		}
+	}
+
+	device->streaming = false;
+
+	return NULL;
+}
+
+/*
+ * A worker must not wait for the application, it would stall every device on
+ * the context. With no free buffer the slot stays queued and the starved flag
+ * is raised; airspy_release_samples() reschedules the device when it sees the
+ * flag, and the retry after raising it catches a release that came before.
+ * Further USB buffers back up in the ring and are dropped once it is full.
+ */
+static void* acquire_pool_buffer_nowait(airspy_device_t* device)
+{
+	void* pool_buffer;
+
+	pool_buffer = buffer_pool_try_acquire(&device->pool);
+	if (pool_buffer == NULL)
+	{
+		atomic_store_seq_cst(&device->pool_starved, 1);
+		pool_buffer = buffer_pool_try_acquire(&device->pool);
+		if (pool_buffer == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	atomic_store_release(&device->pool_starved, 0);
+
+	return pool_buffer;
+}
+
+/* Shared context worker batch: at most one queue's worth, so other devices get their turn */
+static void consume_batch(void* arg)
+{
+	int slot;
+	uint32_t i;
+	void* pool_buffer = NULL;
+	airspy_device_t* device = (airspy_device_t*)arg;
+
+	for (i = 0; i < device->queue_depth && device->streaming && !device->stop_requested; i++)
+	{
+		slot = spsc_ring_peek(&device->received_ring);
+		if (slot < 0)
+		{
+			break;
+		}
+
+		if (device->pool_active)
+		{
+			pool_buffer = acquire_pool_buffer_nowait(device);
+			if (pool_buffer == NULL)
+			{
+				break;
+			}
+		}
+
+		if (!consume_slot(device, slot, pool_buffer))
+		{
+			device->streaming = false;
+			break;
+		}
+	}
+}
+
+static int consume_pending(void* arg)
+{
+	airspy_device_t* device = (airspy_device_t*)arg;
+
+	/* A starved device waits for a release or the next USB buffer to be scheduled again */
+	return device->streaming && !device->stop_requested && !atomic_load_acquire(&device->pool_starved) &&
+		spsc_ring_peek(&device->received_ring) >= 0;
+}
+
+/* Called with gain_mutex held */
+static void publish_gain_word(airspy_device_t* device)
+{
+	uint32_t word;
+
+	word = (uint32_t) device->gain_values[GAIN_FIELD_LNA] |
+		((uint32_t) device->gain_values[GAIN_FIELD_MIXER] << 4) |
+		((uint32_t) device->gain_values[GAIN_FIELD_VGA] << 8);
+	if (device->gain_values[GAIN_FIELD_LNA_AGC])
+	{
+		word |= AIRSPY_GAIN_STATE_LNA_AGC;
+	}
+	if (device->gain_values[GAIN_FIELD_MIXER_AGC])
+	{
+		word |= AIRSPY_GAIN_STATE_MIXER_AGC;
+	}
+	if (device->gain_known != (1 << GAIN_FIELD_COUNT) - 1)
+	{
+		word |= AIRSPY_GAIN_STATE_UNKNOWN;
+	}
+	if (device->gain_changes_pending != 0)
+	{
+		word |= GAIN_WORD_PENDING;
+	}
+	word |= ((device->gain_word >> GAIN_WORD_COUNTER_SHIFT) + 1) << GAIN_WORD_COUNTER_SHIFT;
+
+	atomic_store_release(&device->gain_word, word);
+}
+
+static void begin_gain_change(airspy_device_t* device)
+{
+	pthread_mutex_lock(&device->gain_mutex);
+	device->gain_changes_pending++;
+	publish_gain_word(device);
+	pthread_mutex_unlock(&device->gain_mutex);
+}
+
+/* A failed update leaves the register in doubt until it is set again */
+static void end_gain_change(airspy_device_t* device, int field, uint8_t value, bool applied)
+{
+	pthread_mutex_lock(&device->gain_mutex);
+	device->gain_changes_pending--;
+	if (applied)
+	{
+		device->gain_values[field] = value;
+		device->gain_known |= 1 << field;
+	}
+	else
+	{
+		device->gain_known &= ~(1 << field);
+	}
+	publish_gain_word(device);
+	pthread_mutex_unlock(&device->gain_mutex);
+}
+
+/*
+ * Gain state of the block that just completed: flagged as changing when an
+ * update was in flight or finished since the previous block. Only called from
+ * the USB callback, which owns gain_word_seen.
+ */
+static uint32_t block_gain_state(airspy_device_t* device)
+{
+	uint32_t word = atomic_load_acquire(&device->gain_word);
+	uint32_t state = word & GAIN_WORD_STATE_MASK;
+
+	if ((word | device->gain_word_seen) & GAIN_WORD_PENDING ||
+		(word >> GAIN_WORD_COUNTER_SHIFT) != (device->gain_word_seen >> GAIN_WORD_COUNTER_SHIFT))
+	{
+		state |= AIRSPY_GAIN_STATE_CHANGING;
+	}
+	device->gain_word_seen = word;
+
+	return state;
+}
+
+static void airspy_libusb_transfer_callback(struct libusb_transfer* usb_transfer)
+{
+	int slot;
+	uint16_t *temp;
+	double timestamp;
+	uint64_t sample_index;
+	uint32_t gain_state;
+	uint64_t now = time_monotonic_ns();
+	airspy_device_t* device = (airspy_device_t*)usb_transfer->user_data;
+
+	atomic_add_fetch(&device->transfers_in_flight, (uint32_t) -1);
+
+	if (!device->streaming || device->stop_requested)
+	{
+		return;
+	}
+
+	if (usb_transfer->status == LIBUSB_TRANSFER_COMPLETED && usb_transfer->actual_length == usb_transfer->length)
+	{
+		/* Dropped buffers still advance the sample counter and the clock */
+		device->stats.transfers_completed++;
+
+		sample_index = device->sample_counter;
+		device->sample_counter += buffer_word_count(device);
+		gain_state = block_gain_state(device);
+		timestamp = time_filter_update(&device->time_filter, (double) (int64_t) (now - device->clock_base_ns) * 1e-9);
+
+		/*
+		 * Never blocks: the filled buffer is swapped into a free slot of the
+		 * ring, and the consumer is only signalled when it is parked.
+		 */
+		slot = spsc_ring_acquire(&device->received_ring);
+		if (slot >= 0)
+		{
+			temp = device->received_samples_queue[slot];
+			device->received_samples_queue[slot] = (uint16_t *)usb_transfer->buffer;
+			usb_transfer->buffer = (uint8_t *)temp;
+
+			device->dropped_buffers_queue[slot] = device->dropped_buffers;
+			device->dropped_buffers = 0;
+
+			device->sample_index_queue[slot] = sample_index;
+			device->timestamp_queue[slot] = device->clock_base_ns + (int64_t) (timestamp * 1e9);
+			device->gain_state_queue[slot] = gain_state;
+
+			spsc_ring_publish(&device->received_ring);
+
+			/* On a shared context the consumer work runs on the worker pool */
+			if (device->context != NULL && device->callback != NULL)
+			{
+				work_pool_schedule(&device->context->workers, &device->work);
+			}
+
+			if (spsc_ring_count(&device->received_ring) > device->stats.queue_high_water)
+			{
+				device->stats.queue_high_water = spsc_ring_count(&device->received_ring);
+			}
+		}
+		else
+		{
+			device->dropped_buffers++;
+			device->stats.buffers_dropped++;
+		}
+
+		/* A replayed capture refills the transfer from its own thread */
+		if (device->file == NULL)
+		{
+			atomic_add_fetch(&device->transfers_in_flight, 1);
+			if (libusb_submit_transfer(usb_transfer) != 0)
+			{
+				atomic_add_fetch(&device->transfers_in_flight, (uint32_t) -1);
+				device->streaming = false;
+				spsc_ring_close(&device->received_ring);
+			}
+			else
+			{
+				device->stats.transfers_resubmitted++;
+			}
+		}
+
+		record_timing(&device->stats.completion, now);
+	}
+	else
+	{
+		device->stats.transfers_failed++;
+		device->streaming = false;
+		spsc_ring_close(&device->received_ring);
+	}
+}
+
+static void* transfer_threadproc(void* arg)
+{
+	airspy_device_t* device = (airspy_device_t*)arg;
+	int error;
+	struct timeval timeout = { 0, 500000 };
+
+#ifdef _WIN32
+
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+#endif
+
+	while (device->streaming && !device->stop_requested)
+	{
+		error = libusb_handle_events_timeout_completed(device->usb_context, &timeout, NULL);
+		if (error < 0)
+		{
+			if (error != LIBUSB_ERROR_INTERRUPTED)
+				device->streaming = false;
+		}
+	}
+	
+	device->streaming = false;
+
+	/* Wakes a consumer or pull mode reader parked on an empty queue */
+	spsc_ring_close(&device->received_ring);
+
+	return NULL;
+}
+
+/* Runs until the context is destroyed; an error on one device must not stop the others */
+static void* event_loop_threadproc(void* arg)
+{
+	airspy_event_loop_t* event_loop = (airspy_event_loop_t*)arg;
+	struct timeval timeout = { 0, 500000 };
+
+#ifdef _WIN32
+
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+#endif
+
+	while (event_loop->context->running)
+	{
+		libusb_handle_events_timeout_completed(event_loop->usb_context, &timeout, NULL);
+	}
+
+	return NULL;
+}
+
+static void sleep_ms(int milliseconds)
+{
+#ifdef _WIN32
+	Sleep(milliseconds);
+#else
+	usleep(milliseconds * 1000);
+#endif
+}
+
+/* Sleeps until deadline_ns in slices, so that clearing running is seen promptly */
+static void sleep_until_ns(volatile bool* running, uint64_t deadline_ns)
+{
+	uint64_t now_ns;
+	uint64_t remaining_us;
+
+	while (*running)
+	{
+		now_ns = time_monotonic_ns();
+		if (now_ns >= deadline_ns)
+		{
+			break;
+		}
+
+		remaining_us = (deadline_ns - now_ns + 999) / 1000;
+		if (remaining_us > SLEEP_SLICE_US)
+		{
+			remaining_us = SLEEP_SLICE_US;
+		}
+
+#ifdef _WIN32
+		Sleep((DWORD) ((remaining_us + 999) / 1000));
+#else
+		usleep((useconds_t) remaining_us);
+#endif
+	}
+}
+
+/* Reads length bytes of the capture, from its start again at the end when looping */
+static size_t read_capture(airspy_device_t* device, uint8_t* buffer, size_t length)
+{
+	size_t total = 0;
+	size_t count;
+	bool rewound = false;
+
+	while (total < length)
+	{
+		count = fread(buffer + total, 1, length - total, device->file);
+		total += count;
+		if (count != 0)
+		{
+			rewound = false;
+		}
+		else if (rewound || !(device->file_flags & AIRSPY_FILE_LOOP) || fseek(device->file, 0, SEEK_SET) != 0)
+		{
+			break;
+		}
+		else
+		{
+			rewound = true;
+		}
+	}
+
+	return total;
+}
+
+/*
+ * Stands in for the USB event thread of a replayed capture: fills the first
+ * transfer from the file, paced at the replay rate or else the ADC word rate
+ * unless AIRSPY_FILE_FAST, and completes it through the USB callback, which
+ * swaps its buffer into the queue as for a receiver. At the end of the capture the queue is drained
+ * before the stream ends.
+ */
+static void* file_threadproc(void* arg)
+{
+	airspy_device_t* device = (airspy_device_t*)arg;
+	struct libusb_transfer* usb_transfer = device->transfers[0];
+	uint64_t start_ns = time_monotonic_ns();
+	uint64_t word_count = 0;
+	uint32_t rate = device->replay_rate != 0 ? device->replay_rate : device->raw_samplerate;
+
+	while (device->streaming && !device->stop_requested)
+	{
+		if (!(device->file_flags & AIRSPY_FILE_FAST) && rate != 0)
+		{
+			sleep_until_ns(&device->streaming, start_ns + (uint64_t) ((double) word_count * 1e9 / rate));
+		}
+
+		if (read_capture(device, usb_transfer->buffer, (size_t) usb_transfer->length) != (size_t) usb_transfer->length)
+		{
+			while (device->streaming && !device->stop_requested && spsc_ring_count(&device->received_ring) != 0)
+			{
+				sleep_ms(1);
+			}
+			break;
+		}
+		word_count += buffer_word_count(device);
+
+		usb_transfer->status = LIBUSB_TRANSFER_COMPLETED;
+		usb_transfer->actual_length = usb_transfer->length;
+		atomic_add_fetch(&device->transfers_in_flight, 1);
+		airspy_libusb_transfer_callback(usb_transfer);
+	}
+
+	device->streaming = false;
+	spsc_ring_close(&device->received_ring);
+
+	return NULL;
+}
+
+/*
+ * Retunes at every step boundary and queues, for the consumer, when each
+ * retune was requested and when it settles. The next boundary is counted from
+ * the completion of the retune, so a slow one delays the rest of the sweep
+ * instead of shortening the step.
+ */
+static void* sweep_threadproc(void* arg)
+{
+	airspy_device_t* device = (airspy_device_t*)arg;
+	const airspy_sweep_step_t* step;
+	sweep_event_t* event;
+	uint32_t index = 0;
+	uint64_t next_ns = time_monotonic_ns();
+	uint64_t start_ns;
+	uint64_t done_ns;
+	int slot = -1;
+	int result;
+
+	while (device->sweep_running && device->streaming)
+	{
+		/* A full ring means the consumer is behind: wait rather than lose a boundary */
+		slot = spsc_ring_acquire(&device->sweep_ring);
+		if (slot < 0)
+		{
+			sleep_ms(1);
+			continue;
+		}
+
+		sleep_until_ns(&device->sweep_running, next_ns);
+		if (!device->sweep_running)
+		{
+			break;
+		}
+
+		step = &device->sweep_steps[index];
+		start_ns = time_monotonic_ns();
+		result = airspy_set_freq(device, step->freq_hz);
+		done_ns = time_monotonic_ns();
+
+		/* A failed retune leaves the tuner unknown until the next one */
+		event = &device->sweep_events[slot];
+		event->start_ns = start_ns;
+		event->settle_end_ns = result == AIRSPY_SUCCESS ? done_ns + (uint64_t) step->settle_us * 1000 : UINT64_MAX;
+		event->freq_hz = result == AIRSPY_SUCCESS ? step->freq_hz : 0;
+		event->step = index;
+		spsc_ring_publish(&device->sweep_ring);
+
+		next_ns = done_ns + ((uint64_t) step->settle_us + step->dwell_us) * 1000;
+
+		if (++index == device->sweep_step_count)
+		{
+			if (device->sweep_flags & AIRSPY_SWEEP_ONCE)
+			{
+				break;
+			}
+			index = 0;
+		}
+	}
+
+	device->sweep_running = false;
+
+	return NULL;
+}
+
+/* The shared event loop keeps running, so cancelled transfers are reaped there */
+static void wait_transfers(airspy_device_t* device)
+{
+	int i;
+
+	for (i = 0; i < TRANSFER_DRAIN_TIMEOUT_MS && atomic_load_acquire(&device->transfers_in_flight) != 0; i++)
+	{
+		sleep_ms(1);
+	}
+}
+
+/*
+ * Keeps the register shadows in step with a request that went to the device,
+ * synchronous or not. Register reads and writes carry the register in wIndex
+ * and a written value in wValue; firmware commands that reprogram the chips
+ * drop what they may have changed, even when they failed half way. The tuned
+ * frequency that tags blocks is kept the same way, unknown after a failure.
+ */
+static void track_registers(airspy_device_t* device, uint8_t request, uint16_t value, uint16_t index, const uint8_t* data, bool completed)
+{
+	uint32_t freq_hz = 0;
+
+	pthread_mutex_lock(&device->register_mutex);
+
+	switch (request)
+	{
+	case AIRSPY_R820T_READ:
+	case AIRSPY_R820T_WRITE:
+		if (completed)
+		{
+			register_shadow_set(&device->r820t_shadow, (uint8_t) index, request == AIRSPY_R820T_READ ? data[0] : (uint8_t) value);
+		}
+		else
+		{
+			register_shadow_invalidate(&device->r820t_shadow, (uint8_t) index);
+		}
+		break;
+
+	case AIRSPY_SI5351C_READ:
+	case AIRSPY_SI5351C_WRITE:
+		if (completed)
+		{
+			register_shadow_set(&device->si5351c_shadow, (uint8_t) index, request == AIRSPY_SI5351C_READ ? data[0] : (uint8_t) value);
+		}
+		else
+		{
+			register_shadow_invalidate(&device->si5351c_shadow, (uint8_t) index);
+		}
+		break;
+
+	case AIRSPY_SET_LNA_GAIN:
+	case AIRSPY_SET_LNA_AGC:
+		register_shadow_invalidate(&device->r820t_shadow, R820T_LNA_GAIN_REGISTER);
+		break;
+
+	case AIRSPY_SET_MIXER_GAIN:
+	case AIRSPY_SET_MIXER_AGC:
+		register_shadow_invalidate(&device->r820t_shadow, R820T_MIXER_GAIN_REGISTER);
+		break;
+
+	case AIRSPY_SET_VGA_GAIN:
+		register_shadow_invalidate(&device->r820t_shadow, R820T_VGA_GAIN_REGISTER);
+		break;
+
+	case AIRSPY_SET_FREQ:
+		register_shadow_invalidate_all(&device->r820t_shadow);
+		if (completed)
+		{
+			memcpy(&freq_hz, data, sizeof(freq_hz));
+			freq_hz = TO_LE(freq_hz);
+		}
+		atomic_store_release(&device->freq_hz, freq_hz);
+		break;
+
+	case AIRSPY_SET_SAMPLERATE:
+	case AIRSPY_RECEIVER_MODE:
+		register_shadow_invalidate_all(&device->r820t_shadow);
+		register_shadow_invalidate_all(&device->si5351c_shadow);
+		break;
+
+	default:
+		break;
+	}
+
+	pthread_mutex_unlock(&device->register_mutex);
+}
+
+/*
+ * A replayed capture has no control endpoint: every request succeeds without
+ * effect and reads return zeros, apart from the version string. The sample
+ * rate list is left unanswered so that the open falls back on the standard one.
+ */
+static int emulate_control(uint8_t request_type, uint8_t request, unsigned char* data, uint16_t length)
+{
+	static const char version[] = "AirSpy file replay";
+
+	if ((request_type & LIBUSB_ENDPOINT_IN) == 0)
+	{
+		return length;
+	}
+
+	memset(data, 0, length);
+
+	switch (request)
+	{
+	case AIRSPY_GET_SAMPLERATES:
+		return 0;
+
+	case AIRSPY_VERSION_STRING_READ:
+		memcpy(data, version, length < sizeof(version) ? length : sizeof(version));
+		break;
+
+	default:
+		break;
+	}
+
+	return length;
+}
+
+static int control_transfer(airspy_device_t* device, uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
+	unsigned char* data, uint16_t length, unsigned int timeout)
+{
+	if (device->file != NULL)
+	{
+		return emulate_control(request_type, request, data, length);
+	}
+
+	return libusb_control_transfer(device->usb_device, request_type, request, value, index, data, length, timeout);
+}
+
+/* One async control request, its setup packet and data follow in the same allocation */
+typedef struct control_request
+{
+	airspy_device_t* device;
+	airspy_control_cb_fn callback;
+	void* ctx;
+	uint8_t request;
+	uint16_t value;
+	uint16_t index;
+	uint16_t length;
+	/* Where IN data goes, NULL to drop it */
+	void* read_data;
+	/* Gain requests carry the value in wIndex */
+	int gain_field;
+	uint8_t gain_value;
+} control_request_t;
+
+/* Wakes airspy_wait_controls() and airspy_set_gains() waiters */
+static void finish_control(airspy_device_t* device)
+{
+	pthread_mutex_lock(&device->control_mutex);
+	device->controls_in_flight--;
+	pthread_cond_broadcast(&device->control_cond);
+	pthread_mutex_unlock(&device->control_mutex);
+}
+
+static void control_transfer_callback(struct libusb_transfer* usb_transfer)
+{
+	control_request_t* request = (control_request_t*)usb_transfer->user_data;
+	airspy_device_t* device = request->device;
+	int result = AIRSPY_SUCCESS;
+
+	if (usb_transfer->status != LIBUSB_TRANSFER_COMPLETED || usb_transfer->actual_length < request->length)
+	{
+		result = AIRSPY_ERROR_LIBUSB;
+	}
+
+	if (result == AIRSPY_SUCCESS && request->read_data != NULL)
+	{
+		memcpy(request->read_data, libusb_control_transfer_get_data(usb_transfer), request->length);
+	}
+
+	track_registers(device, request->request, request->value, request->index,
+		libusb_control_transfer_get_data(usb_transfer), result == AIRSPY_SUCCESS);
+
+	if (request->gain_field != GAIN_FIELD_NONE)
+	{
+		end_gain_change(device, request->gain_field, request->gain_value, result == AIRSPY_SUCCESS);
+	}
+
+	if (request->callback != NULL)
+	{
+		request->callback(device, result, request->ctx);
+	}
+
+	libusb_free_transfer(usb_transfer);
+	free(request);
+
+	finish_control(device);
+}
+
+/* Runs the events of a private libusb context while async control requests are in flight */
+static void* control_threadproc(void* arg)
+{
+	airspy_device_t* device = (airspy_device_t*)arg;
+	struct timeval timeout = { 0, 100000 };
+
+	pthread_mutex_lock(&device->control_mutex);
+	for (;;)
+	{
+		while (!device->control_stopping && device->controls_in_flight == 0)
+		{
+			pthread_cond_wait(&device->control_cond, &device->control_mutex);
+		}
+		if (device->controls_in_flight == 0)
+		{
+			break;
+		}
+		pthread_mutex_unlock(&device->control_mutex);
+
+		libusb_handle_events_timeout_completed(device->usb_context, &timeout, NULL);
+
+		pthread_mutex_lock(&device->control_mutex);
+	}
+	pthread_mutex_unlock(&device->control_mutex);
+
+	return NULL;
+}
+
+/*
+ * Queues a vendor request on the control endpoint and returns without waiting
+ * for it, so requests issued back to back are pipelined by the host controller.
+ * OUT data is copied at once; IN data is copied to data on completion, which
+ * must stay valid until then, or dropped when data is NULL.
+ */
+static int submit_control(airspy_device_t* device, uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
+	void* data, uint16_t length, int gain_field, airspy_control_cb_fn callback, void* ctx)
+{
+	control_request_t* control;
+	struct libusb_transfer* usb_transfer;
+	unsigned char* buffer;
+
+	pthread_mutex_lock(&device->control_mutex);
+	if (device->controls_in_flight >= MAX_CONTROLS_IN_FLIGHT)
+	{
+		pthread_mutex_unlock(&device->control_mutex);
+		return AIRSPY_ERROR_BUSY;
+	}
+
+	/* A shared context runs its event loops anyway, a replayed capture needs none */
+	if (device->context == NULL && device->file == NULL && !device->control_thread_running)
+	{
+		if (pthread_create(&device->control_thread, NULL, control_threadproc, device) != 0)
+		{
+			pthread_mutex_unlock(&device->control_mutex);
+			return AIRSPY_ERROR_THREAD;
+		}
+		device->control_thread_running = true;
+		thread_params_apply(device->control_thread, &device->thread_params[AIRSPY_THREAD_EVENT], "airspy-ctl", -1);
+	}
+
+	device->controls_in_flight++;
+	pthread_cond_broadcast(&device->control_cond);
+	pthread_mutex_unlock(&device->control_mutex);
+
+	control = (control_request_t*)malloc(sizeof(control_request_t) + LIBUSB_CONTROL_SETUP_SIZE + length);
+	usb_transfer = libusb_alloc_transfer(0);
+	if (control == NULL || usb_transfer == NULL)
+	{
+		free(control);
+		libusb_free_transfer(usb_transfer);
+		finish_control(device);
+		return AIRSPY_ERROR_NO_MEM;
+	}
+
+	control->device = device;
+	control->callback = callback;
+	control->ctx = ctx;
+	control->request = request;
+	control->value = value;
+	control->index = index;
+	control->length = length;
+	control->read_data = (request_type & LIBUSB_ENDPOINT_IN) ? data : NULL;
+	control->gain_field = gain_field;
+	control->gain_value = (uint8_t) index;
+
+	if (gain_field != GAIN_FIELD_NONE)
+	{
+		begin_gain_change(device);
+	}
+
+	buffer = (unsigned char*)(control + 1);
+	libusb_fill_control_setup(buffer, request_type, request, value, index, length);
+	if (length != 0 && (request_type & LIBUSB_ENDPOINT_IN) == 0)
+	{
+		memcpy(buffer + LIBUSB_CONTROL_SETUP_SIZE, data, length);
+	}
+	libusb_fill_control_transfer(usb_transfer, device->usb_device, buffer, control_transfer_callback, control, LIBUSB_CTRL_TIMEOUT_MS);
+
+	/* Completes before returning, on the calling thread */
+	if (device->file != NULL)
+	{
+		usb_transfer->status = LIBUSB_TRANSFER_COMPLETED;
+		usb_transfer->actual_length = emulate_control(request_type, request, buffer + LIBUSB_CONTROL_SETUP_SIZE, length);
+		control_transfer_callback(usb_transfer);
+		return AIRSPY_SUCCESS;
+	}
+
+	if (libusb_submit_transfer(usb_transfer) != 0)
+	{
+		if (gain_field != GAIN_FIELD_NONE)
+		{
+			end_gain_change(device, gain_field, (uint8_t) index, false);
+		}
+		libusb_free_transfer(usb_transfer);
+		free(control);
+		finish_control(device);
+		return AIRSPY_ERROR_LIBUSB;
+	}
+
+	return AIRSPY_SUCCESS;
+}
+
+/* Async requests issued by one synchronous call, completed on the event thread */
+typedef struct control_batch
+{
+	volatile uint32_t remaining;
+	volatile uint32_t failed;
+} control_batch_t;
+
+static void control_batch_done(airspy_device_t* device, int result, void* ctx)
+{
+	control_batch_t* batch = (control_batch_t*)ctx;
+
+	(void) device;
+
+	if (result != AIRSPY_SUCCESS)
+	{
+		batch->failed = 1;
+	}
+	atomic_add_fetch(&batch->remaining, (uint32_t) -1);
+}
+
+/* Waits until no more than pending requests of the batch are in flight */
+static void wait_control_batch(airspy_device_t* device, control_batch_t* batch, uint32_t pending)
+{
+	pthread_mutex_lock(&device->control_mutex);
+	while (atomic_load_acquire(&batch->remaining) > pending)
+	{
+		pthread_cond_wait(&device->control_cond, &device->control_mutex);
+	}
+	pthread_mutex_unlock(&device->control_mutex);
+}
+
+/*
+ * Sends the registers of gains that do not already hold the requested value,
+ * AGC first, all pipelined, and waits for them: the tuner runs at a mixed
+ * gain for one round trip instead of one per register.
+ */
+static int apply_gains(airspy_device_t* device, const uint8_t values[GAIN_FIELD_COUNT])
+{
+	static const uint8_t requests[GAIN_FIELD_COUNT] =
+	{
+		AIRSPY_SET_MIXER_AGC, AIRSPY_SET_LNA_AGC, AIRSPY_SET_VGA_GAIN, AIRSPY_SET_MIXER_GAIN, AIRSPY_SET_LNA_GAIN
+	};
+	int field;
+	int result = AIRSPY_SUCCESS;
+	uint32_t changed = 0;
+	control_batch_t batch;
+
+	pthread_mutex_lock(&device->gain_mutex);
+	for (field = 0; field < GAIN_FIELD_COUNT; field++)
+	{
+		if (!(device->gain_known & (1 << field)) || device->gain_values[field] != values[field])
+		{
+			changed |= 1 << field;
+		}
+	}
+	pthread_mutex_unlock(&device->gain_mutex);
+
+	batch.remaining = 0;
+	batch.failed = 0;
+
+	for (field = 0; field < GAIN_FIELD_COUNT && changed != 0; field++)
+	{
+		if (!(changed & (1 << field)))
+		{
+			continue;
+		}
+
+		atomic_add_fetch(&batch.remaining, 1);
+		result = submit_control(device,
+			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			requests[field], 0, values[field], NULL, 1, field, control_batch_done, &batch);
+		if (result != AIRSPY_SUCCESS)
+		{
+			atomic_add_fetch(&batch.remaining, (uint32_t) -1);
+			break;
+		}
+	}
+
+	wait_control_batch(device, &batch, 0);
+
+	if (result == AIRSPY_SUCCESS && batch.failed)
+	{
+		result = AIRSPY_ERROR_LIBUSB;
+	}
+
+	return result;
+}
+
+/*
+ * Reads every cacheable register of one chip, pipelined in windows of
+ * REGISTER_REFRESH_WINDOW requests; each completion fills the shadow.
+ */
+static int refresh_shadow(airspy_device_t* device, register_shadow_t* shadow, uint8_t request, control_batch_t* batch)
+{
+	uint32_t reg;
+	int result;
+
+	for (reg = 0; reg < shadow->count; reg++)
+	{
+		if (!register_shadow_cacheable(shadow, (uint8_t) reg))
+		{
+			continue;
+		}
+
+		wait_control_batch(device, batch, REGISTER_REFRESH_WINDOW - 1);
+
+		atomic_add_fetch(&batch->remaining, 1);
+		result = submit_control(device,
+			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			request, 0, (uint16_t) reg, NULL, 1, GAIN_FIELD_NONE, control_batch_done, batch);
+		if (result != AIRSPY_SUCCESS)
+		{
+			atomic_add_fetch(&batch->remaining, (uint32_t) -1);
+			return result;
+		}
+	}
+
+	return AIRSPY_SUCCESS;
+}
+
+/* Requests in flight complete or time out within LIBUSB_CTRL_TIMEOUT_MS */
+static void stop_controls(airspy_device_t* device)
+{
+	pthread_mutex_lock(&device->control_mutex);
+	while (device->controls_in_flight != 0)
+	{
+		pthread_cond_wait(&device->control_cond, &device->control_mutex);
+	}
+	device->control_stopping = true;
+	pthread_cond_broadcast(&device->control_cond);
+	pthread_mutex_unlock(&device->control_mutex);
+
+	if (device->control_thread_running)
+	{
+		pthread_join(device->control_thread, NULL);
+		device->control_thread_running = false;
+	}
+
+	pthread_cond_destroy(&device->control_cond);
+	pthread_mutex_destroy(&device->control_mutex);
+}
+
+static int kill_io_threads(airspy_device_t* device)
+{
+	struct timeval timeout = { 0, 0 };
+
+	if (device->stop_requested)
+	{
+		device->stop_requested = false;
+		device->streaming = false;
+		cancel_transfers(device);
+
+		spsc_ring_close(&device->received_ring);
+		if (device->pool_active)
+		{
+			buffer_pool_close(&device->pool);
+		}
+
+		if (device->context != NULL)
+		{
+			work_pool_cancel(&device->context->workers, &device->work);
+			wait_transfers(device);
+			return AIRSPY_SUCCESS;
+		}
+
+		if (device->transfer_thread_running) {
+		    pthread_join(device->transfer_thread, NULL);
+		    device->transfer_thread_running = false;
+		}
+		if (device->consumer_thread_running) {
+		    pthread_join(device->consumer_thread, NULL);
+		    device->consumer_thread_running = false;
+		}
+
+		if (device->file == NULL)
+		{
+			libusb_handle_events_timeout_completed(device->usb_context, &timeout, NULL);
+		}
+	}
+
+	return AIRSPY_SUCCESS;
+}
+
+/*
+ * Pull mode reader. A converted buffer that does not fit in what is left of
+ * the caller's buffer is parked in output_buffer (or, for in place types, in
+ * its ring slot) and handed out by the next reads, so samples are copied at
+ * most once and whole buffers are converted straight into the caller's memory.
+ */
+static int read_samples(airspy_device_t* device, void* buffer, int sample_count, const struct timespec* deadline, bool blocking)
+{
+	int n;
+	int slot;
+	int done = 0;
+	int block_count;
+	size_t size;
+	void* samples;
+	uint8_t* dest = (uint8_t*) buffer;
+
+	if (buffer == NULL || sample_count < 0)
+	{
+		return AIRSPY_ERROR_INVALID_PARAM;
+	}
+
+	if (device->callback != NULL)
+	{
+		return AIRSPY_ERROR_BUSY;
+	}
+
+	size = sample_type_size(device->sample_type);
+
+	while (done < sample_count)
+	{
+		if (device->pull_count > 0)
+		{
+			n = device->pull_count < sample_count - done ? device->pull_count : sample_count - done;
+			memcpy(dest + done * size, device->pull_samples, n * size);
+
+			device->pull_samples += n * size;
+			device->pull_count -= n;
+			done += n;
+
+			if (device->pull_count == 0 && device->pull_slot >= 0)
+			{
+				spsc_ring_release(&device->received_ring);
+				device->pull_slot = -1;
+			}
+			continue;
+		}
+
+		slot = -1;
+		if (blocking && device->streaming && !device->stop_requested)
+		{
+			slot = spsc_ring_wait(&device->received_ring, deadline);
+		}
+		if (slot < 0)
+		{
+			slot = spsc_ring_peek(&device->received_ring);
+			if (slot < 0)
+			{
+				break;
+			}
+		}
+
+		device->stats.buffers_delivered++;
+
+		if (sample_type_in_place(device))
+		{
+			device->pull_samples = (uint8_t*) device->received_samples_queue[slot];
+			device->pull_count = device->buffer_size / 2;
+			device->pull_slot = slot;
+			continue;
+		}
+
+		/* An upper bound, a decimated buffer gives one sample more or less from time to time */
+		block_count = buffer_sample_count(device);
+		if (sample_count - done >= block_count)
+		{
+			done += convert_buffer(device, device->received_samples_queue[slot], dest + done * size, &samples);
+		}
+		else
+		{
+			device->pull_count = convert_buffer(device, device->received_samples_queue[slot], device->output_buffer, &samples);
+			device->pull_samples = (uint8_t*) device->output_buffer;
+		}
+
+		spsc_ring_release(&device->received_ring);
+	}
+
+	if (done == 0 && sample_count > 0 && (!device->streaming || device->stop_requested))
+	{
+		return AIRSPY_ERROR_STREAMING_STOPPED;
+	}
+
+	return done;
+}
+
+/*
+ * The pool is rebuilt on every start so that its buffers match the current
+ * buffer size and packing. That is only possible once the application has
+ * released every block of the previous run.
+ */
+static int prepare_buffer_pool(airspy_device_t* device, airspy_sample_block_cb_fn callback)
+{
+	if (device->streaming)
+	{
+		return AIRSPY_ERROR_BUSY;
+	}
+
+	if (device->pool_active)
+	{
+		if (buffer_pool_in_use(&device->pool) != 0)
+		{
+			return AIRSPY_ERROR_BUSY;
+		}
+
+		buffer_pool_destroy(&device->pool);
+		device->pool_active = false;
+	}
+
+	/* Pull mode copies into the caller's memory and has no use for the pool */
+	if (device->pool_count == 0 || callback == NULL)
+	{
+		return AIRSPY_SUCCESS;
+	}
+
+	if (buffer_pool_init(&device->pool, device->pool_count, output_buffer_size(device)) != 0)
+	{
+		return AIRSPY_ERROR_NO_MEM;
+	}
+
+	device->pool_active = true;
+
+	return AIRSPY_SUCCESS;
+}
+
+static void free_conversion_team(airspy_device_t* device)
+{
+	uint32_t part;
+
+	if (device->conversion_active)
+	{
+		fork_join_destroy(&device->conversion_team);
+		device->conversion_active = false;
+	}
+
+	for (part = 0; device->cnv_f_parts != NULL && part < device->conversion_threads; part++)
+	{
+		if (device->cnv_f_parts[part] != NULL)
+		{
+			iqconverter_float_free(device->cnv_f_parts[part]);
+		}
+		if (device->cnv_i_parts[part] != NULL)
+		{
+			iqconverter_int16_free(device->cnv_i_parts[part]);
+		}
+	}
+
+	free(device->cnv_f_parts);
+	free(device->cnv_i_parts);
+	device->cnv_f_parts = NULL;
+	device->cnv_i_parts = NULL;
+}
+
+static void free_decimators(airspy_device_t* device)
+{
+	decimator_float_free(device->dec_f);
+	decimator_int16_free(device->dec_i);
+	free(device->decimation_scratch);
+	device->dec_f = NULL;
+	device->dec_i = NULL;
+	device->decimation_scratch = NULL;
+	device->decimation = 1;
+}
+
+/* The early stages use the short half-band, the last one the conversion half-band */
+static int create_decimators(airspy_device_t* device, uint32_t factor)
+{
+	int stage_count = 0;
+
+	while (((uint32_t) 1 << stage_count) < factor)
+	{
+		stage_count++;
+	}
+
+	device->dec_f = decimator_float_create(stage_count, HB_DECIMATION_KERNEL_FLOAT, HB_DECIMATION_KERNEL_FLOAT_LEN,
+		HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN);
+	device->dec_i = decimator_int16_create(stage_count, HB_DECIMATION_KERNEL_INT16, HB_DECIMATION_KERNEL_INT16_LEN,
+		HB_KERNEL_INT16, HB_KERNEL_INT16_LEN);
+	device->decimation_scratch = malloc(DECIMATION_CHUNK * sizeof(float));
+	if (device->dec_f == NULL || device->dec_i == NULL || device->decimation_scratch == NULL)
+	{
+		free_decimators(device);
+		return AIRSPY_ERROR_NO_MEM;
+	}
+
+	device->decimation = factor;
+
+	return AIRSPY_SUCCESS;
+}
+
+/* The part converters are cloned on every start, the conversion filters may have changed */
+static int prepare_conversion_team(airspy_device_t* device)
+{
+	uint32_t part;
+
+	free_conversion_team(device);
+
+	if (device->conversion_threads <= 1)
+	{
+		return AIRSPY_SUCCESS;
+	}
+
+	device->cnv_f_parts = (iqconverter_float_t **) calloc(device->conversion_threads, sizeof(iqconverter_float_t *));
+	device->cnv_i_parts = (iqconverter_int16_t **) calloc(device->conversion_threads, sizeof(iqconverter_int16_t *));
+	if (device->cnv_f_parts == NULL || device->cnv_i_parts == NULL)
+	{
+		free_conversion_team(device);
+		return AIRSPY_ERROR_NO_MEM;
+	}
+
+	for (part = 0; part < device->conversion_threads; part++)
+	{
+		device->cnv_f_parts[part] = iqconverter_float_clone(device->cnv_f);
+		device->cnv_i_parts[part] = iqconverter_int16_clone(device->cnv_i);
+	}
+
+	if (fork_join_init(&device->conversion_team, device->conversion_threads - 1) != 0)
+	{
+		free_conversion_team(device);
+		return AIRSPY_ERROR_THREAD;
+	}
+
+	device->conversion_active = true;
+
+	return AIRSPY_SUCCESS;
+}
+
+static int create_io_threads(airspy_device_t* device, airspy_sample_block_cb_fn callback)
+{
+	int result;
+	pthread_attr_t attr;
+
+	if (!device->streaming && !device->stop_requested)
+	{
+		device->callback = callback;
+		device->streaming = true;
+		spsc_ring_reset(&device->received_ring);
+		device->pull_slot = -1;
+		device->pull_count = 0;
+		device->pool_starved = 0;
+
+		if (device->context != NULL)
+		{
+			work_pool_resume(&device->context->workers, &device->work);
+		}
+
+		if (device->file == NULL)
+		{
+			result = prepare_transfers(device, LIBUSB_ENDPOINT_IN | 1, (libusb_transfer_cb_fn)airspy_libusb_transfer_callback);
+			if (result != AIRSPY_SUCCESS)
+			{
+				return result;
+			}
+		}
+
+		/* A shared context already runs the event loop and the consumer work */
+		if (device->context != NULL)
+		{
+			return AIRSPY_SUCCESS;
+		}
+
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+		/* Without a callback the application pulls the samples itself */
+		if (callback != NULL)
+		{
+			result = pthread_create(&device->consumer_thread, &attr, consumer_threadproc, device);
+			if (result != 0)
+			{
+				return AIRSPY_ERROR_THREAD;
+			}
+			device->consumer_thread_running = true;
+		}
+
+		result = pthread_create(&device->transfer_thread, &attr, device->file != NULL ? file_threadproc : transfer_threadproc, device);
+		if (result != 0)
+		{
+			return AIRSPY_ERROR_THREAD;
+		}
+		device->transfer_thread_running = true;
+
+		pthread_attr_destroy(&attr);
+	}
+	else {
+		return AIRSPY_ERROR_BUSY;
+	}
+
+	return AIRSPY_SUCCESS;
+}
+
+/* The sweep thread shares the placement and scheduling of the event role, never its name */
+static int apply_sweep_thread_params(airspy_device_t* device)
+{
+	thread_params_t params = device->thread_params[AIRSPY_THREAD_EVENT];
+
+	params.name[0] = '\0';
+	return thread_params_apply(device->sweep_thread, &params, "airspy-sweep", -1);
+}
+
+static int apply_device_thread_params(airspy_device_t* device)
+{
+	uint32_t i;
+	int result = 0;
+
+	if (device->transfer_thread_running)
+	{
+		result |= thread_params_apply(device->transfer_thread, &device->thread_params[AIRSPY_THREAD_EVENT], "airspy-usb", -1);
+	}
+
+	if (device->consumer_thread_running)
+	{
+		result |= thread_params_apply(device->consumer_thread, &device->thread_params[AIRSPY_THREAD_CONSUMER], "airspy-rx", -1);
+	}
+
+	if (device->sweep_thread_running)
+	{
+		result |= apply_sweep_thread_params(device);
+	}
+
+	for (i = 0; device->conversion_active && i < device->conversion_team.helper_count; i++)
+	{
+		result |= thread_params_apply(device->conversion_team.helpers[i].thread, &device->thread_params[AIRSPY_THREAD_CONVERSION], "airspy-cnv", (int) i + 1);
+	}
+
+	return result == 0 ? AIRSPY_SUCCESS : AIRSPY_ERROR_THREAD;
+}
 
-		pthread_attr_init(&attr);
-		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+static int apply_context_thread_params(airspy_context_t* context)
+{
+	uint32_t i;
+	int result = 0;
 
-		result = pthread_create(&device->consumer_thread, &attr, consumer_threadproc, device);
-		if (result != 0)
+	for (i = 0; i < context->event_loop_count; i++)
+	{
+		if (context->event_loops[i].thread_running)
 		{
-			return AIRSPY_ERROR_THREAD;
+			result |= thread_params_apply(context->event_loops[i].thread, &context->thread_params[AIRSPY_THREAD_EVENT], "airspy-ev", (int) i);
 		}
-		device->consumer_thread_running = true;
+	}
 
-		result = pthread_create(&device->transfer_thread, &attr, transfer_threadproc, device);
-		if (result != 0)
-		{
-			return AIRSPY_ERROR_THREAD;
-		}
-		device->transfer_thread_running = true;
+	for (i = 0; context->workers_running && i < context->workers.thread_count; i++)
+	{
+		result |= thread_params_apply(context->workers.threads[i], &context->thread_params[AIRSPY_THREAD_CONSUMER], "airspy-work", (int) i);
+	}
 
-		pthread_attr_destroy(&attr);
+	return result == 0 ? AIRSPY_SUCCESS : AIRSPY_ERROR_THREAD;
+}
+
+/* Copies public thread parameters, checking them for this platform */
+static int import_thread_params(thread_params_t* dest, const airspy_thread_params_t* params)
+{
+	thread_params_t imported;
+
+	if (params == NULL)
+	{
+		return AIRSPY_ERROR_INVALID_PARAM;
 	}
-	else {
-		return AIRSPY_ERROR_BUSY;
+
+	imported.cpu_mask = params->cpu_mask;
+	imported.policy = (int) params->policy;
+	imported.priority = params->priority;
+	memcpy(imported.name, params->name, sizeof(imported.name));
+	imported.name[sizeof(imported.name) - 1] = '\0';
+
+	if (thread_params_check(&imported) != 0)
+	{
+		return AIRSPY_ERROR_INVALID_PARAM;
 	}
 
+	*dest = imported;
+
 	return AIRSPY_SUCCESS;
 }
 
+/* Private contexts are torn down with the device, shared ones only lose a user */
+static void airspy_release_context(airspy_device_t* device)
+{
+	if (device->context != NULL)
+	{
+		pthread_mutex_lock(&device->context->mutex);
+		device->event_loop->device_count--;
+		device->context->device_count--;
+		pthread_mutex_unlock(&device->context->mutex);
+		device->context = NULL;
+		device->event_loop = NULL;
+	}
+	else if (device->usb_context != NULL)
+	{
+		libusb_exit(device->usb_context);
+	}
+	device->usb_context = NULL;
+}
+
 static void airspy_open_exit(airspy_device_t* device)
 {
 	if (device->usb_device != NULL)
@@ -600,8 +2557,40 @@ static void airspy_open_exit(airspy_device_t* device)
 		libusb_close(device->usb_device);
 		device->usb_device = NULL;
 	}
-	libusb_exit(device->usb_context);
-	device->usb_context = NULL;
+	if (device->file != NULL)
+	{
+		fclose(device->file);
+		device->file = NULL;
+	}
+	airspy_release_context(device);
+}
+
+/* Devices go to the event loop serving the fewest */
+static void airspy_attach_context(airspy_device_t* device, airspy_context_t* context)
+{
+	uint32_t i;
+	airspy_event_loop_t* event_loop;
+
+	pthread_mutex_lock(&context->mutex);
+
+	event_loop = &context->event_loops[0];
+	for (i = 1; i < context->event_loop_count; i++)
+	{
+		if (context->event_loops[i].device_count < event_loop->device_count)
+		{
+			event_loop = &context->event_loops[i];
+		}
+	}
+
+	event_loop->device_count++;
+	context->device_count++;
+
+	pthread_mutex_unlock(&context->mutex);
+
+	device->context = context;
+	device->event_loop = event_loop;
+	device->usb_context = event_loop->usb_context;
+	work_item_init(&device->work, consume_batch, consume_pending, device);
 }
 
 static void airspy_open_device(airspy_device_t* device,
@@ -813,8 +2802,8 @@ static int airspy_read_samplerates_from_fw(struct airspy_device* device, uint32_
 {
 	int result;
 
-	result = libusb_control_transfer(
-		device->usb_device,
+	result = control_transfer(
+		device,
 		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 		AIRSPY_GET_SAMPLERATES,
 		0,
@@ -831,7 +2820,7 @@ static int airspy_read_samplerates_from_fw(struct airspy_device* device, uint32_
 	return AIRSPY_SUCCESS;
 }
 
-static int airspy_open_init(airspy_device_t** device, uint64_t serial_number, int fd)
+static int airspy_open_init(airspy_device_t** device, uint64_t serial_number, int fd, FILE* file, uint32_t file_flags, airspy_context_t* context)
 {
 	airspy_device_t* lib_device;
 	int libusb_error;
@@ -842,22 +2831,42 @@ static int airspy_open_init(airspy_device_t** device, uint64_t serial_number, in
 	lib_device = (airspy_device_t*)calloc(1, sizeof(airspy_device_t));
 	if (lib_device == NULL)
 	{
+		if (file != NULL)
+		{
+			fclose(file);
+		}
 		return AIRSPY_ERROR_NO_MEM;
 	}
 
+	if (file != NULL)
+	{
+		lib_device->file = file;
+		lib_device->file_flags = file_flags;
+		lib_device->replay_rate = 0;
+	}
+	else if (context != NULL)
+	{
+		airspy_attach_context(lib_device, context);
+	}
+	else
+	{
 #ifdef __ANDROID__
-	// LibUSB does not support device discovery on android
-	libusb_set_option(NULL, LIBUSB_OPTION_NO_DEVICE_DISCOVERY, NULL);
+		// LibUSB does not support device discovery on android
+		libusb_set_option(NULL, LIBUSB_OPTION_NO_DEVICE_DISCOVERY, NULL);
 #endif
 
-	libusb_error = libusb_init(&lib_device->usb_context);
-	if (libusb_error != 0)
-	{
-		free(lib_device);
-		return AIRSPY_ERROR_LIBUSB;
+		libusb_error = libusb_init(&lib_device->usb_context);
+		if (libusb_error != 0)
+		{
+			free(lib_device);
+			return AIRSPY_ERROR_LIBUSB;
+		}
 	}
 
-	if (fd == FILE_DESCRIPTOR_UNUSED) {
+	if (file != NULL) {
+		result = AIRSPY_SUCCESS;
+	}
+	else if (fd == FILE_DESCRIPTOR_UNUSED) {
 		airspy_open_device(lib_device,
 			&result,
 			airspy_usb_vid,
@@ -870,21 +2879,44 @@ static int airspy_open_init(airspy_device_t** device, uint64_t serial_number, in
 			fd);
 	}
 
-	if (lib_device->usb_device == NULL)
+	if (lib_device->usb_device == NULL && lib_device->file == NULL)
 	{
-		libusb_exit(lib_device->usb_context);
+		airspy_release_context(lib_device);
 		free(lib_device);
 		return result;
 	}
 
 	lib_device->transfers = NULL;
 	lib_device->callback = NULL;
-	lib_device->transfer_count = 16;
-	lib_device->buffer_size = 262144;
+	lib_device->transfer_count = TRANSFER_COUNT;
+	lib_device->buffer_size = UNPACKED_BUFFER_SIZE;
+	lib_device->requested_buffer_size = 0;
+	lib_device->queue_depth = RAW_BUFFER_COUNT;
+	lib_device->dropped_buffers_queue = NULL;
+	lib_device->sample_index_queue = NULL;
+	lib_device->timestamp_queue = NULL;
+	lib_device->gain_state_queue = NULL;
+	lib_device->raw_samplerate = 0;
+	lib_device->received_samples_queue = NULL;
+	lib_device->usb_buffers = NULL;
+	lib_device->usb_buffers_mapped = false;
+	lib_device->output_buffer = NULL;
+	lib_device->pool_count = 0;
+	lib_device->pool_active = false;
+	lib_device->pull_slot = -1;
+	lib_device->pull_count = 0;
+	lib_device->pull_samples = NULL;
 	lib_device->packing_enabled = false;
 	lib_device->streaming = false;
 	lib_device->stop_requested = false;
 	lib_device->sample_type = AIRSPY_SAMPLE_FLOAT32_IQ;
+	lib_device->freq_hz = 0;
+	lib_device->sweep_steps = NULL;
+	lib_device->sweep_step_count = 0;
+	lib_device->sweep_flags = 0;
+	lib_device->sweep_thread_running = false;
+	lib_device->sweep_running = false;
+	lib_device->sweep_tagging = false;
 
 	result = airspy_read_samplerates_from_fw(lib_device, &lib_device->supported_samplerate_count, 0);
 	if (result == AIRSPY_SUCCESS)
@@ -905,22 +2937,46 @@ static int airspy_open_init(airspy_device_t** device, uint64_t serial_number, in
 		lib_device->supported_samplerates[1] = 2500000;
 	}
 
-	airspy_set_packing(lib_device, 0);
+	/* A replayed capture keeps the packing it was recorded with, sized before the transfers are allocated */
+	lib_device->packing_enabled = (lib_device->file_flags & AIRSPY_FILE_PACKED) != 0;
+	lib_device->buffer_size = stream_buffer_size(lib_device);
+
+	spsc_ring_init(&lib_device->received_ring, RAW_BUFFER_COUNT);
+	spsc_ring_init(&lib_device->sweep_ring, SWEEP_EVENT_COUNT);
+
+	pthread_mutex_init(&lib_device->control_mutex, NULL);
+	pthread_cond_init(&lib_device->control_cond, NULL);
+	pthread_mutex_init(&lib_device->gain_mutex, NULL);
+	pthread_mutex_init(&lib_device->register_mutex, NULL);
+	register_shadow_init(&lib_device->r820t_shadow, R820T_REGISTER_COUNT,
+		r820t_uncached_registers, sizeof(r820t_uncached_registers));
+	register_shadow_init(&lib_device->si5351c_shadow, SI5351C_REGISTER_COUNT,
+		si5351c_uncached_registers, sizeof(si5351c_uncached_registers));
 
 	result = allocate_transfers(lib_device);
 	if (result != 0)
 	{
+		free_transfers(lib_device);
+		stop_controls(lib_device);
+		pthread_mutex_destroy(&lib_device->gain_mutex);
+		pthread_mutex_destroy(&lib_device->register_mutex);
+		spsc_ring_destroy(&lib_device->received_ring);
+		spsc_ring_destroy(&lib_device->sweep_ring);
 		airspy_open_exit(lib_device);
 		free(lib_device->supported_samplerates);
 		free(lib_device);
 		return AIRSPY_ERROR_NO_MEM;
 	}
 
+	/* The kernels are shared by every device, so the host is probed only once */
+	pthread_once(&dsp_init_once, dsp_init);
+
 	lib_device->cnv_f = iqconverter_float_create(HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN);
 	lib_device->cnv_i = iqconverter_int16_create(HB_KERNEL_INT16, HB_KERNEL_INT16_LEN);
-
-	pthread_cond_init(&lib_device->consumer_cv, NULL);
-	pthread_mutex_init(&lib_device->consumer_mp, NULL);
+	lib_device->decimation = 1;
+	lib_device->dec_f = NULL;
+	lib_device->dec_i = NULL;
+	lib_device->decimation_scratch = NULL;
 
 	*device = lib_device;
 
@@ -1039,11 +3095,113 @@ int airspy_list_devices(uint64_t *serials, int count)
 	return output_count;
 }
 
+	int ADDCALL airspy_context_destroy(airspy_context_t* context)
+	{
+		uint32_t i;
+
+		if (context == NULL)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		if (context->device_count != 0)
+		{
+			return AIRSPY_ERROR_BUSY;
+		}
+
+		context->running = false;
+
+		for (i = 0; i < context->event_loop_count; i++)
+		{
+			if (context->event_loops[i].thread_running)
+			{
+				pthread_join(context->event_loops[i].thread, NULL);
+			}
+			if (context->event_loops[i].usb_context != NULL)
+			{
+				libusb_exit(context->event_loops[i].usb_context);
+			}
+		}
+
+		if (context->workers_running)
+		{
+			work_pool_destroy(&context->workers);
+		}
+
+		pthread_mutex_destroy(&context->mutex);
+		free(context->event_loops);
+		free(context);
+
+		return AIRSPY_SUCCESS;
+	}
+
+	int ADDCALL airspy_context_create(airspy_context_t** context, uint32_t event_threads, uint32_t worker_threads)
+	{
+		uint32_t i;
+		airspy_context_t* lib_context;
+
+		if (context == NULL || event_threads > MAX_EVENT_THREADS || worker_threads > MAX_WORKER_THREADS)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		*context = NULL;
+
+		lib_context = (airspy_context_t*)calloc(1, sizeof(airspy_context_t));
+		if (lib_context == NULL)
+		{
+			return AIRSPY_ERROR_NO_MEM;
+		}
+
+		lib_context->event_loop_count = event_threads ? event_threads : 1;
+		lib_context->event_loops = (airspy_event_loop_t*)calloc(lib_context->event_loop_count, sizeof(airspy_event_loop_t));
+		if (lib_context->event_loops == NULL)
+		{
+			free(lib_context);
+			return AIRSPY_ERROR_NO_MEM;
+		}
+
+		pthread_mutex_init(&lib_context->mutex, NULL);
+		lib_context->running = true;
+
+		for (i = 0; i < lib_context->event_loop_count; i++)
+		{
+			lib_context->event_loops[i].context = lib_context;
+			if (libusb_init(&lib_context->event_loops[i].usb_context) != 0)
+			{
+				lib_context->event_loops[i].usb_context = NULL;
+				airspy_context_destroy(lib_context);
+				return AIRSPY_ERROR_LIBUSB;
+			}
+
+			if (pthread_create(&lib_context->event_loops[i].thread, NULL, event_loop_threadproc, &lib_context->event_loops[i]) != 0)
+			{
+				airspy_context_destroy(lib_context);
+				return AIRSPY_ERROR_THREAD;
+			}
+			lib_context->event_loops[i].thread_running = true;
+		}
+
+		if (work_pool_init(&lib_context->workers, worker_threads ? worker_threads : 1) != 0)
+		{
+			airspy_context_destroy(lib_context);
+			return AIRSPY_ERROR_THREAD;
+		}
+		lib_context->workers_running = true;
+
+		/* Only names the threads, no placement is set yet */
+		apply_context_thread_params(lib_context);
+
+		*context = lib_context;
+
+		return AIRSPY_SUCCESS;
+	}
+
 	int ADDCALL airspy_open_sn(airspy_device_t** device, uint64_t serial_number)
 	{
 		int result;
 
-		result = airspy_open_init(device, serial_number, FILE_DESCRIPTOR_UNUSED);
+		result = airspy_open_init(device, serial_number, FILE_DESCRIPTOR_UNUSED, NULL, 0, NULL);
 		return result;
 	}
 
@@ -1051,7 +3209,7 @@ int airspy_list_devices(uint64_t *serials, int count)
 	{
 		int result;
 
-		result = airspy_open_init(device, SERIAL_NUMBER_UNUSED, fd);
+		result = airspy_open_init(device, SERIAL_NUMBER_UNUSED, fd, NULL, 0, NULL);
 		return result;
 	}
 
@@ -1059,10 +3217,61 @@ int airspy_list_devices(uint64_t *serials, int count)
 	{
 		int result;
 
-		result = airspy_open_init(device, SERIAL_NUMBER_UNUSED, FILE_DESCRIPTOR_UNUSED);
+		result = airspy_open_init(device, SERIAL_NUMBER_UNUSED, FILE_DESCRIPTOR_UNUSED, NULL, 0, NULL);
+		return result;
+	}
+
+	int ADDCALL airspy_open_file(airspy_device_t** device, const char* path, uint32_t flags)
+	{
+		FILE* file;
+		int result;
+
+		if (device == NULL || path == NULL)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		file = fopen(path, "rb");
+		if (file == NULL)
+		{
+			return AIRSPY_ERROR_NOT_FOUND;
+		}
+
+		/* Closed with the device, or by a failed open */
+		result = airspy_open_init(device, SERIAL_NUMBER_UNUSED, FILE_DESCRIPTOR_UNUSED, file, flags, NULL);
+		return result;
+	}
+
+	int ADDCALL airspy_context_set_thread_params(airspy_context_t* context, enum airspy_thread_role role, const airspy_thread_params_t* params)
+	{
+		int result;
+
+		if (context == NULL || (role != AIRSPY_THREAD_EVENT && role != AIRSPY_THREAD_CONSUMER))
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		pthread_mutex_lock(&context->mutex);
+		result = import_thread_params(&context->thread_params[role], params);
+		if (result == AIRSPY_SUCCESS)
+		{
+			result = apply_context_thread_params(context);
+		}
+		pthread_mutex_unlock(&context->mutex);
+
 		return result;
 	}
 
+	int ADDCALL airspy_open_shared(airspy_context_t* context, airspy_device_t** device, uint64_t serial_number)
+	{
+		if (context == NULL || device == NULL)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		return airspy_open_init(device, serial_number, FILE_DESCRIPTOR_UNUSED, NULL, 0, context);
+	}
+
 	int ADDCALL airspy_close(airspy_device_t* device)
 	{
 		int result;
@@ -1073,11 +3282,21 @@ int airspy_list_devices(uint64_t *serials, int count)
 		{
 			result = airspy_stop_rx(device);
 
+			stop_controls(device);
+			pthread_mutex_destroy(&device->gain_mutex);
+			pthread_mutex_destroy(&device->register_mutex);
+			free_conversion_team(device);
 			iqconverter_float_free(device->cnv_f);
 			iqconverter_int16_free(device->cnv_i);
+			free_decimators(device);
 
-			pthread_cond_destroy(&device->consumer_cv);
-			pthread_mutex_destroy(&device->consumer_mp);
+			spsc_ring_destroy(&device->received_ring);
+			spsc_ring_destroy(&device->sweep_ring);
+
+			if (device->pool_active)
+			{
+				buffer_pool_destroy(&device->pool);
+			}
 
 			free_transfers(device);
 			airspy_open_exit(device);
@@ -1144,12 +3363,15 @@ int airspy_list_devices(uint64_t *serials, int count)
 			}
 		}
 
-		libusb_clear_halt(device->usb_device, LIBUSB_ENDPOINT_IN | 1);
+		if (device->file == NULL)
+		{
+			libusb_clear_halt(device->usb_device, LIBUSB_ENDPOINT_IN | 1);
+		}
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_SAMPLERATE,
 			0,
@@ -1158,11 +3380,22 @@ int airspy_list_devices(uint64_t *serials, int count)
 			length,
 			LIBUSB_CTRL_TIMEOUT_MS);
 
+		track_registers(device, AIRSPY_SET_SAMPLERATE, 0, samplerate, NULL, result >= length);
+
 		if (result < length)
 		{
 			return AIRSPY_ERROR_LIBUSB;
 		}
 		else {
+			/* ADC word rate, seeds the timestamp filter: indexes name IQ rates, values are in kHz */
+			if (samplerate < device->supported_samplerate_count)
+			{
+				device->raw_samplerate = device->supported_samplerates[samplerate] * 2;
+			}
+			else
+			{
+				device->raw_samplerate = samplerate * 1000;
+			}
 			return AIRSPY_SUCCESS;
 		}
 	}
@@ -1170,8 +3403,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 	int ADDCALL airspy_set_receiver_mode(airspy_device_t* device, receiver_mode_t value)
 	{
 		int result;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_RECEIVER_MODE,
 			value,
@@ -1180,6 +3413,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 			0,
 			LIBUSB_CTRL_TIMEOUT_MS);
 
+		track_registers(device, AIRSPY_RECEIVER_MODE, value, 0, NULL, result == 0);
+
 		if (result != 0)
 		{
 			return AIRSPY_ERROR_LIBUSB;
@@ -1193,19 +3428,58 @@ int airspy_list_devices(uint64_t *serials, int count)
 	{
 		int result;
 
+		/* A failed airspy_set_stream_config() leaves nothing to stream into */
+		if (device->transfers == NULL)
+		{
+			return AIRSPY_ERROR_NO_MEM;
+		}
+
+		result = prepare_buffer_pool(device, callback);
+		if (result != AIRSPY_SUCCESS)
+		{
+			return result;
+		}
+
+		result = prepare_conversion_team(device);
+		if (result != AIRSPY_SUCCESS)
+		{
+			return result;
+		}
+
+		/* A sweep outlives a stream that ended from its callback until here */
+		airspy_stop_sweep(device);
+		spsc_ring_reset(&device->sweep_ring);
+		device->sweep_tagging = false;
+
 		iqconverter_float_reset(device->cnv_f);
 		iqconverter_int16_reset(device->cnv_i);
+		if (device->decimation > 1)
+		{
+			decimator_float_reset(device->dec_f);
+			decimator_int16_reset(device->dec_i);
+		}
 
-		memset(device->dropped_buffers_queue, 0, RAW_BUFFER_COUNT * sizeof(uint32_t));
+		memset(device->dropped_buffers_queue, 0, device->queue_depth * sizeof(uint32_t));
 		device->dropped_buffers = 0;
 
+		device->sample_counter = 0;
+		memset(&device->stats, 0, sizeof(device->stats));
+		time_filter_reset(&device->time_filter,
+			device->raw_samplerate ? (double) buffer_word_count(device) / device->raw_samplerate : 0.0);
+		device->clock_base_ns = time_monotonic_ns();
+		device->realtime_offset_ns = time_realtime_offset_ns();
+		device->gain_word_seen = atomic_load_acquire(&device->gain_word);
+
 		result = airspy_set_receiver_mode(device, RECEIVER_MODE_OFF);
 		if (result != AIRSPY_SUCCESS)
 		{
 			return result;
 		}
 
-		libusb_clear_halt(device->usb_device, LIBUSB_ENDPOINT_IN | 1);
+		if (device->file == NULL)
+		{
+			libusb_clear_halt(device->usb_device, LIBUSB_ENDPOINT_IN | 1);
+		}
 
 		result = airspy_set_receiver_mode(device, RECEIVER_MODE_RX);
 		if (result == AIRSPY_SUCCESS)
@@ -1214,6 +3488,12 @@ int airspy_list_devices(uint64_t *serials, int count)
 			result = create_io_threads(device, callback);
 		}
 
+		if (result == AIRSPY_SUCCESS)
+		{
+			/* Best effort, airspy_set_thread_params() while streaming reports refusals */
+			apply_device_thread_params(device);
+		}
+
 		return result;
 	}
 
@@ -1222,6 +3502,7 @@ int airspy_list_devices(uint64_t *serials, int count)
 		int result1, result2;
 
 		device->stop_requested = true;
+		airspy_stop_sweep(device);
 		result1 = airspy_set_receiver_mode(device, RECEIVER_MODE_OFF);
 		result2 = kill_io_threads(device);
 
@@ -1237,9 +3518,17 @@ int airspy_list_devices(uint64_t *serials, int count)
 		uint8_t temp_value;
 		int result;
 
+		pthread_mutex_lock(&device->register_mutex);
+		result = register_shadow_get(&device->si5351c_shadow, register_number, value);
+		pthread_mutex_unlock(&device->register_mutex);
+		if (result == 0)
+		{
+			return AIRSPY_SUCCESS;
+		}
+
 		temp_value = 0;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SI5351C_READ,
 			0,
@@ -1248,6 +3537,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 			1,
 			LIBUSB_CTRL_TIMEOUT_MS);
 
+		track_registers(device, AIRSPY_SI5351C_READ, 0, register_number, &temp_value, result >= 1);
+
 		if (result < 1)
 		{
 			return AIRSPY_ERROR_LIBUSB;
@@ -1261,9 +3552,18 @@ int airspy_list_devices(uint64_t *serials, int count)
 	int ADDCALL airspy_si5351c_write(airspy_device_t* device, uint8_t register_number, uint8_t value)
 	{
 		int result;
+		bool unchanged;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		pthread_mutex_lock(&device->register_mutex);
+		unchanged = register_shadow_matches(&device->si5351c_shadow, register_number, value);
+		pthread_mutex_unlock(&device->register_mutex);
+		if (unchanged)
+		{
+			return AIRSPY_SUCCESS;
+		}
+
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SI5351C_WRITE,
 			value,
@@ -1272,6 +3572,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 			0,
 			LIBUSB_CTRL_TIMEOUT_MS);
 
+		track_registers(device, AIRSPY_SI5351C_WRITE, value, register_number, NULL, result == 0);
+
 		if (result != 0)
 		{
 			return AIRSPY_ERROR_LIBUSB;
@@ -1285,8 +3587,16 @@ int airspy_list_devices(uint64_t *serials, int count)
 	{
 		int result;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		pthread_mutex_lock(&device->register_mutex);
+		result = register_shadow_get(&device->r820t_shadow, register_number, value);
+		pthread_mutex_unlock(&device->register_mutex);
+		if (result == 0)
+		{
+			return AIRSPY_SUCCESS;
+		}
+
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_R820T_READ,
 			0,
@@ -1295,6 +3605,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 			1,
 			LIBUSB_CTRL_TIMEOUT_MS);
 
+		track_registers(device, AIRSPY_R820T_READ, 0, register_number, value, result >= 1);
+
 		if (result < 1)
 		{
 			return AIRSPY_ERROR_LIBUSB;
@@ -1307,9 +3619,18 @@ int airspy_list_devices(uint64_t *serials, int count)
 	int ADDCALL airspy_r820t_write(airspy_device_t* device, uint8_t register_number, uint8_t value)
 	{
 		int result;
+		bool unchanged;
+
+		pthread_mutex_lock(&device->register_mutex);
+		unchanged = register_shadow_matches(&device->r820t_shadow, register_number, value);
+		pthread_mutex_unlock(&device->register_mutex);
+		if (unchanged)
+		{
+			return AIRSPY_SUCCESS;
+		}
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_R820T_WRITE,
 			value,
@@ -1318,6 +3639,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 			0,
 			LIBUSB_CTRL_TIMEOUT_MS);
 
+		track_registers(device, AIRSPY_R820T_WRITE, value, register_number, NULL, result == 0);
+
 		if (result != 0)
 		{
 			return AIRSPY_ERROR_LIBUSB;
@@ -1335,8 +3658,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		port_pin = ((uint8_t)port) << 5;
 		port_pin = port_pin | pin;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_GPIO_READ,
 			0,
@@ -1362,8 +3685,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		port_pin = ((uint8_t)port) << 5;
 		port_pin = port_pin | pin;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_GPIO_WRITE,
 			value,
@@ -1390,8 +3713,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		port_pin = ((uint8_t)port) << 5;
 		port_pin = port_pin | pin;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_GPIODIR_READ,
 			0,
@@ -1417,8 +3740,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		port_pin = ((uint8_t)port) << 5;
 		port_pin = port_pin | pin;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_GPIODIR_WRITE,
 			value,
@@ -1439,8 +3762,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 	int ADDCALL airspy_spiflash_erase(airspy_device_t* device)
 	{
 		int result;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SPIFLASH_ERASE,
 			0,
@@ -1461,8 +3784,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 	int ADDCALL airspy_spiflash_erase_sector(airspy_device_t* device, const uint16_t sector_num)
 	{
 		int result;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SPIFLASH_ERASE_SECTOR,
 			sector_num,
@@ -1489,8 +3812,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 			return AIRSPY_ERROR_INVALID_PARAM;
 		}
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SPIFLASH_WRITE,
 			address >> 16,
@@ -1512,8 +3835,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 	{
 		int result;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SPIFLASH_READ,
 			address >> 16,
@@ -1534,8 +3857,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 	int ADDCALL airspy_board_id_read(airspy_device_t* device, uint8_t* value)
 	{
 		int result;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_BOARD_ID_READ,
 			0,
@@ -1559,8 +3882,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		int result;
 		char version_local[VERSION_LOCAL_SIZE] = "";
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_VERSION_STRING_READ,
 			0,
@@ -1595,8 +3918,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		int result;
 
 		length = sizeof(airspy_read_partid_serialno_t);
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_BOARD_PARTID_SERIALNO_READ,
 			0,
@@ -1637,8 +3960,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		set_freq_params.freq_hz = TO_LE(freq_hz);
 		length = sizeof(set_freq_params_t);
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_FREQ,
 			0,
@@ -1647,6 +3970,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 			length,
 			LIBUSB_CTRL_TIMEOUT_MS);
 
+		track_registers(device, AIRSPY_SET_FREQ, 0, 0, (const uint8_t*)&set_freq_params, result >= length);
+
 		if (result < length)
 		{
 			return AIRSPY_ERROR_LIBUSB;
@@ -1656,6 +3981,63 @@ int airspy_list_devices(uint64_t *serials, int count)
 		}
 	}
 
+	int ADDCALL airspy_start_sweep(airspy_device_t* device, const airspy_sweep_step_t* steps, uint32_t step_count, uint32_t flags)
+	{
+		airspy_sweep_step_t* copy;
+
+		if (steps == NULL || step_count == 0 || step_count > MAX_SWEEP_STEPS)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		/* The steps are tagged on the callback path only */
+		if (!device->streaming || device->callback == NULL)
+		{
+			return AIRSPY_ERROR_STREAMING_STOPPED;
+		}
+
+		copy = (airspy_sweep_step_t*) malloc(step_count * sizeof(airspy_sweep_step_t));
+		if (copy == NULL)
+		{
+			return AIRSPY_ERROR_NO_MEM;
+		}
+		memcpy(copy, steps, step_count * sizeof(airspy_sweep_step_t));
+
+		airspy_stop_sweep(device);
+
+		device->sweep_steps = copy;
+		device->sweep_step_count = step_count;
+		device->sweep_flags = flags;
+		device->sweep_running = true;
+
+		if (pthread_create(&device->sweep_thread, NULL, sweep_threadproc, device) != 0)
+		{
+			airspy_stop_sweep(device);
+			return AIRSPY_ERROR_THREAD;
+		}
+		device->sweep_thread_running = true;
+		apply_sweep_thread_params(device);
+
+		return AIRSPY_SUCCESS;
+	}
+
+	int ADDCALL airspy_stop_sweep(airspy_device_t* device)
+	{
+		device->sweep_running = false;
+
+		if (device->sweep_thread_running)
+		{
+			pthread_join(device->sweep_thread, NULL);
+			device->sweep_thread_running = false;
+		}
+
+		free(device->sweep_steps);
+		device->sweep_steps = NULL;
+		device->sweep_step_count = 0;
+
+		return AIRSPY_SUCCESS;
+	}
+
 	int ADDCALL airspy_set_conversion_filter_float32(struct airspy_device* device, const float *kernel, const uint32_t len)
 	{
 		if (device->streaming)
@@ -1693,8 +4075,10 @@ int airspy_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		begin_gain_change(device);
+
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_LNA_GAIN,
 			0,
@@ -1703,6 +4087,9 @@ int airspy_list_devices(uint64_t *serials, int count)
 			length,
 			LIBUSB_CTRL_TIMEOUT_MS);
 
+		end_gain_change(device, GAIN_FIELD_LNA, value, result >= length);
+		track_registers(device, AIRSPY_SET_LNA_GAIN, 0, value, NULL, result >= length);
+
 		if (result < length)
 		{
 			return AIRSPY_ERROR_LIBUSB;
@@ -1723,8 +4110,10 @@ int airspy_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		begin_gain_change(device);
+
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_MIXER_GAIN,
 			0,
@@ -1733,6 +4122,9 @@ int airspy_list_devices(uint64_t *serials, int count)
 			length,
 			LIBUSB_CTRL_TIMEOUT_MS);
 
+		end_gain_change(device, GAIN_FIELD_MIXER, value, result >= length);
+		track_registers(device, AIRSPY_SET_MIXER_GAIN, 0, value, NULL, result >= length);
+
 		if (result < length)
 		{
 			return AIRSPY_ERROR_LIBUSB;
@@ -1753,8 +4145,10 @@ int airspy_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		begin_gain_change(device);
+
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_VGA_GAIN,
 			0,
@@ -1763,6 +4157,9 @@ int airspy_list_devices(uint64_t *serials, int count)
 			length,
 			LIBUSB_CTRL_TIMEOUT_MS);
 
+		end_gain_change(device, GAIN_FIELD_VGA, value, result >= length);
+		track_registers(device, AIRSPY_SET_VGA_GAIN, 0, value, NULL, result >= length);
+
 		if (result < length)
 		{
 			return AIRSPY_ERROR_LIBUSB;
@@ -1780,8 +4177,10 @@ int airspy_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		begin_gain_change(device);
+
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_LNA_AGC,
 			0,
@@ -1790,6 +4189,9 @@ int airspy_list_devices(uint64_t *serials, int count)
 			length,
 			LIBUSB_CTRL_TIMEOUT_MS);
 
+		end_gain_change(device, GAIN_FIELD_LNA_AGC, value, result >= length);
+		track_registers(device, AIRSPY_SET_LNA_AGC, 0, value, NULL, result >= length);
+
 		if (result < length)
 		{
 			return AIRSPY_ERROR_LIBUSB;
@@ -1807,8 +4209,10 @@ int airspy_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		begin_gain_change(device);
+
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_MIXER_AGC,
 			0,
@@ -1817,6 +4221,9 @@ int airspy_list_devices(uint64_t *serials, int count)
 			length,
 			LIBUSB_CTRL_TIMEOUT_MS);
 
+		end_gain_change(device, GAIN_FIELD_MIXER_AGC, value, result >= length);
+		track_registers(device, AIRSPY_SET_MIXER_AGC, 0, value, NULL, result >= length);
+
 		if (result < length)
 		{
 			return AIRSPY_ERROR_LIBUSB;
@@ -1826,43 +4233,162 @@ int airspy_list_devices(uint64_t *serials, int count)
 		}
 	}
 
-	int ADDCALL airspy_set_linearity_gain(struct airspy_device* device, uint8_t value)
+	int ADDCALL airspy_set_freq_async(airspy_device_t* device, const uint32_t freq_hz, airspy_control_cb_fn callback, void* ctx)
 	{
-		int rc;
+		set_freq_params_t set_freq_params;
 
-		if (value >= GAIN_COUNT)
+		set_freq_params.freq_hz = TO_LE(freq_hz);
+
+		return submit_control(device,
+			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			AIRSPY_SET_FREQ, 0, 0, &set_freq_params, sizeof(set_freq_params_t), GAIN_FIELD_NONE, callback, ctx);
+	}
+
+	int ADDCALL airspy_set_lna_gain_async(airspy_device_t* device, uint8_t value, airspy_control_cb_fn callback, void* ctx)
+	{
+		if (value > 14)
+			value = 14;
+
+		return submit_control(device,
+			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			AIRSPY_SET_LNA_GAIN, 0, value, NULL, 1, GAIN_FIELD_LNA, callback, ctx);
+	}
+
+	int ADDCALL airspy_set_mixer_gain_async(airspy_device_t* device, uint8_t value, airspy_control_cb_fn callback, void* ctx)
+	{
+		if (value > 15)
+			value = 15;
+
+		return submit_control(device,
+			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			AIRSPY_SET_MIXER_GAIN, 0, value, NULL, 1, GAIN_FIELD_MIXER, callback, ctx);
+	}
+
+	int ADDCALL airspy_set_vga_gain_async(airspy_device_t* device, uint8_t value, airspy_control_cb_fn callback, void* ctx)
+	{
+		if (value > 15)
+			value = 15;
+
+		return submit_control(device,
+			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			AIRSPY_SET_VGA_GAIN, 0, value, NULL, 1, GAIN_FIELD_VGA, callback, ctx);
+	}
+
+	int ADDCALL airspy_set_lna_agc_async(airspy_device_t* device, uint8_t value, airspy_control_cb_fn callback, void* ctx)
+	{
+		return submit_control(device,
+			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			AIRSPY_SET_LNA_AGC, 0, value, NULL, 1, GAIN_FIELD_LNA_AGC, callback, ctx);
+	}
+
+	int ADDCALL airspy_set_mixer_agc_async(airspy_device_t* device, uint8_t value, airspy_control_cb_fn callback, void* ctx)
+	{
+		return submit_control(device,
+			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			AIRSPY_SET_MIXER_AGC, 0, value, NULL, 1, GAIN_FIELD_MIXER_AGC, callback, ctx);
+	}
+
+	int ADDCALL airspy_r820t_write_async(airspy_device_t* device, uint8_t register_number, uint8_t value, airspy_control_cb_fn callback, void* ctx)
+	{
+		return submit_control(device,
+			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+			AIRSPY_R820T_WRITE, value, register_number, NULL, 0, GAIN_FIELD_NONE, callback, ctx);
+	}
+
+	int ADDCALL airspy_wait_controls(airspy_device_t* device, int timeout_ms)
+	{
+		int result = 0;
+		struct timespec deadline;
+
+		if (timeout_ms >= 0)
 		{
-			value = GAIN_COUNT - 1;
+			spsc_ring_deadline(&deadline, timeout_ms);
 		}
 
-		value = GAIN_COUNT - 1 - value;
+		pthread_mutex_lock(&device->control_mutex);
+		while (device->controls_in_flight != 0 && result == 0)
+		{
+			if (timeout_ms >= 0)
+			{
+				result = pthread_cond_timedwait(&device->control_cond, &device->control_mutex, &deadline);
+			}
+			else
+			{
+				pthread_cond_wait(&device->control_cond, &device->control_mutex);
+			}
+		}
+		result = device->controls_in_flight == 0 ? AIRSPY_SUCCESS : AIRSPY_ERROR_BUSY;
+		pthread_mutex_unlock(&device->control_mutex);
+
+		return result;
+	}
 
-		rc = airspy_set_mixer_agc(device, 0);
-		if (rc < 0)
-			return rc;
+	int ADDCALL airspy_refresh_registers(airspy_device_t* device, uint32_t chips)
+	{
+		int result = AIRSPY_SUCCESS;
+		control_batch_t batch;
+
+		airspy_invalidate_registers(device, chips);
+
+		batch.remaining = 0;
+		batch.failed = 0;
+
+		if (chips & AIRSPY_REGISTERS_R820T)
+		{
+			result = refresh_shadow(device, &device->r820t_shadow, AIRSPY_R820T_READ, &batch);
+		}
+		if (result == AIRSPY_SUCCESS && (chips & AIRSPY_REGISTERS_SI5351C))
+		{
+			result = refresh_shadow(device, &device->si5351c_shadow, AIRSPY_SI5351C_READ, &batch);
+		}
 
-		rc = airspy_set_lna_agc(device, 0);
-		if (rc < 0)
-			return rc;
+		wait_control_batch(device, &batch, 0);
 
-		rc = airspy_set_vga_gain(device, airspy_linearity_vga_gains[value]);
-		if (rc < 0)
-			return rc;
+		if (result == AIRSPY_SUCCESS && batch.failed)
+		{
+			result = AIRSPY_ERROR_LIBUSB;
+		}
 
-		rc = airspy_set_mixer_gain(device, airspy_linearity_mixer_gains[value]);
-		if (rc < 0)
-			return rc;
+		return result;
+	}
 
-		rc = airspy_set_lna_gain(device, airspy_linearity_lna_gains[value]);
-		if (rc < 0)
-			return rc;
+	int ADDCALL airspy_invalidate_registers(airspy_device_t* device, uint32_t chips)
+	{
+		pthread_mutex_lock(&device->register_mutex);
+		if (chips & AIRSPY_REGISTERS_R820T)
+		{
+			register_shadow_invalidate_all(&device->r820t_shadow);
+		}
+		if (chips & AIRSPY_REGISTERS_SI5351C)
+		{
+			register_shadow_invalidate_all(&device->si5351c_shadow);
+		}
+		pthread_mutex_unlock(&device->register_mutex);
 
 		return AIRSPY_SUCCESS;
 	}
 
-	int ADDCALL airspy_set_sensitivity_gain(struct airspy_device* device, uint8_t value)
+	int ADDCALL airspy_set_gains(airspy_device_t* device, const airspy_gains_t* gains)
+	{
+		uint8_t values[GAIN_FIELD_COUNT];
+
+		if (gains == NULL)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		values[GAIN_FIELD_MIXER_AGC] = gains->mixer_agc ? 1 : 0;
+		values[GAIN_FIELD_LNA_AGC] = gains->lna_agc ? 1 : 0;
+		values[GAIN_FIELD_VGA] = gains->vga_gain > 15 ? 15 : gains->vga_gain;
+		values[GAIN_FIELD_MIXER] = gains->mixer_gain > 15 ? 15 : gains->mixer_gain;
+		values[GAIN_FIELD_LNA] = gains->lna_gain > 14 ? 14 : gains->lna_gain;
+
+		return apply_gains(device, values);
+	}
+
+	int ADDCALL airspy_set_linearity_gain(struct airspy_device* device, uint8_t value)
 	{
-		int rc;
+		uint8_t values[GAIN_FIELD_COUNT];
 
 		if (value >= GAIN_COUNT)
 		{
@@ -1871,27 +4397,33 @@ int airspy_list_devices(uint64_t *serials, int count)
 
 		value = GAIN_COUNT - 1 - value;
 
-		rc = airspy_set_mixer_agc(device, 0);
-		if (rc < 0)
-			return rc;
+		values[GAIN_FIELD_MIXER_AGC] = 0;
+		values[GAIN_FIELD_LNA_AGC] = 0;
+		values[GAIN_FIELD_VGA] = airspy_linearity_vga_gains[value];
+		values[GAIN_FIELD_MIXER] = airspy_linearity_mixer_gains[value];
+		values[GAIN_FIELD_LNA] = airspy_linearity_lna_gains[value];
 
-		rc = airspy_set_lna_agc(device, 0);
-		if (rc < 0)
-			return rc;
+		return apply_gains(device, values);
+	}
+
+	int ADDCALL airspy_set_sensitivity_gain(struct airspy_device* device, uint8_t value)
+	{
+		uint8_t values[GAIN_FIELD_COUNT];
 
-		rc = airspy_set_vga_gain(device, airspy_sensitivity_vga_gains[value]);
-		if (rc < 0)
-			return rc;
+		if (value >= GAIN_COUNT)
+		{
+			value = GAIN_COUNT - 1;
+		}
 
-		rc = airspy_set_mixer_gain(device, airspy_sensitivity_mixer_gains[value]);
-		if (rc < 0)
-			return rc;
+		value = GAIN_COUNT - 1 - value;
 
-		rc = airspy_set_lna_gain(device, airspy_sensitivity_lna_gains[value]);
-		if (rc < 0)
-			return rc;
+		values[GAIN_FIELD_MIXER_AGC] = 0;
+		values[GAIN_FIELD_LNA_AGC] = 0;
+		values[GAIN_FIELD_VGA] = airspy_sensitivity_vga_gains[value];
+		values[GAIN_FIELD_MIXER] = airspy_sensitivity_mixer_gains[value];
+		values[GAIN_FIELD_LNA] = airspy_sensitivity_lna_gains[value];
 
-		return AIRSPY_SUCCESS;
+		return apply_gains(device, values);
 	}
 
 	int ADDCALL airspy_set_rf_bias(airspy_device_t* device, uint8_t value)
@@ -1910,8 +4442,14 @@ int airspy_list_devices(uint64_t *serials, int count)
 			return AIRSPY_ERROR_BUSY;
 		}
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		/* The format of a replayed capture is fixed */
+		if (device->file != NULL && (value != 0) != ((device->file_flags & AIRSPY_FILE_PACKED) != 0))
+		{
+			return AIRSPY_ERROR_UNSUPPORTED;
+		}
+
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_PACKING,
 			0,
@@ -1932,7 +4470,7 @@ int airspy_list_devices(uint64_t *serials, int count)
 			free_transfers(device);
 
 			device->packing_enabled = packing_enabled;
-			device->buffer_size = packing_enabled ? (6144 * 24) : 262144;
+			device->buffer_size = stream_buffer_size(device);
 
 			result = allocate_transfers(device);
 			if (result != 0)
@@ -1944,6 +4482,223 @@ int airspy_list_devices(uint64_t *serials, int count)
 		return AIRSPY_SUCCESS;
 	}
 
+	int ADDCALL airspy_set_replay_rate(airspy_device_t* device, uint32_t adc_rate)
+	{
+		if (device->file == NULL)
+		{
+			return AIRSPY_ERROR_UNSUPPORTED;
+		}
+
+		device->replay_rate = adc_rate;
+
+		return AIRSPY_SUCCESS;
+	}
+
+	int ADDCALL airspy_set_stream_config(airspy_device_t* device, const airspy_stream_config_t* config)
+	{
+		int result;
+		uint32_t queue_depth;
+
+		if (config == NULL)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		if (device->streaming)
+		{
+			return AIRSPY_ERROR_BUSY;
+		}
+
+		if (config->transfer_count > MAX_TRANSFER_COUNT || config->queue_depth > MAX_QUEUE_DEPTH)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		if (config->buffer_size != 0 &&
+			(config->buffer_size < MIN_BUFFER_SIZE || config->buffer_size > MAX_BUFFER_SIZE || (config->buffer_size % BUFFER_SIZE_ALIGN) != 0))
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		/* The consumer ring indexes its slots with a mask */
+		queue_depth = config->queue_depth ? 1 : RAW_BUFFER_COUNT;
+		while (queue_depth < config->queue_depth)
+		{
+			queue_depth <<= 1;
+		}
+
+		cancel_transfers(device);
+		free_transfers(device);
+
+		device->transfer_count = config->transfer_count ? config->transfer_count : TRANSFER_COUNT;
+		device->queue_depth = queue_depth;
+		device->requested_buffer_size = config->buffer_size;
+		device->buffer_size = stream_buffer_size(device);
+
+		result = allocate_transfers(device);
+		if (result != AIRSPY_SUCCESS)
+		{
+			free_transfers(device);
+			return result;
+		}
+
+		return AIRSPY_SUCCESS;
+	}
+
+	int ADDCALL airspy_get_stream_config(airspy_device_t* device, airspy_stream_config_t* config)
+	{
+		if (config == NULL)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		config->transfer_count = device->transfer_count;
+		config->buffer_size = device->buffer_size;
+		config->queue_depth = device->queue_depth;
+
+		return AIRSPY_SUCCESS;
+	}
+
+	int ADDCALL airspy_read_samples(airspy_device_t* device, void* buffer, int sample_count, int timeout_ms)
+	{
+		struct timespec deadline;
+
+		if (timeout_ms < 0)
+		{
+			return read_samples(device, buffer, sample_count, NULL, true);
+		}
+
+		spsc_ring_deadline(&deadline, timeout_ms);
+		return read_samples(device, buffer, sample_count, &deadline, true);
+	}
+
+	int ADDCALL airspy_try_read(airspy_device_t* device, void* buffer, int sample_count)
+	{
+		return read_samples(device, buffer, sample_count, NULL, false);
+	}
+
+	int ADDCALL airspy_set_buffer_pool(airspy_device_t* device, uint32_t count)
+	{
+		if (device->streaming)
+		{
+			return AIRSPY_ERROR_BUSY;
+		}
+
+		if (count > MAX_POOL_COUNT)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		device->pool_count = count;
+
+		return AIRSPY_SUCCESS;
+	}
+
+	int ADDCALL airspy_set_conversion_threads(airspy_device_t* device, uint32_t count)
+	{
+		if (device->streaming)
+		{
+			return AIRSPY_ERROR_BUSY;
+		}
+
+		if (count > MAX_CONVERSION_THREADS)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		free_conversion_team(device);
+		device->conversion_threads = count;
+
+		return AIRSPY_SUCCESS;
+	}
+
+	int ADDCALL airspy_set_decimation(airspy_device_t* device, uint32_t factor)
+	{
+		if (device->streaming)
+		{
+			return AIRSPY_ERROR_BUSY;
+		}
+
+		if (factor == 0 || factor > MAX_DECIMATION || (factor & (factor - 1)) != 0)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		free_decimators(device);
+		if (factor == 1)
+		{
+			return AIRSPY_SUCCESS;
+		}
+
+		return create_decimators(device, factor);
+	}
+
+	int ADDCALL airspy_set_thread_params(airspy_device_t* device, enum airspy_thread_role role, const airspy_thread_params_t* params)
+	{
+		int result;
+
+		if ((int) role < 0 || role >= THREAD_ROLE_COUNT)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		result = import_thread_params(&device->thread_params[role], params);
+		if (result != AIRSPY_SUCCESS || !device->streaming)
+		{
+			return result;
+		}
+
+		return apply_device_thread_params(device);
+	}
+
+	int ADDCALL airspy_retain_samples(airspy_device_t* device, void* samples)
+	{
+		if (!device->pool_active || buffer_pool_retain(&device->pool, samples) != 0)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		return AIRSPY_SUCCESS;
+	}
+
+	int ADDCALL airspy_release_samples(airspy_device_t* device, void* samples)
+	{
+		if (!device->pool_active || buffer_pool_release(&device->pool, samples) != 0)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		/* A shared worker left slots queued when the pool ran dry */
+		if (device->context != NULL && atomic_load_seq_cst(&device->pool_starved) &&
+			atomic_compare_exchange(&device->pool_starved, 1, 0))
+		{
+			work_pool_schedule(&device->context->workers, &device->work);
+		}
+
+		return AIRSPY_SUCCESS;
+	}
+
+	int ADDCALL airspy_get_stream_stats(airspy_device_t* device, airspy_stream_stats_t* stats)
+	{
+		if (stats == NULL)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		*stats = device->stats;
+		stats->queue_depth = device->queue_depth;
+		compute_percentiles(&stats->conversion);
+		compute_percentiles(&stats->callback);
+		compute_percentiles(&stats->completion);
+
+		return AIRSPY_SUCCESS;
+	}
+
+	int ADDCALL airspy_is_zero_copy(airspy_device_t* device)
+	{
+		return device->usb_buffers_mapped ? AIRSPY_TRUE : AIRSPY_SUCCESS;
+	}
+
 	int ADDCALL airspy_is_streaming(airspy_device_t* device)
 	{
 		return (device->streaming == true && device->stop_requested == false);
@@ -1971,6 +4726,9 @@ int airspy_list_devices(uint64_t *serials, int count)
 		case AIRSPY_ERROR_NO_MEM:
 			return "AIRSPY_ERROR_NO_MEM";
 
+		case AIRSPY_ERROR_UNSUPPORTED:
+			return "AIRSPY_ERROR_UNSUPPORTED";
+
 		case AIRSPY_ERROR_LIBUSB:
 			return "AIRSPY_ERROR_LIBUSB";
 
@@ -96,6 +96,31 @@ enum airspy_sample_type
 
 struct airspy_device;
 
+/*
+ * airspy_transfer_t.gain_state: LNA, mixer and VGA gains and the AGC flags
+ * last applied through the library. UNKNOWN while a gain was never set since
+ * open or its last update failed; CHANGING when an update was in flight or
+ * completed during the block, whose samples may then span both settings.
+ */
+#define AIRSPY_GAIN_STATE_LNA(state) ((state) & 0xF)
+#define AIRSPY_GAIN_STATE_MIXER(state) (((state) >> 4) & 0xF)
+#define AIRSPY_GAIN_STATE_VGA(state) (((state) >> 8) & 0xF)
+#define AIRSPY_GAIN_STATE_LNA_AGC (1 << 12)
+#define AIRSPY_GAIN_STATE_MIXER_AGC (1 << 13)
+#define AIRSPY_GAIN_STATE_UNKNOWN (1 << 14)
+#define AIRSPY_GAIN_STATE_CHANGING (1 << 15)
+
+/*
+ * airspy_transfer_t.sweep_flags: STEP when the samples follow the retune of
+ * step sweep_step, SETTLING while they are within its settle time
+ */
+#define AIRSPY_SWEEP_STEP (1 << 0)
+#define AIRSPY_SWEEP_SETTLING (1 << 1)
+
+/* airspy_start_sweep() flags */
+#define AIRSPY_SWEEP_DISCARD_SETTLING (1 << 0)
+#define AIRSPY_SWEEP_ONCE (1 << 1)
+
 typedef struct {
 	struct airspy_device* device;
 	void* ctx;
@@ -103,6 +128,20 @@ typedef struct {
 	int sample_count;
 	uint64_t dropped_samples;
 	enum airspy_sample_type sample_type;
+	/* Index of the first sample since airspy_start_rx(), dropped samples included */
+	uint64_t sample_index;
+	/*
+	 * Host time of the first sample in ns, on CLOCK_MONOTONIC and CLOCK_REALTIME,
+	 * filtered from the USB completion times; late by the constant USB latency
+	 */
+	uint64_t timestamp_ns;
+	uint64_t realtime_ns;
+	/* Gains the block was captured under, AIRSPY_GAIN_STATE_* */
+	uint32_t gain_state;
+	/* Center frequency of the samples, 0 when unknown; see airspy_start_sweep() */
+	uint32_t freq_hz;
+	uint32_t sweep_step;
+	uint32_t sweep_flags;
 } airspy_transfer_t, airspy_transfer;
 
 typedef struct {
@@ -118,6 +157,104 @@ typedef struct {
 
 typedef int (*airspy_sample_block_cb_fn)(airspy_transfer* transfer);
 
+/* result is AIRSPY_SUCCESS or AIRSPY_ERROR_LIBUSB */
+typedef void (*airspy_control_cb_fn)(struct airspy_device* device, int result, void* ctx);
+
+struct airspy_context;
+
+/*
+ * Streaming resources, a zero field selects the default.
+ * transfer_count: USB transfers kept in flight (default 16, max 256).
+ * buffer_size: bytes per USB transfer, a multiple of 512 between 1536 and 4 MiB
+ *   (default 262144, or 147456 when packed). With packing enabled it is rounded
+ *   down to a multiple of 1536 so that every buffer holds whole packets.
+ * queue_depth: buffers queued for the consumer thread before new ones are
+ *   dropped, rounded up to a power of two (default 8, max 1024).
+ */
+typedef struct {
+	uint32_t transfer_count;
+	uint32_t buffer_size;
+	uint32_t queue_depth;
+} airspy_stream_config_t;
+
+#define AIRSPY_STATS_HISTOGRAM_BINS (32)
+
+/* Durations in ns; histogram bin i counts durations in [2^i, 2^(i+1)), percentiles are bin upper bounds */
+typedef struct {
+	uint64_t count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	uint64_t p50_ns;
+	uint64_t p99_ns;
+	uint64_t histogram[AIRSPY_STATS_HISTOGRAM_BINS];
+} airspy_timing_stats_t;
+
+typedef struct {
+	uint64_t transfers_completed;
+	uint64_t transfers_failed;
+	uint64_t transfers_resubmitted;
+	uint64_t buffers_dropped;
+	uint64_t buffers_delivered;
+	uint32_t queue_depth;
+	uint32_t queue_high_water;
+	airspy_timing_stats_t conversion;
+	airspy_timing_stats_t callback;
+	airspy_timing_stats_t completion;
+} airspy_stream_stats_t;
+
+/* Complete tuner gain setting, see airspy_set_gains() */
+typedef struct {
+	uint8_t lna_gain;
+	uint8_t mixer_gain;
+	uint8_t vga_gain;
+	uint8_t lna_agc;
+	uint8_t mixer_agc;
+} airspy_gains_t;
+
+/* One hop of a sweep, see airspy_start_sweep() */
+typedef struct {
+	uint32_t freq_hz;
+	uint32_t dwell_us;
+	uint32_t settle_us;
+} airspy_sweep_step_t;
+
+/*
+ * Library threads, by role. On a device: the libusb event thread and the
+ * sweep thread, the consumer thread running conversion and callbacks, and the
+ * helpers added by airspy_set_conversion_threads(). On a shared context: its
+ * event loops and its workers.
+ */
+enum airspy_thread_role
+{
+	AIRSPY_THREAD_EVENT = 0,
+	AIRSPY_THREAD_CONSUMER = 1,
+	AIRSPY_THREAD_CONVERSION = 2,
+};
+
+enum airspy_sched_policy
+{
+	AIRSPY_SCHED_DEFAULT = 0,
+	AIRSPY_SCHED_FIFO = 1,
+	AIRSPY_SCHED_RR = 2,
+};
+
+/*
+ * cpu_mask: bit n pins the threads to core n, 0 leaves the affinity alone.
+ * policy / priority: realtime scheduling, priority within the range of the
+ *   policy (1-99 on Linux, 0 on Windows where both map to time critical).
+ *   Linux needs CAP_SYS_NICE or an RLIMIT_RTPRIO allowance.
+ * name: thread name shown by top and perf, empty keeps the default
+ *   (airspy-usb, airspy-rx, airspy-cnvN, airspy-evN, airspy-workN); roles
+ *   with several threads get their index appended. The sweep thread always
+ *   keeps airspy-sweep.
+ */
+typedef struct {
+	uint64_t cpu_mask;
+	enum airspy_sched_policy policy;
+	int priority;
+	char name[16];
+} airspy_thread_params_t;
+
 extern ADDAPI void ADDCALL airspy_lib_version(airspy_lib_version_t* lib_version);
 /* airspy_init() deprecated */
 extern ADDAPI int ADDCALL airspy_init(void);
@@ -129,6 +266,43 @@ extern ADDAPI int ADDCALL airspy_list_devices(uint64_t *serials, int count);
 extern ADDAPI int ADDCALL airspy_open_sn(struct airspy_device** device, uint64_t serial_number);
 extern ADDAPI int ADDCALL airspy_open_fd(struct airspy_device** device, int fd);
 extern ADDAPI int ADDCALL airspy_open(struct airspy_device** device);
+
+/*
+ * Opens a RAW capture, as written by airspy_rx -t 5, as a device whose stream
+ * replays the file through the same transfer callback, queue, consumer and
+ * converters as a receiver. AIRSPY_FILE_PACKED marks a packed capture, which
+ * also fixes airspy_set_packing(). Buffers are paced at the sample rate set
+ * with airspy_set_samplerate() unless AIRSPY_FILE_FAST, and the stream ends
+ * with the file unless AIRSPY_FILE_LOOP. Control requests succeed without
+ * effect and reads return zeros; async callbacks run before the call returns.
+ */
+#define AIRSPY_FILE_PACKED (1 << 0)
+#define AIRSPY_FILE_FAST (1 << 1)
+#define AIRSPY_FILE_LOOP (1 << 2)
+extern ADDAPI int ADDCALL airspy_open_file(struct airspy_device** device, const char* path, uint32_t flags);
+
+/*
+ * Paces a replayed capture at adc_rate ADC words per second instead of the
+ * sample rate, from the next airspy_start_rx(); 0 restores the sample rate.
+ * Lets the host path be loaded at any rate without a receiver.
+ */
+extern ADDAPI int ADDCALL airspy_set_replay_rate(struct airspy_device* device, uint32_t adc_rate);
+
+/*
+ * Shared context for many devices: event_threads libusb event loops (0 = 1),
+ * each serving the devices assigned to it, and worker_threads threads (0 = 1)
+ * that run the sample conversion and callbacks of every device, one buffer
+ * of a device at a time and in order. Devices opened with
+ * airspy_open_shared() start no threads of their own. The context can only
+ * be destroyed once all its devices are closed. A serial_number of 0 opens
+ * the first free device.
+ */
+extern ADDAPI int ADDCALL airspy_context_create(struct airspy_context** context, uint32_t event_threads, uint32_t worker_threads);
+extern ADDAPI int ADDCALL airspy_context_destroy(struct airspy_context* context);
+extern ADDAPI int ADDCALL airspy_open_shared(struct airspy_context* context, struct airspy_device** device, uint64_t serial_number);
+
+/* Applies at once to the running event loops or workers; AIRSPY_THREAD_CONVERSION is set per device */
+extern ADDAPI int ADDCALL airspy_context_set_thread_params(struct airspy_context* context, enum airspy_thread_role role, const airspy_thread_params_t* params);
 extern ADDAPI int ADDCALL airspy_close(struct airspy_device* device);
 
 /* Use airspy_get_samplerates(device, buffer, 0) to get the number of available sample rates. It will be returned in the first element of buffer */
@@ -140,6 +314,7 @@ extern ADDAPI int ADDCALL airspy_set_samplerate(struct airspy_device* device, ui
 extern ADDAPI int ADDCALL airspy_set_conversion_filter_float32(struct airspy_device* device, const float *kernel, const uint32_t len);
 extern ADDAPI int ADDCALL airspy_set_conversion_filter_int16(struct airspy_device* device, const int16_t *kernel, const uint32_t len);
 
+/* A NULL callback starts the stream in pull mode, see airspy_read_samples() */
 extern ADDAPI int ADDCALL airspy_start_rx(struct airspy_device* device, airspy_sample_block_cb_fn callback, void* rx_ctx);
 extern ADDAPI int ADDCALL airspy_stop_rx(struct airspy_device* device);
 
@@ -153,6 +328,24 @@ extern ADDAPI int ADDCALL airspy_config_write(struct airspy_device* device, cons
 extern ADDAPI int ADDCALL airspy_config_read(struct airspy_device* device, const uint8_t page_index, const uint16_t length, unsigned char *data);
 
 extern ADDAPI int ADDCALL airspy_r820t_write(struct airspy_device* device, uint8_t register_number, uint8_t value);
+
+/*
+ * Register shadow: once a R820T or Si5351C register was read or written, the
+ * read functions above answer from a host copy and writes of the value it
+ * already holds return without a USB transfer. Status registers (R820T 0-4,
+ * Si5351C 0, 1) and the Si5351C PLL reset (177) always go to the chip.
+ * Firmware commands that reprogram the chips (frequency, gains, sample rate,
+ * receiver mode) drop the registers they may change.
+ * airspy_refresh_registers() reloads the copy of the chips selected by the
+ * AIRSPY_REGISTERS_* mask with pipelined reads; airspy_invalidate_registers()
+ * drops it so that the next access goes to the chip.
+ */
+#define AIRSPY_REGISTERS_R820T (1 << 0)
+#define AIRSPY_REGISTERS_SI5351C (1 << 1)
+#define AIRSPY_REGISTERS_ALL (AIRSPY_REGISTERS_R820T | AIRSPY_REGISTERS_SI5351C)
+
+extern ADDAPI int ADDCALL airspy_refresh_registers(struct airspy_device* device, uint32_t chips);
+extern ADDAPI int ADDCALL airspy_invalidate_registers(struct airspy_device* device, uint32_t chips);
 extern ADDAPI int ADDCALL airspy_r820t_read(struct airspy_device* device, uint8_t register_number, uint8_t* value);
 
 /* Parameter value shall be 0=clear GPIO or 1=set GPIO */
@@ -199,6 +392,50 @@ extern ADDAPI int ADDCALL airspy_set_lna_agc(struct airspy_device* device, uint8
 */
 extern ADDAPI int ADDCALL airspy_set_mixer_agc(struct airspy_device* device, uint8_t value);
 
+/*
+ * Asynchronous setters: the request is queued on the control endpoint and the
+ * call returns at once, so requests issued back to back are pipelined and
+ * execute in order. callback (may be NULL) runs on the libusb event thread
+ * when the request completes; it must not block or call
+ * airspy_wait_controls(). Returns AIRSPY_ERROR_BUSY with 256 requests in flight.
+ * airspy_wait_controls() waits until every request issued so far completed
+ * (timeout_ms < 0 waits forever) and returns AIRSPY_ERROR_BUSY on timeout.
+ */
+extern ADDAPI int ADDCALL airspy_set_freq_async(struct airspy_device* device, const uint32_t freq_hz, airspy_control_cb_fn callback, void* ctx);
+extern ADDAPI int ADDCALL airspy_set_lna_gain_async(struct airspy_device* device, uint8_t value, airspy_control_cb_fn callback, void* ctx);
+extern ADDAPI int ADDCALL airspy_set_mixer_gain_async(struct airspy_device* device, uint8_t value, airspy_control_cb_fn callback, void* ctx);
+extern ADDAPI int ADDCALL airspy_set_vga_gain_async(struct airspy_device* device, uint8_t value, airspy_control_cb_fn callback, void* ctx);
+extern ADDAPI int ADDCALL airspy_set_lna_agc_async(struct airspy_device* device, uint8_t value, airspy_control_cb_fn callback, void* ctx);
+extern ADDAPI int ADDCALL airspy_set_mixer_agc_async(struct airspy_device* device, uint8_t value, airspy_control_cb_fn callback, void* ctx);
+extern ADDAPI int ADDCALL airspy_r820t_write_async(struct airspy_device* device, uint8_t register_number, uint8_t value, airspy_control_cb_fn callback, void* ctx);
+extern ADDAPI int ADDCALL airspy_wait_controls(struct airspy_device* device, int timeout_ms);
+
+/*
+ * Applies a complete gain setting, sending only the registers whose value
+ * differs from the last one applied, all pipelined, and returns once they
+ * completed. Must not be called from an async control callback.
+ * airspy_set_linearity_gain() and airspy_set_sensitivity_gain() go through
+ * the same path.
+ */
+extern ADDAPI int ADDCALL airspy_set_gains(struct airspy_device* device, const airspy_gains_t* gains);
+
+/*
+ * Hops through step_count steps, repeating unless AIRSPY_SWEEP_ONCE is set,
+ * while streaming in callback mode. A library thread retunes at each step
+ * boundary and callback blocks are split where a retune took effect, each
+ * part tagged with freq_hz, sweep_step and sweep_flags. Samples captured from
+ * the retune request until settle_us after its completion are SETTLING, then
+ * dwell_us of samples follow; settle_us should cover the USB latency of the
+ * timestamps. AIRSPY_SWEEP_DISCARD_SETTLING drops SETTLING parts instead of
+ * delivering them. Packed AIRSPY_SAMPLE_RAW blocks are not split: they carry
+ * the tags of their first sample and SETTLING if any part of them settles or
+ * a retune begins in them. A late retune shifts the following steps, it never
+ * shortens one. The steps are copied. airspy_stop_sweep() returns once no
+ * further retune will be issued; airspy_stop_rx() stops the sweep as well.
+ */
+extern ADDAPI int ADDCALL airspy_start_sweep(struct airspy_device* device, const airspy_sweep_step_t* steps, uint32_t step_count, uint32_t flags);
+extern ADDAPI int ADDCALL airspy_stop_sweep(struct airspy_device* device);
+
 /* Parameter value: 0..21 */
 extern ADDAPI int ADDCALL airspy_set_linearity_gain(struct airspy_device* device, uint8_t value);
 
@@ -211,6 +448,73 @@ extern ADDAPI int ADDCALL airspy_set_rf_bias(struct airspy_device* dev, uint8_t
 /* Parameter value shall be 0=Disable Packing or 1=Enable Packing */
 extern ADDAPI int ADDCALL airspy_set_packing(struct airspy_device* device, uint8_t value);
 
+/*
+ * Splits the conversion of every buffer across count threads, the streaming
+ * thread included; 0 or 1 (default) converts on the streaming thread alone.
+ * The output is bit exact with the single threaded conversion. Must be
+ * called while not streaming, takes effect at the next airspy_start_rx().
+ */
+extern ADDAPI int ADDCALL airspy_set_conversion_threads(struct airspy_device* device, uint32_t count);
+
+/*
+ * Decimates IQ output by factor, a power of two up to 256 (1 = off, the
+ * default), with a cascade of half-band stages run on each part of a buffer
+ * right after the IQ conversion, so blocks carry sample_rate / factor complex
+ * samples and sample indexes count them. The last stage has the conversion
+ * half-band response, the earlier ones a short half-band. Real and RAW sample
+ * types are not decimated. Must be called while not streaming.
+ */
+extern ADDAPI int ADDCALL airspy_set_decimation(struct airspy_device* device, uint32_t factor);
+
+/*
+ * Placement, scheduling and name of the device threads of one role. Kept for
+ * every following airspy_start_rx(), where failures are ignored, and applied
+ * at once while streaming, where AIRSPY_ERROR_THREAD reports that the system
+ * refused part of it. Devices on a shared context only own conversion helpers.
+ */
+extern ADDAPI int ADDCALL airspy_set_thread_params(struct airspy_device* device, enum airspy_thread_role role, const airspy_thread_params_t* params);
+
+/* Must be called while not streaming; get returns the values in effect */
+extern ADDAPI int ADDCALL airspy_set_stream_config(struct airspy_device* device, const airspy_stream_config_t* config);
+extern ADDAPI int ADDCALL airspy_get_stream_config(struct airspy_device* device, airspy_stream_config_t* config);
+
+/*
+ * Pull mode reads, from a single thread, samples of the configured type.
+ * sample_count counts complex samples for IQ types and 16 bit words for
+ * AIRSPY_SAMPLE_RAW. airspy_read_samples() blocks until sample_count samples
+ * are read or timeout_ms expires (negative waits forever), airspy_try_read()
+ * returns what is already queued. Both return the number of samples read, or
+ * AIRSPY_ERROR_STREAMING_STOPPED once streaming ended and the queue is empty.
+ */
+extern ADDAPI int ADDCALL airspy_read_samples(struct airspy_device* device, void* buffer, int sample_count, int timeout_ms);
+extern ADDAPI int ADDCALL airspy_try_read(struct airspy_device* device, void* buffer, int sample_count);
+
+/*
+ * Retained blocks: with count > 0 each callback block is delivered in one of
+ * count pool buffers instead of a buffer reused for the next block. A callback
+ * may keep transfer->samples past its return with airspy_retain_samples() and
+ * hand it to another thread, which calls airspy_release_samples() when done;
+ * any pointer into the block, such as a sweep part, identifies it.
+ * When every buffer is retained the stream waits and excess USB buffers are
+ * dropped; on a shared context the device yields its worker and resumes on
+ * the next release. All blocks must be released before the next start and before
+ * airspy_close(). count = 0 (default) disables the pool; not used in pull mode.
+ */
+extern ADDAPI int ADDCALL airspy_set_buffer_pool(struct airspy_device* device, uint32_t count);
+extern ADDAPI int ADDCALL airspy_retain_samples(struct airspy_device* device, void* samples);
+extern ADDAPI int ADDCALL airspy_release_samples(struct airspy_device* device, void* samples);
+
+/*
+ * Counters since the last airspy_start_rx(), safe to poll while streaming.
+ * conversion times every USB buffer conversion (callback and pull mode),
+ * callback times the application's sample callback and completion the USB
+ * transfer callback, from its entry to the buffer being queued or dropped.
+ */
+extern ADDAPI int ADDCALL airspy_get_stream_stats(struct airspy_device* device, airspy_stream_stats_t* stats);
+
+/* return AIRSPY_TRUE when the USB buffers are kernel mapped (no copy per transfer), AIRSPY_SUCCESS when heap allocated */
+extern ADDAPI int ADDCALL airspy_is_zero_copy(struct airspy_device* device);
+
 extern ADDAPI const char* ADDCALL airspy_error_name(enum airspy_error errcode);
 extern ADDAPI const char* ADDCALL airspy_board_id_name(enum airspy_board_id board_id);
 
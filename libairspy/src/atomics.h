@@ -0,0 +1,47 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef ATOMICS_H
+#define ATOMICS_H
+
+#include <stdint.h>
+
+/* 32 bit atomics on volatile uint32_t, Interlocked operations are full barriers on every MSVC target */
+#if defined(_MSC_VER)
+  #include <intrin.h>
+  #define atomic_load_acquire(p) ((uint32_t) _InterlockedOr((volatile long *) (p), 0))
+  #define atomic_load_seq_cst(p) ((uint32_t) _InterlockedOr((volatile long *) (p), 0))
+  #define atomic_store_release(p, v) _InterlockedExchange((volatile long *) (p), (long) (v))
+  #define atomic_store_seq_cst(p, v) _InterlockedExchange((volatile long *) (p), (long) (v))
+  #define atomic_add_fetch(p, v) ((uint32_t) _InterlockedExchangeAdd((volatile long *) (p), (long) (v)) + (uint32_t) (v))
+  #define atomic_compare_exchange(p, expected, desired) \
+	(_InterlockedCompareExchange((volatile long *) (p), (long) (desired), (long) (expected)) == (long) (expected))
+#else
+  #define atomic_load_acquire(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define atomic_load_seq_cst(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+  #define atomic_store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+  #define atomic_store_seq_cst(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+  #define atomic_add_fetch(p, v) __atomic_add_fetch((p), (v), __ATOMIC_SEQ_CST)
+  #define atomic_compare_exchange(p, expected, desired) \
+	__sync_bool_compare_and_swap((p), (expected), (desired))
+#endif
+
+#endif // ATOMICS_H
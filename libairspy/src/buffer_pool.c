@@ -0,0 +1,229 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+
+#include "buffer_pool.h"
+#include "atomics.h"
+
+int buffer_pool_init(buffer_pool_t *pool, uint32_t count, size_t buffer_size)
+{
+	/* Keeps every buffer aligned for the widest SIMD store */
+	buffer_size = (buffer_size + 63) & ~(size_t) 63;
+
+	pool->memory = (uint8_t *) malloc(buffer_size * count);
+	pool->refs = (volatile uint32_t *) calloc(count, sizeof(uint32_t));
+	if (pool->memory == NULL || pool->refs == NULL)
+	{
+		free(pool->memory);
+		free((void *) pool->refs);
+		return -1;
+	}
+
+	pool->buffer_size = buffer_size;
+	pool->count = count;
+	pool->next = 0;
+	pool->waiting = 0;
+	pool->closed = 0;
+
+	if (pthread_mutex_init(&pool->mutex, NULL) != 0)
+	{
+		free(pool->memory);
+		free((void *) pool->refs);
+		return -1;
+	}
+
+	if (pthread_cond_init(&pool->cond, NULL) != 0)
+	{
+		pthread_mutex_destroy(&pool->mutex);
+		free(pool->memory);
+		free((void *) pool->refs);
+		return -1;
+	}
+
+	return 0;
+}
+
+void buffer_pool_destroy(buffer_pool_t *pool)
+{
+	pthread_cond_destroy(&pool->cond);
+	pthread_mutex_destroy(&pool->mutex);
+	free(pool->memory);
+	free((void *) pool->refs);
+	pool->memory = NULL;
+	pool->refs = NULL;
+	pool->count = 0;
+}
+
+/* Any address inside a buffer names it, callers may hand out parts of one */
+static int buffer_index(buffer_pool_t *pool, void *buffer)
+{
+	size_t offset;
+
+	if ((uint8_t *) buffer < pool->memory)
+	{
+		return -1;
+	}
+
+	offset = (size_t) ((uint8_t *) buffer - pool->memory);
+	if (offset / pool->buffer_size >= pool->count)
+	{
+		return -1;
+	}
+
+	return (int) (offset / pool->buffer_size);
+}
+
+/* Only the allocating thread moves a count away from zero, so this cannot race */
+static void *try_acquire(buffer_pool_t *pool)
+{
+	uint32_t i;
+	uint32_t index;
+
+	for (i = 0; i < pool->count; i++)
+	{
+		index = (pool->next + i) % pool->count;
+		if (atomic_load_seq_cst(&pool->refs[index]) == 0)
+		{
+			atomic_store_release(&pool->refs[index], 1);
+			pool->next = (index + 1) % pool->count;
+			return pool->memory + (size_t) index * pool->buffer_size;
+		}
+	}
+
+	return NULL;
+}
+
+void *buffer_pool_acquire(buffer_pool_t *pool)
+{
+	void *buffer;
+
+	if (pool->closed)
+	{
+		return NULL;
+	}
+
+	buffer = try_acquire(pool);
+	if (buffer != NULL)
+	{
+		return buffer;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	atomic_store_seq_cst(&pool->waiting, 1);
+
+	/* Same handshake as the SPSC ring: a release either sees waiting or is seen here */
+	while (!pool->closed && (buffer = try_acquire(pool)) == NULL)
+	{
+		pthread_cond_wait(&pool->cond, &pool->mutex);
+	}
+
+	atomic_store_release(&pool->waiting, 0);
+	pthread_mutex_unlock(&pool->mutex);
+
+	return buffer;
+}
+
+void *buffer_pool_try_acquire(buffer_pool_t *pool)
+{
+	if (pool->closed)
+	{
+		return NULL;
+	}
+
+	return try_acquire(pool);
+}
+
+int buffer_pool_retain(buffer_pool_t *pool, void *buffer)
+{
+	uint32_t refs;
+	int index = buffer_index(pool, buffer);
+
+	if (index < 0)
+	{
+		return -1;
+	}
+
+	/* A free buffer may be handed out again at any time, so it cannot be retained */
+	do
+	{
+		refs = atomic_load_acquire(&pool->refs[index]);
+		if (refs == 0)
+		{
+			return -1;
+		}
+	} while (!atomic_compare_exchange(&pool->refs[index], refs, refs + 1));
+
+	return 0;
+}
+
+int buffer_pool_release(buffer_pool_t *pool, void *buffer)
+{
+	uint32_t refs;
+	int index = buffer_index(pool, buffer);
+
+	if (index < 0)
+	{
+		return -1;
+	}
+
+	do
+	{
+		refs = atomic_load_acquire(&pool->refs[index]);
+		if (refs == 0)
+		{
+			return -1;
+		}
+	} while (!atomic_compare_exchange(&pool->refs[index], refs, refs - 1));
+
+	if (refs == 1 && atomic_load_seq_cst(&pool->waiting))
+	{
+		pthread_mutex_lock(&pool->mutex);
+		pthread_cond_signal(&pool->cond);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+
+	return 0;
+}
+
+uint32_t buffer_pool_in_use(buffer_pool_t *pool)
+{
+	uint32_t i;
+	uint32_t in_use = 0;
+
+	for (i = 0; i < pool->count; i++)
+	{
+		if (atomic_load_acquire(&pool->refs[i]) != 0)
+		{
+			in_use++;
+		}
+	}
+
+	return in_use;
+}
+
+void buffer_pool_close(buffer_pool_t *pool)
+{
+	pthread_mutex_lock(&pool->mutex);
+	pool->closed = 1;
+	pthread_cond_signal(&pool->cond);
+	pthread_mutex_unlock(&pool->mutex);
+}
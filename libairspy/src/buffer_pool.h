@@ -0,0 +1,72 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if _MSC_VER > 1700
+#define HAVE_STRUCT_TIMESPEC
+#endif
+
+#include <pthread.h>
+
+/*
+ * Fixed set of equally sized buffers carved from one block, each with its
+ * own reference count. A buffer is free while its count is zero. Retain and
+ * release are lock free; the mutex and condition variable are only used when
+ * the single allocating thread found every buffer in use and waits for one.
+ */
+typedef struct buffer_pool
+{
+	uint8_t *memory;
+	volatile uint32_t *refs;
+	size_t buffer_size;
+	uint32_t count;
+	uint32_t next;
+	volatile uint32_t waiting;
+	volatile uint32_t closed;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+} buffer_pool_t;
+
+int buffer_pool_init(buffer_pool_t *pool, uint32_t count, size_t buffer_size);
+void buffer_pool_destroy(buffer_pool_t *pool);
+
+/* Single caller: a free buffer with one reference, NULL once the pool is closed */
+void *buffer_pool_acquire(buffer_pool_t *pool);
+
+/* Same caller as buffer_pool_acquire(), but returns NULL instead of waiting when every buffer is in use */
+void *buffer_pool_try_acquire(buffer_pool_t *pool);
+
+/* Any thread: return 0, or -1 when buffer does not point into an outstanding pool buffer */
+int buffer_pool_retain(buffer_pool_t *pool, void *buffer);
+int buffer_pool_release(buffer_pool_t *pool, void *buffer);
+
+/* Number of buffers with at least one reference */
+uint32_t buffer_pool_in_use(buffer_pool_t *pool);
+
+/* Wakes a waiting buffer_pool_acquire() and makes it return NULL */
+void buffer_pool_close(buffer_pool_t *pool);
+
+#endif // BUFFER_POOL_H
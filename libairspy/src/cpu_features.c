@@ -0,0 +1,149 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "cpu_features.h"
+
+#if defined(CPU_X86)
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #else
+    #include <cpuid.h>
+  #endif
+#elif defined(__linux__) && defined(__arm__)
+  #include <sys/auxv.h>
+  #if !defined(HWCAP_NEON)
+    #define HWCAP_NEON (1 << 12)
+  #endif
+#endif
+
+#if defined(CPU_X86)
+
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+#if defined(_MSC_VER)
+	int r[4];
+	__cpuidex(r, (int) leaf, (int) subleaf);
+	regs[0] = r[0];
+	regs[1] = r[1];
+	regs[2] = r[2];
+	regs[3] = r[3];
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t xgetbv(void)
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	uint32_t eax, edx;
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t) edx << 32) | eax;
+#endif
+}
+
+static uint32_t probe_features(void)
+{
+	uint32_t regs[4];
+	uint32_t max_leaf;
+	uint32_t features = 0;
+	uint64_t xcr0 = 0;
+
+	cpuid(0, 0, regs);
+	max_leaf = regs[0];
+	if (max_leaf < 1)
+	{
+		return 0;
+	}
+
+	cpuid(1, 0, regs);
+	if (regs[3] & (1 << 26))
+		features |= CPU_FEATURE_SSE2;
+	if (regs[2] & (1 << 9))
+		features |= CPU_FEATURE_SSSE3;
+	if (regs[2] & (1 << 19))
+		features |= CPU_FEATURE_SSE41;
+
+	/* AVX state must be enabled by the OS (OSXSAVE + XCR0) before any ymm/zmm use */
+	if ((regs[2] & (1 << 27)) && (regs[2] & (1 << 28)))
+	{
+		xcr0 = xgetbv();
+		if ((xcr0 & 0x6) == 0x6)
+		{
+			features |= CPU_FEATURE_AVX;
+			if (regs[2] & (1 << 12))
+				features |= CPU_FEATURE_FMA;
+		}
+	}
+
+	if (max_leaf >= 7 && (features & CPU_FEATURE_AVX))
+	{
+		cpuid(7, 0, regs);
+		if (regs[1] & (1 << 5))
+			features |= CPU_FEATURE_AVX2;
+		if ((xcr0 & 0xe6) == 0xe6)
+		{
+			if (regs[1] & (1 << 16))
+				features |= CPU_FEATURE_AVX512F;
+			if (regs[1] & (1 << 30))
+				features |= CPU_FEATURE_AVX512BW;
+		}
+	}
+
+	return features;
+}
+
+#else
+
+static uint32_t probe_features(void)
+{
+	uint32_t features = 0;
+
+#if defined(CPU_NEON)
+  #if defined(__linux__) && defined(__arm__)
+	if (getauxval(AT_HWCAP) & HWCAP_NEON)
+		features |= CPU_FEATURE_NEON;
+  #else
+	/* NEON is mandatory on AArch64 */
+	features |= CPU_FEATURE_NEON;
+  #endif
+#endif
+
+	return features;
+}
+
+#endif
+
+uint32_t cpu_features_get(void)
+{
+	static volatile int probed = 0;
+	static volatile uint32_t features = 0;
+
+	/* The probe is idempotent, concurrent first calls just compute the same mask */
+	if (!probed)
+	{
+		features = probe_features();
+		probed = 1;
+	}
+
+	return features;
+}
@@ -0,0 +1,69 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#include <stdint.h>
+
+#define CPU_FEATURE_SSE2    (1 << 0)
+#define CPU_FEATURE_SSSE3   (1 << 1)
+#define CPU_FEATURE_SSE41   (1 << 2)
+#define CPU_FEATURE_AVX     (1 << 3)
+#define CPU_FEATURE_AVX2    (1 << 4)
+#define CPU_FEATURE_FMA     (1 << 5)
+#define CPU_FEATURE_AVX512F (1 << 6)
+#define CPU_FEATURE_AVX512BW (1 << 7)
+#define CPU_FEATURE_NEON    (1 << 8)
+
+/*
+ * SIMD kernels are compiled into every build and selected at run time, so
+ * each x86 kernel carries its own target attribute instead of relying on
+ * global -m flags. MSVC accepts the intrinsics without any annotation.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  #define CPU_X86
+  #define TARGET_SSE2 __attribute__((target("sse2")))
+  #define TARGET_SSSE3 __attribute__((target("ssse3")))
+  #define TARGET_SSE41 __attribute__((target("sse4.1")))
+  #define TARGET_AVX __attribute__((target("avx")))
+  #define TARGET_AVX2 __attribute__((target("avx2")))
+  #define TARGET_AVX2_FMA __attribute__((target("avx2,fma")))
+  #define TARGET_AVX512F __attribute__((target("avx512f")))
+#elif (defined(_M_X64) || defined(_M_IX86)) && defined(_MSC_VER)
+  #define CPU_X86
+  #define TARGET_SSE2
+  #define TARGET_SSSE3
+  #define TARGET_SSE41
+  #define TARGET_AVX
+  #define TARGET_AVX2
+  #define TARGET_AVX2_FMA
+  #define TARGET_AVX512F
+#endif
+
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)) && !defined(AIRSPY_BIG_ENDIAN)
+  #define CPU_NEON
+#endif
+
+/* Probes the host once and returns a mask of CPU_FEATURE_* bits */
+uint32_t cpu_features_get(void);
+
+#endif // CPU_FEATURES_H
@@ -0,0 +1,627 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "decimator.h"
+#include "cpu_features.h"
+
+#if defined(CPU_X86)
+  #include <immintrin.h>
+#elif defined(CPU_NEON)
+  #include <arm_neon.h>
+#endif
+
+#if !defined(_MSC_VER)
+  #define _inline inline
+#endif
+
+/* The SIMD kernels gather several outputs per load and read two values past the last tap */
+#define WINDOW_PAD 8
+
+/*
+ * Outputs of a stage: count of them, the first centered on w and each next
+ * one 2 complex samples further. The SIMD kernels keep the scalar order of
+ * operations per output, without fused multiply-adds, so that every level
+ * gives the same samples.
+ */
+typedef void (*outputs_float_fn)(const decimator_float_stage_t *stage, const float *w, float *out, int count);
+typedef void (*outputs_int16_fn)(const decimator_int16_stage_t *stage, const int16_t *w, int16_t *out, int count);
+
+static void outputs_float_scalar(const decimator_float_stage_t *stage, const float *w, float *out, int count);
+static void outputs_int16_scalar(const decimator_int16_stage_t *stage, const int16_t *w, int16_t *out, int count);
+
+static outputs_float_fn outputs_float = outputs_float_scalar;
+static outputs_int16_fn outputs_int16 = outputs_int16_scalar;
+
+static int halfband_len(int len)
+{
+	return len >= 3 && len % 4 == 3;
+}
+
+static void stage_float_free(decimator_float_stage_t *stage)
+{
+	free(stage->taps);
+	free(stage->window);
+}
+
+static int stage_float_init(decimator_float_stage_t *stage, const float *kernel, int len)
+{
+	int j;
+	int half = (len - 1) / 2;
+
+	stage->len = len;
+	stage->pairs = (len + 1) / 4;
+	stage->center = kernel[half];
+	stage->taps = (float *) malloc(stage->pairs * sizeof(float));
+	stage->window = (float *) calloc((len - 1 + DECIMATOR_RUN_SIZE) * 2 + WINDOW_PAD, sizeof(float));
+	if (stage->taps == NULL || stage->window == NULL)
+	{
+		return -1;
+	}
+
+	/* The nonzero taps, nearest to the center first */
+	for (j = 0; j < stage->pairs; j++)
+	{
+		stage->taps[j] = kernel[half - (2 * j + 1)];
+	}
+
+	return 0;
+}
+
+static void outputs_float_scalar(const decimator_float_stage_t *stage, const float *w, float *out, int count)
+{
+	int j, k;
+	float acc_i;
+	float acc_q;
+
+	for (k = 0; k < count; k++, w += 4)
+	{
+		acc_i = stage->center * w[0];
+		acc_q = stage->center * w[1];
+
+		for (j = 0; j < stage->pairs; j++)
+		{
+			acc_i += stage->taps[j] * (w[-4 * j - 2] + w[4 * j + 2]);
+			acc_q += stage->taps[j] * (w[-4 * j - 1] + w[4 * j + 3]);
+		}
+
+		out[2 * k] = acc_i;
+		out[2 * k + 1] = acc_q;
+	}
+}
+
+static int stage_float_process(decimator_float_stage_t *stage, float *samples, int len)
+{
+	int i, run, count;
+	int history = stage->len - 1;
+	int half = history / 2;
+	int out = 0;
+
+	for (i = 0; i < len; i += run)
+	{
+		run = len - i < DECIMATOR_RUN_SIZE ? len - i : DECIMATOR_RUN_SIZE;
+		memcpy(stage->window + 2 * history, samples + 2 * i, run * 2 * sizeof(float));
+
+		/* Every other position from history + phase; outputs land behind the next run, which is still unread */
+		count = run > stage->phase ? (run - stage->phase + 1) / 2 : 0;
+		outputs_float(stage, stage->window + 2 * (history + stage->phase - half), samples + 2 * out, count);
+		out += count;
+
+		stage->phase += 2 * count - run;
+		memmove(stage->window, stage->window + 2 * run, history * 2 * sizeof(float));
+	}
+
+	return out;
+}
+
+decimator_float_t *decimator_float_create(int stage_count, const float *kernel, int len, const float *last_kernel, int last_len)
+{
+	int i;
+	int result = 0;
+	decimator_float_t *dec;
+
+	if (stage_count < 1 || stage_count > DECIMATOR_MAX_STAGES || !halfband_len(len) || !halfband_len(last_len))
+	{
+		return NULL;
+	}
+
+	dec = (decimator_float_t *) calloc(1, sizeof(decimator_float_t));
+	if (dec == NULL)
+	{
+		return NULL;
+	}
+
+	dec->stage_count = stage_count;
+	for (i = 0; i < stage_count && result == 0; i++)
+	{
+		if (i == stage_count - 1)
+		{
+			result = stage_float_init(&dec->stages[i], last_kernel, last_len);
+		}
+		else
+		{
+			result = stage_float_init(&dec->stages[i], kernel, len);
+		}
+	}
+
+	if (result != 0)
+	{
+		decimator_float_free(dec);
+		return NULL;
+	}
+
+	decimator_float_reset(dec);
+
+	return dec;
+}
+
+void decimator_float_free(decimator_float_t *dec)
+{
+	int i;
+
+	if (dec == NULL)
+	{
+		return;
+	}
+
+	for (i = 0; i < dec->stage_count; i++)
+	{
+		stage_float_free(&dec->stages[i]);
+	}
+	free(dec);
+}
+
+void decimator_float_reset(decimator_float_t *dec)
+{
+	int i;
+
+	for (i = 0; i < dec->stage_count; i++)
+	{
+		dec->stages[i].phase = 0;
+		memset(dec->stages[i].window, 0, (dec->stages[i].len - 1) * 2 * sizeof(float));
+	}
+}
+
+int decimator_float_process(decimator_float_t *dec, float *samples, int len)
+{
+	int i;
+
+	for (i = 0; i < dec->stage_count; i++)
+	{
+		len = stage_float_process(&dec->stages[i], samples, len);
+	}
+
+	return len;
+}
+
+static void stage_int16_free(decimator_int16_stage_t *stage)
+{
+	free(stage->taps);
+	free(stage->window);
+}
+
+static int stage_int16_init(decimator_int16_stage_t *stage, const int16_t *kernel, int len)
+{
+	int j;
+	int half = (len - 1) / 2;
+
+	stage->len = len;
+	stage->pairs = (len + 1) / 4;
+	stage->center = kernel[half];
+	stage->taps = (int16_t *) malloc(stage->pairs * sizeof(int16_t));
+	stage->window = (int16_t *) calloc((len - 1 + DECIMATOR_RUN_SIZE) * 2 + WINDOW_PAD, sizeof(int16_t));
+	if (stage->taps == NULL || stage->window == NULL)
+	{
+		return -1;
+	}
+
+	for (j = 0; j < stage->pairs; j++)
+	{
+		stage->taps[j] = kernel[half - (2 * j + 1)];
+	}
+
+	return 0;
+}
+
+/* Q15 accumulator back to a sample, rounded and saturated since the ripple can exceed unity */
+static int16_t round_q15(int32_t acc)
+{
+	acc = (acc + (1 << 14)) >> 15;
+
+	if (acc > 32767)
+	{
+		return 32767;
+	}
+	if (acc < -32768)
+	{
+		return -32768;
+	}
+
+	return (int16_t) acc;
+}
+
+static void outputs_int16_scalar(const decimator_int16_stage_t *stage, const int16_t *w, int16_t *out, int count)
+{
+	int j, k;
+	int32_t acc_i;
+	int32_t acc_q;
+
+	for (k = 0; k < count; k++, w += 4)
+	{
+		acc_i = stage->center * w[0];
+		acc_q = stage->center * w[1];
+
+		for (j = 0; j < stage->pairs; j++)
+		{
+			acc_i += stage->taps[j] * ((int32_t) w[-4 * j - 2] + w[4 * j + 2]);
+			acc_q += stage->taps[j] * ((int32_t) w[-4 * j - 1] + w[4 * j + 3]);
+		}
+
+		out[2 * k] = round_q15(acc_i);
+		out[2 * k + 1] = round_q15(acc_q);
+	}
+}
+
+static int stage_int16_process(decimator_int16_stage_t *stage, int16_t *samples, int len)
+{
+	int i, run, count;
+	int history = stage->len - 1;
+	int half = history / 2;
+	int out = 0;
+
+	for (i = 0; i < len; i += run)
+	{
+		run = len - i < DECIMATOR_RUN_SIZE ? len - i : DECIMATOR_RUN_SIZE;
+		memcpy(stage->window + 2 * history, samples + 2 * i, run * 2 * sizeof(int16_t));
+
+		count = run > stage->phase ? (run - stage->phase + 1) / 2 : 0;
+		outputs_int16(stage, stage->window + 2 * (history + stage->phase - half), samples + 2 * out, count);
+		out += count;
+
+		stage->phase += 2 * count - run;
+		memmove(stage->window, stage->window + 2 * run, history * 2 * sizeof(int16_t));
+	}
+
+	return out;
+}
+
+decimator_int16_t *decimator_int16_create(int stage_count, const int16_t *kernel, int len, const int16_t *last_kernel, int last_len)
+{
+	int i;
+	int result = 0;
+	decimator_int16_t *dec;
+
+	if (stage_count < 1 || stage_count > DECIMATOR_MAX_STAGES || !halfband_len(len) || !halfband_len(last_len))
+	{
+		return NULL;
+	}
+
+	dec = (decimator_int16_t *) calloc(1, sizeof(decimator_int16_t));
+	if (dec == NULL)
+	{
+		return NULL;
+	}
+
+	dec->stage_count = stage_count;
+	for (i = 0; i < stage_count && result == 0; i++)
+	{
+		if (i == stage_count - 1)
+		{
+			result = stage_int16_init(&dec->stages[i], last_kernel, last_len);
+		}
+		else
+		{
+			result = stage_int16_init(&dec->stages[i], kernel, len);
+		}
+	}
+
+	if (result != 0)
+	{
+		decimator_int16_free(dec);
+		return NULL;
+	}
+
+	decimator_int16_reset(dec);
+
+	return dec;
+}
+
+void decimator_int16_free(decimator_int16_t *dec)
+{
+	int i;
+
+	if (dec == NULL)
+	{
+		return;
+	}
+
+	for (i = 0; i < dec->stage_count; i++)
+	{
+		stage_int16_free(&dec->stages[i]);
+	}
+	free(dec);
+}
+
+void decimator_int16_reset(decimator_int16_t *dec)
+{
+	int i;
+
+	for (i = 0; i < dec->stage_count; i++)
+	{
+		dec->stages[i].phase = 0;
+		memset(dec->stages[i].window, 0, (dec->stages[i].len - 1) * 2 * sizeof(int16_t));
+	}
+}
+
+int decimator_int16_process(decimator_int16_t *dec, int16_t *samples, int len)
+{
+	int i;
+
+	for (i = 0; i < dec->stage_count; i++)
+	{
+		len = stage_int16_process(&dec->stages[i], samples, len);
+	}
+
+	return len;
+}
+
+#if defined(CPU_X86)
+
+/* I and Q of 2 outputs: the first complex sample of p and of p + 4 */
+TARGET_SSE2
+static _inline __m128 pairs_float_sse2(const float *p)
+{
+	return _mm_shuffle_ps(_mm_loadu_ps(p), _mm_loadu_ps(p + 4), _MM_SHUFFLE(1, 0, 1, 0));
+}
+
+TARGET_SSE2
+static void outputs_float_sse2(const decimator_float_stage_t *stage, const float *w, float *out, int count)
+{
+	int j, k;
+	const __m128 center = _mm_set1_ps(stage->center);
+	__m128 acc;
+
+	for (k = 0; k + 2 <= count; k += 2, w += 8)
+	{
+		acc = _mm_mul_ps(center, pairs_float_sse2(w));
+
+		for (j = 0; j < stage->pairs; j++)
+		{
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(stage->taps[j]),
+				_mm_add_ps(pairs_float_sse2(w - 4 * j - 2), pairs_float_sse2(w + 4 * j + 2))));
+		}
+
+		_mm_storeu_ps(out + 2 * k, acc);
+	}
+
+	outputs_float_scalar(stage, w, out + 2 * k, count - k);
+}
+
+/* I and Q of 4 outputs, in the order 0, 2, 1, 3 of 64 bit lanes */
+TARGET_AVX2
+static _inline __m256 pairs_float_avx2(const float *p)
+{
+	return _mm256_shuffle_ps(_mm256_loadu_ps(p), _mm256_loadu_ps(p + 8), _MM_SHUFFLE(1, 0, 1, 0));
+}
+
+TARGET_AVX2
+static void outputs_float_avx2(const decimator_float_stage_t *stage, const float *w, float *out, int count)
+{
+	int j, k;
+	const __m256 center = _mm256_set1_ps(stage->center);
+	__m256 acc;
+
+	for (k = 0; k + 4 <= count; k += 4, w += 16)
+	{
+		acc = _mm256_mul_ps(center, pairs_float_avx2(w));
+
+		for (j = 0; j < stage->pairs; j++)
+		{
+			acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(stage->taps[j]),
+				_mm256_add_ps(pairs_float_avx2(w - 4 * j - 2), pairs_float_avx2(w + 4 * j + 2))));
+		}
+
+		acc = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(acc), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm256_storeu_ps(out + 2 * k, acc);
+	}
+
+	outputs_float_sse2(stage, w, out + 2 * k, count - k);
+}
+
+/* I and Q of 4 outputs, the first complex sample of p, p + 4, p + 8 and p + 12 */
+TARGET_SSE2
+static _inline __m128i pairs_int16_sse2(const int16_t *p)
+{
+	return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(_mm_loadu_si128((const __m128i *) p)),
+		_mm_castsi128_ps(_mm_loadu_si128((const __m128i *) (p + 8))), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+/* madd of interleaved left and right samples gives tap * (left + right) in 32 bits */
+TARGET_SSE2
+static void outputs_int16_sse2(const decimator_int16_stage_t *stage, const int16_t *w, int16_t *out, int count)
+{
+	int j, k;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i center = _mm_set1_epi16((int16_t) stage->center);
+	const __m128i round = _mm_set1_epi32(1 << 14);
+	__m128i c, a, b, tap;
+	__m128i lo, hi;
+
+	for (k = 0; k + 4 <= count; k += 4, w += 16)
+	{
+		c = pairs_int16_sse2(w);
+		lo = _mm_madd_epi16(_mm_unpacklo_epi16(c, zero), center);
+		hi = _mm_madd_epi16(_mm_unpackhi_epi16(c, zero), center);
+
+		for (j = 0; j < stage->pairs; j++)
+		{
+			tap = _mm_set1_epi16(stage->taps[j]);
+			a = pairs_int16_sse2(w - 4 * j - 2);
+			b = pairs_int16_sse2(w + 4 * j + 2);
+			lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), tap));
+			hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), tap));
+		}
+
+		/* round_q15(): the pack saturates */
+		lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 15);
+		hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 15);
+		_mm_storeu_si128((__m128i *) (out + 2 * k), _mm_packs_epi32(lo, hi));
+	}
+
+	outputs_int16_scalar(stage, w, out + 2 * k, count - k);
+}
+
+/* I and Q of 8 outputs, in the order 0, 1, 4, 5, 2, 3, 6, 7 */
+TARGET_AVX2
+static _inline __m256i pairs_int16_avx2(const int16_t *p)
+{
+	return _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *) p)),
+		_mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *) (p + 16))), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+TARGET_AVX2
+static void outputs_int16_avx2(const decimator_int16_stage_t *stage, const int16_t *w, int16_t *out, int count)
+{
+	int j, k;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i center = _mm256_set1_epi16((int16_t) stage->center);
+	const __m256i round = _mm256_set1_epi32(1 << 14);
+	__m256i c, a, b, tap;
+	__m256i lo, hi;
+
+	for (k = 0; k + 8 <= count; k += 8, w += 32)
+	{
+		c = pairs_int16_avx2(w);
+		lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(c, zero), center);
+		hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(c, zero), center);
+
+		for (j = 0; j < stage->pairs; j++)
+		{
+			tap = _mm256_set1_epi16(stage->taps[j]);
+			a = pairs_int16_avx2(w - 4 * j - 2);
+			b = pairs_int16_avx2(w + 4 * j + 2);
+			lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), tap));
+			hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), tap));
+		}
+
+		lo = _mm256_srai_epi32(_mm256_add_epi32(lo, round), 15);
+		hi = _mm256_srai_epi32(_mm256_add_epi32(hi, round), 15);
+
+		/* lo holds outputs 0-3 and hi 4-7, the pack interleaves them by lane */
+		_mm256_storeu_si256((__m256i *) (out + 2 * k),
+			_mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	outputs_int16_sse2(stage, w, out + 2 * k, count - k);
+}
+
+#elif defined(CPU_NEON)
+
+static _inline float32x4_t pairs_float_neon(const float *p)
+{
+	return vcombine_f32(vld1_f32(p), vld1_f32(p + 4));
+}
+
+static void outputs_float_neon(const decimator_float_stage_t *stage, const float *w, float *out, int count)
+{
+	int j, k;
+	float32x4_t acc;
+
+	for (k = 0; k + 2 <= count; k += 2, w += 8)
+	{
+		acc = vmulq_n_f32(pairs_float_neon(w), stage->center);
+
+		for (j = 0; j < stage->pairs; j++)
+		{
+			acc = vaddq_f32(acc, vmulq_n_f32(vaddq_f32(pairs_float_neon(w - 4 * j - 2),
+				pairs_float_neon(w + 4 * j + 2)), stage->taps[j]));
+		}
+
+		vst1q_f32(out + 2 * k, acc);
+	}
+
+	outputs_float_scalar(stage, w, out + 2 * k, count - k);
+}
+
+/* I and Q of 4 outputs: the even 32 bit words from p on */
+static _inline int16x8_t pairs_int16_neon(const int16_t *p)
+{
+	return vreinterpretq_s16_s32(vld2q_s32((const int32_t *) p).val[0]);
+}
+
+static void outputs_int16_neon(const decimator_int16_stage_t *stage, const int16_t *w, int16_t *out, int count)
+{
+	int j, k;
+	int16x8_t c, a, b;
+	int32x4_t lo, hi;
+
+	for (k = 0; k + 4 <= count; k += 4, w += 16)
+	{
+		c = pairs_int16_neon(w);
+		lo = vmull_n_s16(vget_low_s16(c), (int16_t) stage->center);
+		hi = vmull_n_s16(vget_high_s16(c), (int16_t) stage->center);
+
+		for (j = 0; j < stage->pairs; j++)
+		{
+			a = pairs_int16_neon(w - 4 * j - 2);
+			b = pairs_int16_neon(w + 4 * j + 2);
+			lo = vmlal_n_s16(vmlal_n_s16(lo, vget_low_s16(a), stage->taps[j]), vget_low_s16(b), stage->taps[j]);
+			hi = vmlal_n_s16(vmlal_n_s16(hi, vget_high_s16(a), stage->taps[j]), vget_high_s16(b), stage->taps[j]);
+		}
+
+		/* Rounding, saturating narrow: round_q15() */
+		vst1q_s16(out + 2 * k, vcombine_s16(vqrshrn_n_s32(lo, 15), vqrshrn_n_s32(hi, 15)));
+	}
+
+	outputs_int16_scalar(stage, w, out + 2 * k, count - k);
+}
+
+#endif
+
+void decimator_init(uint32_t cpu_features)
+{
+	outputs_float = outputs_float_scalar;
+	outputs_int16 = outputs_int16_scalar;
+
+#if defined(CPU_X86)
+	if (cpu_features & CPU_FEATURE_AVX2)
+	{
+		outputs_float = outputs_float_avx2;
+		outputs_int16 = outputs_int16_avx2;
+	}
+	else if (cpu_features & CPU_FEATURE_SSE2)
+	{
+		outputs_float = outputs_float_sse2;
+		outputs_int16 = outputs_int16_sse2;
+	}
+#elif defined(CPU_NEON)
+	if (cpu_features & CPU_FEATURE_NEON)
+	{
+		outputs_float = outputs_float_neon;
+		outputs_int16 = outputs_int16_neon;
+	}
+#else
+	(void) cpu_features;
+#endif
+}
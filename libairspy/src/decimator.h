@@ -0,0 +1,90 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include <stdint.h>
+
+#define DECIMATOR_MAX_STAGES 8
+
+/* Complex samples a stage copies behind its history at a time */
+#define DECIMATOR_RUN_SIZE 512
+
+/*
+ * Cascade of half-band decimate by 2 stages on interleaved IQ, run in place
+ * after the IQ converter. A half-band kernel of 4n+3 taps has n+1 nonzero
+ * pairs besides its 0.5 center, and only every other output is computed, so
+ * a stage costs n+2 multiplies per complex component of input pair. Each
+ * stage keeps the last len-1 inputs in front of a run of new ones so the
+ * taps behind every output are contiguous, and a phase so that any split of
+ * the input gives the same output as one call.
+ */
+typedef struct {
+	int len;
+	int pairs;
+	int phase;
+	float center;
+	float *taps;
+	float *window;
+} decimator_float_stage_t;
+
+typedef struct {
+	int stage_count;
+	decimator_float_stage_t stages[DECIMATOR_MAX_STAGES];
+} decimator_float_t;
+
+typedef struct {
+	int len;
+	int pairs;
+	int phase;
+	int32_t center;
+	int16_t *taps;
+	int16_t *window;
+} decimator_int16_stage_t;
+
+typedef struct {
+	int stage_count;
+	decimator_int16_stage_t stages[DECIMATOR_MAX_STAGES];
+} decimator_int16_t;
+
+/*
+ * Decimation by 2^stage_count. Every stage but the last uses kernel, the
+ * last one, which sets the final passband, uses last_kernel. Kernels are
+ * half-bands of 4n+3 taps, int16 ones scaled by 32768. NULL when out of
+ * memory or a kernel is not a half-band length.
+ */
+void decimator_init(uint32_t cpu_features);
+
+decimator_float_t *decimator_float_create(int stage_count, const float *kernel, int len, const float *last_kernel, int last_len);
+void decimator_float_free(decimator_float_t *dec);
+void decimator_float_reset(decimator_float_t *dec);
+
+/* Decimates len complex samples in place and returns how many are left */
+int decimator_float_process(decimator_float_t *dec, float *samples, int len);
+
+decimator_int16_t *decimator_int16_create(int stage_count, const int16_t *kernel, int len, const int16_t *last_kernel, int last_len);
+void decimator_int16_free(decimator_int16_t *dec);
+void decimator_int16_reset(decimator_int16_t *dec);
+int decimator_int16_process(decimator_int16_t *dec, int16_t *samples, int len);
+
+#endif // DECIMATOR_H
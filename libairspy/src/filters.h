@@ -131,4 +131,51 @@ const int16_t HB_KERNEL_INT16[HB_KERNEL_INT16_LEN] =
 	-33
 };
 
+/*
+ * Half-band for the early decimation stages, Kaiser windowed (beta 6). They
+ * only have to protect the band left after the last stage, which uses the
+ * kernels above.
+ */
+#define HB_DECIMATION_KERNEL_FLOAT_LEN 15
+
+const float HB_DECIMATION_KERNEL_FLOAT[HB_DECIMATION_KERNEL_FLOAT_LEN] =
+{
+	-0.000675680872433543,
+	 0.000000000000000000,
+	 0.012706252745175893,
+	 0.000000000000000000,
+	-0.062679686453826766,
+	 0.000000000000000000,
+	 0.300649114581084453,
+	 0.500000000000000000,
+	 0.300649114581084453,
+	 0.000000000000000000,
+	-0.062679686453826766,
+	 0.000000000000000000,
+	 0.012706252745175893,
+	 0.000000000000000000,
+	-0.000675680872433543
+};
+
+#define HB_DECIMATION_KERNEL_INT16_LEN 15
+
+const int16_t HB_DECIMATION_KERNEL_INT16[HB_DECIMATION_KERNEL_INT16_LEN] =
+{
+	-22,
+	 0,
+	 416,
+	 0,
+	-2054,
+	 0,
+	 9852,
+	 16384,
+	 9852,
+	 0,
+	-2054,
+	 0,
+	 416,
+	 0,
+	-22
+};
+
 #endif // FILTERS_H
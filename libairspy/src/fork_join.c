@@ -0,0 +1,142 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+
+#include "fork_join.h"
+
+static void* helper_threadproc(void *arg)
+{
+	fork_join_helper_t *helper = (fork_join_helper_t *) arg;
+	fork_join_t *fork_join = helper->fork_join;
+	uint32_t generation = 0;
+	fork_join_fn job;
+	void *job_arg;
+
+	for (;;)
+	{
+		pthread_mutex_lock(&fork_join->mutex);
+		while (!fork_join->stopping && fork_join->generation == generation)
+		{
+			pthread_cond_wait(&fork_join->start_cond, &fork_join->mutex);
+		}
+		if (fork_join->stopping)
+		{
+			pthread_mutex_unlock(&fork_join->mutex);
+			break;
+		}
+		generation = fork_join->generation;
+		job = fork_join->job;
+		job_arg = fork_join->arg;
+		pthread_mutex_unlock(&fork_join->mutex);
+
+		job(job_arg, helper->part);
+
+		pthread_mutex_lock(&fork_join->mutex);
+		if (--fork_join->remaining == 0)
+		{
+			pthread_cond_signal(&fork_join->done_cond);
+		}
+		pthread_mutex_unlock(&fork_join->mutex);
+	}
+
+	return NULL;
+}
+
+int fork_join_init(fork_join_t *fork_join, uint32_t helper_count)
+{
+	uint32_t i;
+
+	fork_join->helpers = (fork_join_helper_t *) calloc(helper_count ? helper_count : 1, sizeof(fork_join_helper_t));
+	if (fork_join->helpers == NULL)
+	{
+		return -1;
+	}
+
+	fork_join->helper_count = 0;
+	fork_join->generation = 0;
+	fork_join->remaining = 0;
+	fork_join->stopping = 0;
+
+	if (pthread_mutex_init(&fork_join->mutex, NULL) != 0)
+	{
+		free(fork_join->helpers);
+		return -1;
+	}
+	pthread_cond_init(&fork_join->start_cond, NULL);
+	pthread_cond_init(&fork_join->done_cond, NULL);
+
+	for (i = 0; i < helper_count; i++)
+	{
+		fork_join->helpers[i].fork_join = fork_join;
+		fork_join->helpers[i].part = i + 1;
+		if (pthread_create(&fork_join->helpers[i].thread, NULL, helper_threadproc, &fork_join->helpers[i]) != 0)
+		{
+			fork_join_destroy(fork_join);
+			return -1;
+		}
+		fork_join->helper_count++;
+	}
+
+	return 0;
+}
+
+void fork_join_destroy(fork_join_t *fork_join)
+{
+	uint32_t i;
+
+	pthread_mutex_lock(&fork_join->mutex);
+	fork_join->stopping = 1;
+	pthread_cond_broadcast(&fork_join->start_cond);
+	pthread_mutex_unlock(&fork_join->mutex);
+
+	for (i = 0; i < fork_join->helper_count; i++)
+	{
+		pthread_join(fork_join->helpers[i].thread, NULL);
+	}
+
+	pthread_cond_destroy(&fork_join->done_cond);
+	pthread_cond_destroy(&fork_join->start_cond);
+	pthread_mutex_destroy(&fork_join->mutex);
+	free(fork_join->helpers);
+	fork_join->helpers = NULL;
+	fork_join->helper_count = 0;
+}
+
+void fork_join_run(fork_join_t *fork_join, fork_join_fn job, void *arg)
+{
+	pthread_mutex_lock(&fork_join->mutex);
+	fork_join->job = job;
+	fork_join->arg = arg;
+	fork_join->remaining = fork_join->helper_count;
+	fork_join->generation++;
+	pthread_cond_broadcast(&fork_join->start_cond);
+	pthread_mutex_unlock(&fork_join->mutex);
+
+	job(arg, 0);
+
+	pthread_mutex_lock(&fork_join->mutex);
+	while (fork_join->remaining != 0)
+	{
+		pthread_cond_wait(&fork_join->done_cond, &fork_join->mutex);
+	}
+	pthread_mutex_unlock(&fork_join->mutex);
+}
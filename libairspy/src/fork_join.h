@@ -0,0 +1,68 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef FORK_JOIN_H
+#define FORK_JOIN_H
+
+#include <stdint.h>
+
+#if _MSC_VER > 1700
+#define HAVE_STRUCT_TIMESPEC
+#endif
+
+#include <pthread.h>
+
+typedef void (*fork_join_fn)(void *arg, uint32_t part);
+
+typedef struct fork_join_helper
+{
+	struct fork_join *fork_join;
+	uint32_t part;
+	pthread_t thread;
+} fork_join_helper_t;
+
+/*
+ * Fixed team of helper threads that run one job split in parts: the calling
+ * thread takes part 0, helper i part i + 1, and fork_join_run() returns once
+ * every part is done. Everything written before the run is visible to the
+ * parts, and everything the parts wrote is visible after it.
+ */
+typedef struct fork_join
+{
+	fork_join_helper_t *helpers;
+	uint32_t helper_count;
+	fork_join_fn job;
+	void *arg;
+	uint32_t generation;
+	uint32_t remaining;
+	uint32_t stopping;
+	pthread_mutex_t mutex;
+	pthread_cond_t start_cond;
+	pthread_cond_t done_cond;
+} fork_join_t;
+
+int fork_join_init(fork_join_t *fork_join, uint32_t helper_count);
+void fork_join_destroy(fork_join_t *fork_join);
+
+/* Runs job(arg, part) for part = 0 .. helper_count */
+void fork_join_run(fork_join_t *fork_join, fork_join_fn job, void *arg);
+
+#endif // FORK_JOIN_H
@@ -24,6 +24,7 @@ THE SOFTWARE, PROVIDED SUCH USE REMAINS WITHIN THE AIRSPY ECOSYSTEM.
 */
 
 #include "iqconverter_float.h"
+#include "cpu_features.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -42,10 +43,6 @@ THE SOFTWARE, PROVIDED SUCH USE REMAINS WITHIN THE AIRSPY ECOSYSTEM.
   #define _inline inline
   #define FIR_STANDARD
 #elif defined(__FreeBSD__)
-  #if defined(__x86_64__) || defined(__i386__)
-    #define USE_SSE2
-    #include <immintrin.h>
-  #endif
   #define _inline inline
   #define _aligned_free(mem) free(mem)
 void *_aligned_malloc(size_t size, size_t alignment)
@@ -60,14 +57,21 @@ void *_aligned_malloc(size_t size, size_t alignment)
   #define _aligned_malloc(size, alignment) memalign(alignment, size)
   #define _aligned_free(mem) free(mem)
   #define _inline inline
-#else
-	#if (_MSC_VER >= 1800)
-		//#define USE_SSE2
-		//#include <immintrin.h>
-	#endif
 #endif
 
-#define SIZE_FACTOR 32
+#if defined(CPU_X86)
+  #include <immintrin.h>
+#elif defined(CPU_NEON)
+  #include <arm_neon.h>
+#endif
+
+/*
+ * The FIR history is a mirrored ring of fir_size = len - 1 + FIR_RUN_SIZE
+ * entries, each sample being written at fir_index and fir_index + fir_size.
+ * The len taps behind any position are then contiguous and the ring never
+ * has to be copied back when fir_index wraps.
+ */
+#define FIR_RUN_SIZE 256
 #define DEFAULT_ALIGNMENT 16
 #define HPF_COEFF 0.01f
 
@@ -89,7 +93,8 @@ iqconverter_float_t *iqconverter_float_create(const float *hb_kernel, int len)
 	buffer_size = cnv->len * sizeof(float);
 
 	cnv->fir_kernel = (float *) _aligned_malloc(buffer_size, DEFAULT_ALIGNMENT);
-	cnv->fir_queue = (float *) _aligned_malloc(buffer_size * SIZE_FACTOR, DEFAULT_ALIGNMENT);
+	cnv->fir_size = cnv->len - 1 + FIR_RUN_SIZE;
+	cnv->fir_queue = (float *) _aligned_malloc(cnv->fir_size * 2 * sizeof(float), DEFAULT_ALIGNMENT);
 	cnv->delay_line = (float *) _aligned_malloc(buffer_size / 2, DEFAULT_ALIGNMENT);
 
 	iqconverter_float_reset(cnv);
@@ -99,9 +104,33 @@ iqconverter_float_t *iqconverter_float_create(const float *hb_kernel, int len)
 		cnv->fir_kernel[i] = hb_kernel[j];
 	} 
 
+	cnv->fir_symmetric = 1;
+	for (i = 0; i < cnv->len / 2; i++)
+	{
+		if (cnv->fir_kernel[i] != cnv->fir_kernel[cnv->len - 1 - i])
+		{
+			cnv->fir_symmetric = 0;
+		}
+	}
+
 	return cnv;
 }
 
+iqconverter_float_t *iqconverter_float_clone(const iqconverter_float_t *cnv)
+{
+	iqconverter_float_t *part = (iqconverter_float_t *) _aligned_malloc(sizeof(iqconverter_float_t), DEFAULT_ALIGNMENT);
+
+	*part = *cnv;
+	part->fir_kernel = (float *) _aligned_malloc(cnv->len * sizeof(float), DEFAULT_ALIGNMENT);
+	part->fir_queue = (float *) _aligned_malloc(cnv->fir_size * 2 * sizeof(float), DEFAULT_ALIGNMENT);
+	part->delay_line = (float *) _aligned_malloc(cnv->len * sizeof(float) / 2, DEFAULT_ALIGNMENT);
+
+	memcpy(part->fir_kernel, cnv->fir_kernel, cnv->len * sizeof(float));
+	iqconverter_float_reset(part);
+
+	return part;
+}
+
 void iqconverter_float_free(iqconverter_float_t *cnv)
 {
 	_aligned_free(cnv->fir_kernel);
@@ -116,49 +145,32 @@ void iqconverter_float_reset(iqconverter_float_t *cnv)
 	cnv->fir_index = 0;
 	cnv->delay_index = 0;
 	memset(cnv->delay_line, 0, cnv->len * sizeof(float) / 2);
-	memset(cnv->fir_queue, 0, cnv->len * sizeof(float) * SIZE_FACTOR);
+	memset(cnv->fir_queue, 0, cnv->fir_size * 2 * sizeof(float));
 }
 
-static _inline float process_fir_taps(const float *kernel, const float *queue, int len)
-{
-	int i;
+typedef float (*fir_taps_fn)(const float *kernel, const float *queue, int len);
+typedef void (*fir_block_fn)(iqconverter_float_t *cnv, float *samples, int len);
+typedef void (*rotate_fs_4_fn)(float *samples, int len, float hbc);
+typedef float (*remove_dc_fn)(float *samples, int len, float avg);
 
-#ifdef USE_SSE2
+static float fir_taps_scalar(const float *kernel, const float *queue, int len);
+static void rotate_fs_4_scalar(float *samples, int len, float hbc);
+static float remove_dc_scalar(float *samples, int len, float avg);
 
-	__m128 acc = _mm_set_ps(0, 0, 0, 0);
-
-#else
+static fir_taps_fn fir_taps = fir_taps_scalar;
+static fir_block_fn fir_block = NULL;
+static rotate_fs_4_fn rotate_fs_4 = rotate_fs_4_scalar;
+static remove_dc_fn remove_dc_block = remove_dc_scalar;
 
+static float fir_taps_scalar(const float *kernel, const float *queue, int len)
+{
+	int i;
 	float sum = 0.0f;
 
-#endif
-
 	if (len >= 8)
 	{
 		int it = len >> 3;
 
-#ifdef USE_SSE2
-
-		for (i = 0; i < it; i++)
-		{
-			__m128 head1 = _mm_loadu_ps(queue);
-			__m128 kern1 = _mm_load_ps(kernel);
-			__m128 head2 = _mm_loadu_ps(queue + 4);
-			__m128 kern2 = _mm_load_ps(kernel + 4);
-
-			__m128 mul1 = _mm_mul_ps(kern1, head1);
-			__m128 mul2 = _mm_mul_ps(kern2, head2);
-
-			mul1 = _mm_add_ps(mul1, mul2);
-
-			acc = _mm_add_ps(acc, mul1);
-
-			queue += 8;
-			kernel += 8;
-		}
-
-#else
-
 		for (i = 0; i < it; i++)
 		{
 			sum += kernel[0] * queue[0]
@@ -174,47 +186,21 @@ static _inline float process_fir_taps(const float *kernel, const float *queue, i
 			kernel += 8;
 		}
 
-#endif
 		len &= 7;
 	}
 
 	if (len >= 4)
 	{
-
-#ifdef USE_SSE2
-
-		__m128 head = _mm_loadu_ps(queue);
-		__m128 kern = _mm_load_ps(kernel);
-		__m128 mul = _mm_mul_ps(kern, head);
-		acc = _mm_add_ps(acc, mul);
-
-#else
-
 		sum += kernel[0] * queue[0]
 			+ kernel[1] * queue[1]
 			+ kernel[2] * queue[2]
 			+ kernel[3] * queue[3];
 
-#endif
-
 		kernel += 4;
 		queue += 4;
 		len &= 3;
 	}
 
-#ifdef USE_SSE2
-
-	__m128 t = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
-	acc = _mm_add_ss(t, _mm_shuffle_ps(t, t, 1));
-
-#ifdef __FreeBSD__
-	float sum = acc[0];
-#else
-	float sum = acc.m128_f32[0];
-#endif
-
-#endif
-
 	if (len >= 2)
 	{
 		sum += kernel[0] * queue[0]
@@ -233,11 +219,519 @@ static _inline float process_fir_taps(const float *kernel, const float *queue, i
 	return sum;
 }
 
-static void fir_interleaved_4(iqconverter_float_t *cnv, float *samples, int len)
+static void rotate_fs_4_scalar(float *samples, int len, float hbc)
+{
+	int i;
+
+	for (i = 0; i + 4 <= len; i += 4)
+	{
+		samples[i + 0] = -samples[i + 0];
+		samples[i + 1] = -samples[i + 1] * hbc;
+		//samples[i + 2] = samples[i + 2];
+		samples[i + 3] = samples[i + 3] * hbc;
+	}
+}
+
+/*
+ * One-pole DC blocker: y[n] = x[n] - avg[n-1] with
+ * avg[n] = b * avg[n-1] + a * x[n], a = HPF_COEFF and b = 1 - a.
+ *
+ * The vector kernels unroll this over a block of lanes: a prefix scan of
+ * a * x gives p[j] = sum(b^(j-k) * a * x[k]), the incoming average adds
+ * b^(j+1) * avg, and only the last lane is carried to the next block.
+ */
+static float remove_dc_scalar(float *samples, int len, float avg)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+	{
+		samples[i] -= avg;
+		avg += HPF_COEFF * samples[i];
+	}
+
+	return avg;
+}
+
+#if defined(CPU_X86)
+
+TARGET_SSE2
+static float fir_taps_sse2(const float *kernel, const float *queue, int len)
+{
+	int i;
+	float sum;
+	__m128 acc0 = _mm_setzero_ps();
+	__m128 acc1 = _mm_setzero_ps();
+
+	for (i = 0; i + 8 <= len; i += 8)
+	{
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(kernel + i), _mm_loadu_ps(queue + i)));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(kernel + i + 4), _mm_loadu_ps(queue + i + 4)));
+	}
+
+	if (i + 4 <= len)
+	{
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(kernel + i), _mm_loadu_ps(queue + i)));
+		i += 4;
+	}
+
+	acc0 = _mm_add_ps(acc0, acc1);
+	acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+	acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+	sum = _mm_cvtss_f32(acc0);
+
+	for (; i < len; i++)
+	{
+		sum += kernel[i] * queue[i];
+	}
+
+	return sum;
+}
+
+TARGET_AVX
+static float fir_taps_avx(const float *kernel, const float *queue, int len)
+{
+	int i;
+	float sum;
+	__m256 acc0 = _mm256_setzero_ps();
+	__m256 acc1 = _mm256_setzero_ps();
+	__m128 acc;
+
+	for (i = 0; i + 16 <= len; i += 16)
+	{
+		acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(kernel + i), _mm256_loadu_ps(queue + i)));
+		acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(kernel + i + 8), _mm256_loadu_ps(queue + i + 8)));
+	}
+
+	if (i + 8 <= len)
+	{
+		acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(kernel + i), _mm256_loadu_ps(queue + i)));
+		i += 8;
+	}
+
+	acc0 = _mm256_add_ps(acc0, acc1);
+	acc = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+
+	if (i + 4 <= len)
+	{
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(kernel + i), _mm_loadu_ps(queue + i)));
+		i += 4;
+	}
+
+	acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+	acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+	sum = _mm_cvtss_f32(acc);
+
+	for (; i < len; i++)
+	{
+		sum += kernel[i] * queue[i];
+	}
+
+	return sum;
+}
+
+TARGET_AVX512F
+static float fir_taps_avx512(const float *kernel, const float *queue, int len)
 {
 	int i;
+	__mmask16 tail;
+	__m512 acc = _mm512_setzero_ps();
+
+	for (i = 0; i + 16 <= len; i += 16)
+	{
+		acc = _mm512_add_ps(acc, _mm512_mul_ps(_mm512_loadu_ps(kernel + i), _mm512_loadu_ps(queue + i)));
+	}
+
+	if (i < len)
+	{
+		tail = (__mmask16) ((1u << (len - i)) - 1);
+		acc = _mm512_add_ps(acc, _mm512_mul_ps(_mm512_maskz_loadu_ps(tail, kernel + i), _mm512_maskz_loadu_ps(tail, queue + i)));
+	}
+
+	return _mm512_reduce_add_ps(acc);
+}
+
+/*
+ * The queue is written backwards, so the histories of 8 consecutive outputs
+ * start at 8 consecutive addresses and every tap is one unaligned load per
+ * output vector. The half-band symmetry folds the mirrored taps before the
+ * multiply. Each output is accumulated in tap order with one FMA per folded
+ * tap, in the vector and single-sample paths alike, so the result does not
+ * depend on where a buffer starts relative to the queue wrap.
+ */
+TARGET_AVX2_FMA
+static _inline __m256 fir_taps_x8_avx2(const float *kernel, const float *queue, int len)
+{
+	int k;
+	int half_len = len / 2;
+	__m256 acc = _mm256_setzero_ps();
+
+	for (k = 0; k < half_len; k++)
+	{
+		acc = _mm256_fmadd_ps(_mm256_broadcast_ss(kernel + k),
+			_mm256_add_ps(_mm256_loadu_ps(queue + k), _mm256_loadu_ps(queue + len - 1 - k)),
+			acc);
+	}
+	if (len & 1)
+	{
+		acc = _mm256_fmadd_ps(_mm256_broadcast_ss(kernel + half_len), _mm256_loadu_ps(queue + half_len), acc);
+	}
+
+	return acc;
+}
+
+TARGET_AVX2_FMA
+static _inline float fir_taps_x1_avx2(const float *kernel, const float *queue, int len)
+{
+	int k;
+	int half_len = len / 2;
+	__m128 acc = _mm_setzero_ps();
+
+	for (k = 0; k < half_len; k++)
+	{
+		acc = _mm_fmadd_ss(_mm_load_ss(kernel + k),
+			_mm_add_ss(_mm_load_ss(queue + k), _mm_load_ss(queue + len - 1 - k)),
+			acc);
+	}
+	if (len & 1)
+	{
+		acc = _mm_fmadd_ss(_mm_load_ss(kernel + half_len), _mm_load_ss(queue + half_len), acc);
+	}
+
+	return _mm_cvtss_f32(acc);
+}
+
+TARGET_AVX2
+static _inline void store_even_avx2(float *samples, __m256 acc)
+{
+	const __m256i spread_lo = _mm256_setr_epi32(7, 7, 6, 6, 5, 5, 4, 4);
+	const __m256i spread_hi = _mm256_setr_epi32(3, 3, 2, 2, 1, 1, 0, 0);
+
+	/* Lane 7 holds the oldest output, put the outputs back on the even slots */
+	_mm256_storeu_ps(samples, _mm256_blend_ps(_mm256_permutevar8x32_ps(acc, spread_lo), _mm256_loadu_ps(samples), 0xaa));
+	_mm256_storeu_ps(samples + 8, _mm256_blend_ps(_mm256_permutevar8x32_ps(acc, spread_hi), _mm256_loadu_ps(samples + 8), 0xaa));
+}
+
+TARGET_AVX2_FMA
+static void fir_interleaved_avx2(iqconverter_float_t *cnv, float *samples, int len)
+{
+	int i, j;
+	int count;
 	int fir_index = cnv->fir_index;
 	int fir_len = cnv->len;
+	int fir_size = cnv->fir_size;
+	float *fir_kernel = cnv->fir_kernel;
+	float *fir_queue = cnv->fir_queue;
+	float *queue;
+	const __m256i reverse = _mm256_setr_epi32(7, 6, 3, 2, 5, 4, 1, 0);
+	__m256 even;
+
+	for (i = 0; i < len; i += count * 2)
+	{
+		/*
+		 * Outputs left before the queue wraps. Longer runs would overwrite
+		 * the mirrored history their first outputs still need.
+		 */
+		count = (len - i + 1) / 2;
+		if (count > fir_index + 1)
+		{
+			count = fir_index + 1;
+		}
+		if (count > FIR_RUN_SIZE)
+		{
+			count = FIR_RUN_SIZE;
+		}
+
+		/*
+		 * Queue the whole run first, reading the history right behind the
+		 * stores would stall on store forwarding.
+		 */
+		for (j = 0; j + 8 <= count; j += 8)
+		{
+			even = _mm256_shuffle_ps(_mm256_loadu_ps(samples + i + j * 2), _mm256_loadu_ps(samples + i + j * 2 + 8), _MM_SHUFFLE(2, 0, 2, 0));
+			even = _mm256_permutevar8x32_ps(even, reverse);
+			_mm256_storeu_ps(fir_queue + fir_index - j - 7, even);
+			_mm256_storeu_ps(fir_queue + fir_index - j - 7 + fir_size, even);
+		}
+		for (; j < count; j++)
+		{
+			fir_queue[fir_index - j] = samples[i + j * 2];
+			fir_queue[fir_index - j + fir_size] = samples[i + j * 2];
+		}
+
+		for (j = 0; j + 16 <= count; j += 16)
+		{
+			queue = fir_queue + fir_index - j - 15;
+			store_even_avx2(samples + i + j * 2, fir_taps_x8_avx2(fir_kernel, queue + 8, fir_len));
+			store_even_avx2(samples + i + j * 2 + 16, fir_taps_x8_avx2(fir_kernel, queue, fir_len));
+		}
+		for (; j < count; j++)
+		{
+			samples[i + j * 2] = fir_taps_x1_avx2(fir_kernel, fir_queue + fir_index - j, fir_len);
+		}
+
+		fir_index -= count;
+		if (fir_index < 0)
+		{
+			fir_index = fir_size - 1;
+		}
+	}
+
+	cnv->fir_index = fir_index;
+}
+
+TARGET_SSE2
+static void rotate_fs_4_sse2(float *samples, int len, float hbc)
+{
+	int i;
+	const __m128 rot = _mm_setr_ps(-1.0f, -hbc, 1.0f, hbc);
+
+	for (i = 0; i + 4 <= len; i += 4)
+	{
+		_mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), rot));
+	}
+}
+
+TARGET_SSE2
+static _inline __m128 shift_lanes_sse2(__m128 x, int lanes)
+{
+	return _mm_castsi128_ps(lanes == 1 ?
+		_mm_slli_si128(_mm_castps_si128(x), 4) :
+		_mm_slli_si128(_mm_castps_si128(x), 8));
+}
+
+TARGET_SSE2
+static float remove_dc_sse2(float *samples, int len, float avg)
+{
+	int i;
+	const float b = 1.0f - HPF_COEFF;
+	const __m128 a1 = _mm_set1_ps(HPF_COEFF);
+	const __m128 b1 = _mm_set1_ps(b);
+	const __m128 b2 = _mm_set1_ps(b * b);
+	const __m128 bn = _mm_setr_ps(b, b * b, b * b * b, b * b * b * b);
+	__m128 x, p, acc, carry;
+
+	carry = _mm_set1_ps(avg);
+
+	for (i = 0; i + 4 <= len; i += 4)
+	{
+		x = _mm_loadu_ps(samples + i);
+		p = _mm_mul_ps(x, a1);
+		p = _mm_add_ps(p, _mm_mul_ps(shift_lanes_sse2(p, 1), b1));
+		p = _mm_add_ps(p, _mm_mul_ps(shift_lanes_sse2(p, 2), b2));
+		acc = _mm_add_ps(p, _mm_mul_ps(carry, bn));
+
+		/* Each lane subtracts the average left by the previous one */
+		_mm_storeu_ps(samples + i, _mm_sub_ps(x, _mm_move_ss(shift_lanes_sse2(acc, 1), carry)));
+		carry = _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+
+	return remove_dc_scalar(samples + i, len - i, _mm_cvtss_f32(carry));
+}
+
+TARGET_AVX2_FMA
+static float remove_dc_avx2(float *samples, int len, float avg)
+{
+	int i;
+	const float b = 1.0f - HPF_COEFF;
+	const float b2 = b * b;
+	const float b4 = b2 * b2;
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 a1 = _mm256_set1_ps(HPF_COEFF);
+	const __m256 bv1 = _mm256_set1_ps(b);
+	const __m256 bv2 = _mm256_set1_ps(b2);
+	const __m256 bv4 = _mm256_set1_ps(b4);
+	const __m256 bn = _mm256_setr_ps(b, b2, b2 * b, b4, b4 * b, b4 * b2, b4 * b2 * b, b4 * b4);
+	const __m256i up1 = _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6);
+	const __m256i up2 = _mm256_setr_epi32(0, 0, 0, 1, 2, 3, 4, 5);
+	const __m256i last = _mm256_set1_epi32(7);
+	__m256 x, p, acc, carry;
+
+	carry = _mm256_set1_ps(avg);
+
+	for (i = 0; i + 8 <= len; i += 8)
+	{
+		x = _mm256_loadu_ps(samples + i);
+		p = _mm256_mul_ps(x, a1);
+		p = _mm256_fmadd_ps(_mm256_blend_ps(_mm256_permutevar8x32_ps(p, up1), zero, 0x01), bv1, p);
+		p = _mm256_fmadd_ps(_mm256_blend_ps(_mm256_permutevar8x32_ps(p, up2), zero, 0x03), bv2, p);
+		p = _mm256_fmadd_ps(_mm256_permute2f128_ps(p, p, 0x08), bv4, p);
+		acc = _mm256_fmadd_ps(carry, bn, p);
+
+		_mm256_storeu_ps(samples + i, _mm256_sub_ps(x, _mm256_blend_ps(_mm256_permutevar8x32_ps(acc, up1), carry, 0x01)));
+		carry = _mm256_permutevar8x32_ps(acc, last);
+	}
+
+	return remove_dc_scalar(samples + i, len - i, _mm256_cvtss_f32(carry));
+}
+
+TARGET_AVX
+static void rotate_fs_4_avx(float *samples, int len, float hbc)
+{
+	int i;
+	const __m256 rot = _mm256_setr_ps(-1.0f, -hbc, 1.0f, hbc, -1.0f, -hbc, 1.0f, hbc);
+
+	for (i = 0; i + 8 <= len; i += 8)
+	{
+		_mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), rot));
+	}
+
+	rotate_fs_4_scalar(samples + i, len - i, hbc);
+}
+
+TARGET_AVX512F
+static void rotate_fs_4_avx512(float *samples, int len, float hbc)
+{
+	int i;
+	const __m512 rot = _mm512_setr_ps(
+		-1.0f, -hbc, 1.0f, hbc, -1.0f, -hbc, 1.0f, hbc,
+		-1.0f, -hbc, 1.0f, hbc, -1.0f, -hbc, 1.0f, hbc);
+
+	for (i = 0; i + 16 <= len; i += 16)
+	{
+		_mm512_storeu_ps(samples + i, _mm512_mul_ps(_mm512_loadu_ps(samples + i), rot));
+	}
+
+	rotate_fs_4_scalar(samples + i, len - i, hbc);
+}
+
+#elif defined(CPU_NEON)
+
+static float fir_taps_neon(const float *kernel, const float *queue, int len)
+{
+	int i;
+	float sum;
+	float32x4_t acc0 = vdupq_n_f32(0.0f);
+	float32x4_t acc1 = vdupq_n_f32(0.0f);
+#if !defined(__aarch64__) && !defined(_M_ARM64)
+	float32x2_t pair;
+#endif
+
+	for (i = 0; i + 8 <= len; i += 8)
+	{
+		acc0 = vmlaq_f32(acc0, vld1q_f32(kernel + i), vld1q_f32(queue + i));
+		acc1 = vmlaq_f32(acc1, vld1q_f32(kernel + i + 4), vld1q_f32(queue + i + 4));
+	}
+
+	if (i + 4 <= len)
+	{
+		acc0 = vmlaq_f32(acc0, vld1q_f32(kernel + i), vld1q_f32(queue + i));
+		i += 4;
+	}
+
+	acc0 = vaddq_f32(acc0, acc1);
+#if defined(__aarch64__) || defined(_M_ARM64)
+	sum = vaddvq_f32(acc0);
+#else
+	pair = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+	sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+
+	for (; i < len; i++)
+	{
+		sum += kernel[i] * queue[i];
+	}
+
+	return sum;
+}
+
+static float remove_dc_neon(float *samples, int len, float avg)
+{
+	int i;
+	const float b = 1.0f - HPF_COEFF;
+	const float32x4_t zero = vdupq_n_f32(0.0f);
+	float32x4_t bn, x, p, acc, carry;
+
+	bn = vsetq_lane_f32(b, zero, 0);
+	bn = vsetq_lane_f32(b * b, bn, 1);
+	bn = vsetq_lane_f32(b * b * b, bn, 2);
+	bn = vsetq_lane_f32(b * b * b * b, bn, 3);
+	carry = vdupq_n_f32(avg);
+
+	for (i = 0; i + 4 <= len; i += 4)
+	{
+		x = vld1q_f32(samples + i);
+		p = vmulq_n_f32(x, HPF_COEFF);
+		p = vmlaq_n_f32(p, vextq_f32(zero, p, 3), b);
+		p = vmlaq_n_f32(p, vextq_f32(zero, p, 2), b * b);
+		acc = vmlaq_f32(p, carry, bn);
+
+		vst1q_f32(samples + i, vsubq_f32(x, vextq_f32(carry, acc, 3)));
+		carry = vdupq_n_f32(vgetq_lane_f32(acc, 3));
+	}
+
+	return remove_dc_scalar(samples + i, len - i, vgetq_lane_f32(carry, 0));
+}
+
+static void rotate_fs_4_neon(float *samples, int len, float hbc)
+{
+	int i;
+	float32x4_t rot;
+
+	rot = vsetq_lane_f32(-1.0f, vdupq_n_f32(0.0f), 0);
+	rot = vsetq_lane_f32(-hbc, rot, 1);
+	rot = vsetq_lane_f32(1.0f, rot, 2);
+	rot = vsetq_lane_f32(hbc, rot, 3);
+
+	for (i = 0; i + 4 <= len; i += 4)
+	{
+		vst1q_f32(samples + i, vmulq_f32(vld1q_f32(samples + i), rot));
+	}
+}
+
+#endif
+
+void iqconverter_float_init(uint32_t cpu_features)
+{
+	fir_taps = fir_taps_scalar;
+	fir_block = NULL;
+	rotate_fs_4 = rotate_fs_4_scalar;
+	remove_dc_block = remove_dc_scalar;
+
+#if defined(CPU_X86)
+	if (cpu_features & CPU_FEATURE_AVX512F)
+	{
+		fir_taps = fir_taps_avx512;
+		rotate_fs_4 = rotate_fs_4_avx512;
+	}
+	else if (cpu_features & CPU_FEATURE_AVX)
+	{
+		fir_taps = fir_taps_avx;
+		rotate_fs_4 = rotate_fs_4_avx;
+	}
+	else if (cpu_features & CPU_FEATURE_SSE2)
+	{
+		fir_taps = fir_taps_sse2;
+		rotate_fs_4 = rotate_fs_4_sse2;
+	}
+
+	if (cpu_features & CPU_FEATURE_SSE2)
+	{
+		remove_dc_block = remove_dc_sse2;
+	}
+
+	if ((cpu_features & CPU_FEATURE_AVX2) && (cpu_features & CPU_FEATURE_FMA))
+	{
+		fir_block = fir_interleaved_avx2;
+		remove_dc_block = remove_dc_avx2;
+	}
+#elif defined(CPU_NEON)
+	if (cpu_features & CPU_FEATURE_NEON)
+	{
+		fir_taps = fir_taps_neon;
+		rotate_fs_4 = rotate_fs_4_neon;
+		remove_dc_block = remove_dc_neon;
+	}
+#else
+	(void) cpu_features;
+#endif
+}
+
+static void fir_interleaved_4(iqconverter_float_t *cnv, float *samples, int len)
+{
+	int i;
+	int fir_index = cnv->fir_index;
+	int fir_size = cnv->fir_size;
 	float *fir_kernel = cnv->fir_kernel;
 	float *fir_queue = cnv->fir_queue;
 	float *queue;
@@ -248,6 +742,7 @@ static void fir_interleaved_4(iqconverter_float_t *cnv, float *samples, int len)
 		queue = fir_queue + fir_index;
 
 		queue[0] = samples[i];
+		queue[fir_size] = samples[i];
 
 		acc = fir_kernel[0] * (queue[0] + queue[4 - 1])
 			+ fir_kernel[1] * (queue[1] + queue[4 - 2]);
@@ -256,8 +751,7 @@ static void fir_interleaved_4(iqconverter_float_t *cnv, float *samples, int len)
 
 		if (--fir_index < 0)
 		{
-			fir_index = fir_len * (SIZE_FACTOR - 1);
-			memcpy(fir_queue + fir_index + 1, fir_queue, (fir_len - 1) * sizeof(float));
+			fir_index = fir_size - 1;
 		}
 	}
 
@@ -268,7 +762,7 @@ static void fir_interleaved_8(iqconverter_float_t *cnv, float *samples, int len)
 {
 	int i;
 	int fir_index = cnv->fir_index;
-	int fir_len = cnv->len;
+	int fir_size = cnv->fir_size;
 	float *fir_kernel = cnv->fir_kernel;
 	float *fir_queue = cnv->fir_queue;
 	float *queue;
@@ -279,6 +773,7 @@ static void fir_interleaved_8(iqconverter_float_t *cnv, float *samples, int len)
 		queue = fir_queue + fir_index;
 
 		queue[0] = samples[i];
+		queue[fir_size] = samples[i];
 
 		acc = fir_kernel[0] * (queue[0] + queue[8 - 1])
 			+ fir_kernel[1] * (queue[1] + queue[8 - 2])
@@ -289,8 +784,7 @@ static void fir_interleaved_8(iqconverter_float_t *cnv, float *samples, int len)
 
 		if (--fir_index < 0)
 		{
-			fir_index = fir_len * (SIZE_FACTOR - 1);
-			memcpy(fir_queue + fir_index + 1, fir_queue, (fir_len - 1) * sizeof(float));
+			fir_index = fir_size - 1;
 		}
 	}
 
@@ -301,7 +795,7 @@ static void fir_interleaved_12(iqconverter_float_t *cnv, float *samples, int len
 {
 	int i;
 	int fir_index = cnv->fir_index;
-	int fir_len = cnv->len;
+	int fir_size = cnv->fir_size;
 	float *fir_kernel = cnv->fir_kernel;
 	float *fir_queue = cnv->fir_queue;
 	float *queue;
@@ -312,6 +806,7 @@ static void fir_interleaved_12(iqconverter_float_t *cnv, float *samples, int len
 		queue = fir_queue + fir_index;
 
 		queue[0] = samples[i];
+		queue[fir_size] = samples[i];
 
 		acc = fir_kernel[0]  * (queue[0]  + queue[12 - 1])
 			+ fir_kernel[1]  * (queue[1]  + queue[12 - 2])
@@ -324,8 +819,7 @@ static void fir_interleaved_12(iqconverter_float_t *cnv, float *samples, int len
 
 		if (--fir_index < 0)
 		{
-			fir_index = fir_len * (SIZE_FACTOR - 1);
-			memcpy(fir_queue + fir_index + 1, fir_queue, (fir_len - 1) * sizeof(float));
+			fir_index = fir_size - 1;
 		}
 	}
 
@@ -336,7 +830,7 @@ static void fir_interleaved_24(iqconverter_float_t *cnv, float *samples, int len
 {
 	int i;
 	int fir_index = cnv->fir_index;
-	int fir_len = cnv->len;
+	int fir_size = cnv->fir_size;
 	float *fir_kernel = cnv->fir_kernel;
 	float *fir_queue = cnv->fir_queue;
 	float *queue;
@@ -347,6 +841,7 @@ static void fir_interleaved_24(iqconverter_float_t *cnv, float *samples, int len
 		queue = fir_queue + fir_index;
 
 		queue[0] = samples[i];
+		queue[fir_size] = samples[i];
 
 		acc = fir_kernel[0]  * (queue[0]  + queue[24 - 1])
 			+ fir_kernel[1]  * (queue[1]  + queue[24 - 2])
@@ -365,8 +860,7 @@ static void fir_interleaved_24(iqconverter_float_t *cnv, float *samples, int len
 
 		if (--fir_index < 0)
 		{
-			fir_index = fir_len * (SIZE_FACTOR - 1);
-			memcpy(fir_queue + fir_index + 1, fir_queue, (fir_len - 1) * sizeof(float));
+			fir_index = fir_size - 1;
 		}
 	}
 
@@ -378,6 +872,7 @@ static void fir_interleaved_generic(iqconverter_float_t *cnv, float *samples, in
 	int i;
 	int fir_index = cnv->fir_index;
 	int fir_len = cnv->len;
+	int fir_size = cnv->fir_size;
 	float *fir_kernel = cnv->fir_kernel;
 	float *fir_queue = cnv->fir_queue;
 	float *queue;
@@ -387,13 +882,13 @@ static void fir_interleaved_generic(iqconverter_float_t *cnv, float *samples, in
 		queue = fir_queue + fir_index;
 
 		queue[0] = samples[i];
+		queue[fir_size] = samples[i];
 
-		samples[i] = process_fir_taps(fir_kernel, queue, fir_len);
+		samples[i] = fir_taps(fir_kernel, queue, fir_len);
 
 		if (--fir_index < 0)
 		{
-			fir_index = fir_len * (SIZE_FACTOR - 1);
-			memcpy(fir_queue + fir_index + 1, fir_queue, (fir_len - 1) * sizeof(float));
+			fir_index = fir_size - 1;
 		}
 	}
 
@@ -402,6 +897,12 @@ static void fir_interleaved_generic(iqconverter_float_t *cnv, float *samples, in
 
 static void fir_interleaved(iqconverter_float_t *cnv, float *samples, int len)
 {
+	if (fir_block != NULL && cnv->fir_symmetric)
+	{
+		fir_block(cnv, samples, len);
+		return;
+	}
+
 	switch (cnv->len)
 	{
 	case 4:
@@ -447,61 +948,67 @@ static void delay_interleaved(iqconverter_float_t *cnv, float *samples, int len)
 	cnv->delay_index = index;
 }
 
-#define SCALE (0.01f)
-
 static void remove_dc(iqconverter_float_t *cnv, float *samples, int len)
 {
-	int i;
-	ALIGNED float avg = cnv->avg;
-
-	for (i = 0; i < len; i++)
-	{
-		samples[i] -= avg;
-		avg += SCALE * samples[i];
-	}
+	cnv->avg = remove_dc_block(samples, len, cnv->avg);
+}
 
-	cnv->avg = avg;
+void iqconverter_float_prepare(iqconverter_float_t *cnv, float *samples, int len)
+{
+	remove_dc(cnv, samples, len);
+	rotate_fs_4(samples, len, cnv->hbc);
 }
 
-static void translate_fs_4(iqconverter_float_t *cnv, float *samples, int len)
+void iqconverter_float_filter(iqconverter_float_t *cnv, float *samples, int len)
 {
-	int i;
-	ALIGNED float hbc = cnv->hbc;
+	fir_interleaved(cnv, samples, len);
+	delay_interleaved(cnv, samples + 1, len);
+}
 
-#ifdef USE_SSE2
+void iqconverter_float_process(iqconverter_float_t *cnv, float *samples, int len)
+{
+	iqconverter_float_prepare(cnv, samples, len);
+	iqconverter_float_filter(cnv, samples, len);
+}
 
-	float *buf = samples;
-	ALIGNED __m128 vec;
-	ALIGNED __m128 rot = _mm_set_ps(hbc, 1.0f, -hbc, -1.0f);
+/*
+ * Outputs only depend on the history values, never on where they sit in the
+ * ring, so pushing the last samples before offset is all a seek takes.
+ */
+void iqconverter_float_seek(iqconverter_float_t *part, const iqconverter_float_t *cnv, const float *samples, int offset)
+{
+	int i;
+	int half_len = cnv->len >> 1;
 
-	for (i = 0; i < len / 4; i++, buf +=4)
+	if (part != cnv)
 	{
-		vec = _mm_loadu_ps(buf);
-		vec = _mm_mul_ps(vec, rot);
-		_mm_storeu_ps(buf, vec);
+		part->avg = cnv->avg;
+		part->fir_index = cnv->fir_index;
+		part->delay_index = cnv->delay_index;
+		memcpy(part->fir_queue, cnv->fir_queue, cnv->fir_size * 2 * sizeof(float));
+		memcpy(part->delay_line, cnv->delay_line, half_len * sizeof(float));
 	}
 
-#else
-
-	int j;
-
-	for (i = 0; i < len / 4; i++)
+	/* Anything older has left both histories */
+	i = offset - 2 * cnv->len;
+	if (i < 0)
 	{
-		j = i << 2;
-		samples[j + 0] = -samples[j + 0];
-		samples[j + 1] = -samples[j + 1] * hbc;
-		//samples[j + 2] = samples[j + 2];
-		samples[j + 3] = samples[j + 3] * hbc;
+		i = 0;
 	}
 
-#endif
-
-	fir_interleaved(cnv, samples, len);
-	delay_interleaved(cnv, samples + 1, len);
-}
+	for (; i < offset; i += 2)
+	{
+		part->fir_queue[part->fir_index] = samples[i];
+		part->fir_queue[part->fir_index + part->fir_size] = samples[i];
+		if (--part->fir_index < 0)
+		{
+			part->fir_index = part->fir_size - 1;
+		}
 
-void iqconverter_float_process(iqconverter_float_t *cnv, float *samples, int len)
-{
-	remove_dc(cnv, samples, len);
-	translate_fs_4(cnv, samples, len);
+		part->delay_line[part->delay_index] = samples[i + 1];
+		if (++part->delay_index >= half_len)
+		{
+			part->delay_index = 0;
+		}
+	}
 }
@@ -36,15 +36,32 @@ typedef struct {
 	float hbc;
 	int len;
 	int fir_index;
+	int fir_size;
 	int delay_index;
+	int fir_symmetric;
 	float *fir_kernel;
 	float *fir_queue;
 	float *delay_line;
 } iqconverter_float_t;
 
+void iqconverter_float_init(uint32_t cpu_features);
 iqconverter_float_t *iqconverter_float_create(const float *hb_kernel, int len);
 void iqconverter_float_free(iqconverter_float_t *cnv);
 void iqconverter_float_reset(iqconverter_float_t *cnv);
 void iqconverter_float_process(iqconverter_float_t *cnv, float *samples, int len);
 
+/*
+ * Split processing, bit exact with iqconverter_float_process() for any split.
+ * iqconverter_float_prepare() runs the sequential DC removal and fs/4 rotation
+ * on the whole buffer. iqconverter_float_seek() then gives a part converter made
+ * by iqconverter_float_clone() the filter history the sequential run has at an
+ * even offset, and iqconverter_float_filter() filters each part, possibly on
+ * another thread. Seeking cnv itself to the end of the buffer, before the
+ * parts overwrite it, leaves cnv ready for the next buffer.
+ */
+iqconverter_float_t *iqconverter_float_clone(const iqconverter_float_t *cnv);
+void iqconverter_float_prepare(iqconverter_float_t *cnv, float *samples, int len);
+void iqconverter_float_seek(iqconverter_float_t *part, const iqconverter_float_t *cnv, const float *samples, int offset);
+void iqconverter_float_filter(iqconverter_float_t *cnv, float *samples, int len);
+
 #endif // IQCONVERTER_FLOAT_H
@@ -24,6 +24,7 @@ THE SOFTWARE, PROVIDED SUCH USE REMAINS WITHIN THE AIRSPY ECOSYSTEM.
 */
 
 #include "iqconverter_int16.h"
+#include "cpu_features.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -48,9 +49,24 @@ void * _aligned_malloc(size_t size, size_t alignment);
   #define _inline inline
 #endif
 
-#define SIZE_FACTOR 16
+#if defined(CPU_X86)
+  #include <immintrin.h>
+#elif defined(CPU_NEON)
+  #include <arm_neon.h>
+#endif
+
+/*
+ * The FIR history is a mirrored ring of fir_size = len - 1 + FIR_RUN_SIZE
+ * entries, each sample being written at fir_index and fir_index + fir_size.
+ * The len taps behind any position are then contiguous and the ring never
+ * has to be copied back when fir_index wraps.
+ */
+#define FIR_RUN_SIZE 256
 #define DEFAULT_ALIGNMENT 16
 
+/* DC blocker pole at 32100 / 32768 */
+#define HPF_COEFF (668.0f / 32768.0f)
+
 iqconverter_int16_t *iqconverter_int16_create(const int16_t *hb_kernel, int len)
 {
 	int i;
@@ -59,11 +75,12 @@ iqconverter_int16_t *iqconverter_int16_create(const int16_t *hb_kernel, int len)
 
 	cnv->len = len / 2 + 1;
 
-	buffer_size = cnv->len * sizeof(int32_t);
+	buffer_size = cnv->len * sizeof(int16_t);
 
-	cnv->fir_kernel = (int32_t *) _aligned_malloc(buffer_size, DEFAULT_ALIGNMENT);
-	cnv->fir_queue = (int32_t *) _aligned_malloc(buffer_size * SIZE_FACTOR, DEFAULT_ALIGNMENT);
-	cnv->delay_line = (int16_t *) _aligned_malloc(buffer_size / 4, DEFAULT_ALIGNMENT);
+	cnv->fir_kernel = (int16_t *) _aligned_malloc(buffer_size, DEFAULT_ALIGNMENT);
+	cnv->fir_size = cnv->len - 1 + FIR_RUN_SIZE;
+	cnv->fir_queue = (int16_t *) _aligned_malloc(cnv->fir_size * 2 * sizeof(int16_t), DEFAULT_ALIGNMENT);
+	cnv->delay_line = (int16_t *) _aligned_malloc(buffer_size / 2, DEFAULT_ALIGNMENT);
 
 	iqconverter_int16_reset(cnv);
 
@@ -72,9 +89,33 @@ iqconverter_int16_t *iqconverter_int16_create(const int16_t *hb_kernel, int len)
 		cnv->fir_kernel[i] = hb_kernel[i * 2];
 	}
 
+	cnv->fir_symmetric = 1;
+	for (i = 0; i < cnv->len / 2; i++)
+	{
+		if (cnv->fir_kernel[i] != cnv->fir_kernel[cnv->len - 1 - i])
+		{
+			cnv->fir_symmetric = 0;
+		}
+	}
+
 	return cnv;
 }
 
+iqconverter_int16_t *iqconverter_int16_clone(const iqconverter_int16_t *cnv)
+{
+	iqconverter_int16_t *part = (iqconverter_int16_t *) _aligned_malloc(sizeof(iqconverter_int16_t), DEFAULT_ALIGNMENT);
+
+	*part = *cnv;
+	part->fir_kernel = (int16_t *) _aligned_malloc(cnv->len * sizeof(int16_t), DEFAULT_ALIGNMENT);
+	part->fir_queue = (int16_t *) _aligned_malloc(cnv->fir_size * 2 * sizeof(int16_t), DEFAULT_ALIGNMENT);
+	part->delay_line = (int16_t *) _aligned_malloc(cnv->len * sizeof(int16_t) / 2, DEFAULT_ALIGNMENT);
+
+	memcpy(part->fir_kernel, cnv->fir_kernel, cnv->len * sizeof(int16_t));
+	iqconverter_int16_reset(part);
+
+	return part;
+}
+
 void iqconverter_int16_free(iqconverter_int16_t *cnv)
 {
 	_aligned_free(cnv->fir_kernel);
@@ -87,22 +128,679 @@ void iqconverter_int16_reset(iqconverter_int16_t *cnv)
 {
 	cnv->fir_index = 0;
 	cnv->delay_index = 0;
-	cnv->old_x = 0;
-	cnv->old_y = 0;
-	cnv->old_e = 0;
-	memset(cnv->delay_line, 0, cnv->len * sizeof(int16_t) / 4);
-	memset(cnv->fir_queue, 0, cnv->len * sizeof(int16_t) * SIZE_FACTOR);
+	cnv->avg = 0.0f;
+	memset(cnv->delay_line, 0, cnv->len * sizeof(int16_t) / 2);
+	memset(cnv->fir_queue, 0, cnv->fir_size * 2 * sizeof(int16_t));
+}
+
+typedef void (*fir_block_fn)(iqconverter_int16_t *cnv, int16_t *samples, int len);
+typedef void (*rotate_fs_4_fn)(int16_t *samples, int len);
+typedef float (*remove_dc_fn)(int16_t *samples, int len, float avg);
+
+static void rotate_fs_4_scalar(int16_t *samples, int len);
+static float remove_dc_scalar(int16_t *samples, int len, float avg);
+
+static fir_block_fn fir_block = NULL;
+static rotate_fs_4_fn rotate_fs_4 = rotate_fs_4_scalar;
+static remove_dc_fn remove_dc_block = remove_dc_scalar;
+
+static _inline int32_t fir_taps(const int16_t *kernel, const int16_t *queue, int len)
+{
+	int j;
+	int32_t acc = 0;
+
+	// Auto vectorization works on VS2012, VS2013 and GCC
+	for (j = 0; j < len; j++)
+	{
+		acc += kernel[j] * queue[j];
+	}
+
+	return acc;
+}
+
+static void rotate_fs_4_scalar(int16_t *samples, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i += 4)
+	{
+		samples[i + 0] = -samples[i + 0];
+		samples[i + 1] = -samples[i + 1] >> 1;
+		//samples[i + 2] = samples[i + 2];
+		samples[i + 3] = samples[i + 3] >> 1;
+	}
+}
+
+/*
+ * One-pole DC blocker y[n] = x[n] - avg[n-1], avg[n] = b * avg[n-1] + a * x[n],
+ * run in float on blocks of 4 samples: a prefix scan of a * x over the block,
+ * plus b^(j+1) times the incoming average, gives every lane's average at once
+ * and only the last one is carried. All variants perform the same operations
+ * in the same order and round half away from zero with saturation, so the
+ * output stays bit exact across CPUs.
+ */
+static _inline int16_t dc_output(float y)
+{
+	if (y >= 32767.0f)
+	{
+		return 32767;
+	}
+	if (y <= -32768.0f)
+	{
+		return -32768;
+	}
+	return (int16_t) (y < 0.0f ? y - 0.5f : y + 0.5f);
+}
+
+static float remove_dc_scalar(int16_t *samples, int len, float avg)
+{
+	int i;
+	const float b = 1.0f - HPF_COEFF;
+	float x0, x1, x2, x3;
+	float p0, p1, p2, p3;
+	float y;
+
+	for (i = 0; i + 4 <= len; i += 4)
+	{
+		x0 = samples[i + 0];
+		x1 = samples[i + 1];
+		x2 = samples[i + 2];
+		x3 = samples[i + 3];
+
+		p0 = x0 * HPF_COEFF;
+		p1 = x1 * HPF_COEFF;
+		p2 = x2 * HPF_COEFF;
+		p3 = x3 * HPF_COEFF;
+
+		p3 = p3 + p2 * b;
+		p2 = p2 + p1 * b;
+		p1 = p1 + p0 * b;
+
+		p3 = p3 + p1 * (b * b);
+		p2 = p2 + p0 * (b * b);
+
+		p0 = p0 + avg * b;
+		p1 = p1 + avg * (b * b);
+		p2 = p2 + avg * (b * b * b);
+		p3 = p3 + avg * (b * b * b * b);
+
+		samples[i + 0] = dc_output(x0 - avg);
+		samples[i + 1] = dc_output(x1 - p0);
+		samples[i + 2] = dc_output(x2 - p1);
+		samples[i + 3] = dc_output(x3 - p2);
+		avg = p3;
+	}
+
+	for (; i < len; i++)
+	{
+		y = samples[i] - avg;
+		avg += HPF_COEFF * y;
+		samples[i] = dc_output(y);
+	}
+
+	return avg;
+}
+
+/*
+ * The vector rotations must match the scalar code for every input, including
+ * -32768 where -x >> 1 is computed in int and gives 16384. That value is
+ * (~x + 1) >> 1, i.e. a rounding average of ~x and 0.
+ *
+ * The vector FIRs compute several consecutive outputs at once from the
+ * reversed queue, where their histories start at consecutive addresses.
+ * Mirrored taps are interleaved into 16 bit pairs and multiplied by the
+ * (h, h) pair, so each multiply-add yields h * (q[k] + q[len - 1 - k]) in 32
+ * bits without overflowing the samples. The 32 bit sums wrap exactly like
+ * the scalar accumulator, so acc >> 15 is bit exact.
+ */
+
+#if defined(CPU_X86)
+
+TARGET_SSE41
+static _inline __m128i fir_taps_x8_sse41(const int16_t *kernel, const int16_t *queue, int len)
+{
+	int k;
+	int half_len = len / 2;
+	__m128i h, a, m;
+	__m128i acc_lo = _mm_setzero_si128();
+	__m128i acc_hi = _mm_setzero_si128();
+
+	for (k = 0; k < half_len; k++)
+	{
+		h = _mm_set1_epi16(kernel[k]);
+		a = _mm_loadu_si128((const __m128i *) (queue + k));
+		m = _mm_loadu_si128((const __m128i *) (queue + len - 1 - k));
+		acc_lo = _mm_add_epi32(acc_lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, m), h));
+		acc_hi = _mm_add_epi32(acc_hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, m), h));
+	}
+	if (len & 1)
+	{
+		h = _mm_set1_epi16(kernel[half_len]);
+		a = _mm_loadu_si128((const __m128i *) (queue + half_len));
+		acc_lo = _mm_add_epi32(acc_lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, _mm_setzero_si128()), h));
+		acc_hi = _mm_add_epi32(acc_hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, _mm_setzero_si128()), h));
+	}
+
+	/* Bits 30..15 sign extended, the pack can no longer saturate */
+	acc_lo = _mm_srai_epi32(_mm_slli_epi32(acc_lo, 1), 16);
+	acc_hi = _mm_srai_epi32(_mm_slli_epi32(acc_hi, 1), 16);
+
+	return _mm_packs_epi32(acc_lo, acc_hi);
+}
+
+TARGET_SSE41
+static _inline void load_even_sse41(int16_t *queue, int16_t *mirror, const int16_t *samples)
+{
+	const __m128i even_lo = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 12, 13, 8, 9, 4, 5, 0, 1);
+	const __m128i even_hi = _mm_setr_epi8(12, 13, 8, 9, 4, 5, 0, 1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+	__m128i even;
+
+	/* Even samples of 16, newest at the lowest address */
+	even = _mm_or_si128(
+		_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) samples), even_lo),
+		_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (samples + 8)), even_hi));
+	_mm_storeu_si128((__m128i *) queue, even);
+	_mm_storeu_si128((__m128i *) mirror, even);
+}
+
+TARGET_SSE41
+static _inline void store_even_sse41(int16_t *samples, __m128i y)
+{
+	const __m128i spread_lo = _mm_setr_epi8(14, 15, -1, -1, 12, 13, -1, -1, 10, 11, -1, -1, 8, 9, -1, -1);
+	const __m128i spread_hi = _mm_setr_epi8(6, 7, -1, -1, 4, 5, -1, -1, 2, 3, -1, -1, 0, 1, -1, -1);
+
+	/* Lane 7 holds the oldest output, put the outputs back on the even slots */
+	_mm_storeu_si128((__m128i *) samples, _mm_blend_epi16(_mm_shuffle_epi8(y, spread_lo), _mm_loadu_si128((const __m128i *) samples), 0xaa));
+	_mm_storeu_si128((__m128i *) (samples + 8), _mm_blend_epi16(_mm_shuffle_epi8(y, spread_hi), _mm_loadu_si128((const __m128i *) (samples + 8)), 0xaa));
+}
+
+TARGET_SSE41
+static void fir_interleaved_sse41(iqconverter_int16_t *cnv, int16_t *samples, int len)
+{
+	int i, j;
+	int count;
+	int fir_index = cnv->fir_index;
+	int fir_len = cnv->len;
+	int fir_size = cnv->fir_size;
+	int16_t *fir_kernel = cnv->fir_kernel;
+	int16_t *fir_queue = cnv->fir_queue;
+
+	for (i = 0; i < len; i += count * 2)
+	{
+		/*
+		 * Outputs left before the queue wraps. Longer runs would overwrite
+		 * the mirrored history their first outputs still need.
+		 */
+		count = (len - i + 1) / 2;
+		if (count > fir_index + 1)
+		{
+			count = fir_index + 1;
+		}
+		if (count > FIR_RUN_SIZE)
+		{
+			count = FIR_RUN_SIZE;
+		}
+
+		for (j = 0; j + 8 <= count; j += 8)
+		{
+			load_even_sse41(fir_queue + fir_index - j - 7, fir_queue + fir_index - j - 7 + fir_size, samples + i + j * 2);
+		}
+		for (; j < count; j++)
+		{
+			fir_queue[fir_index - j] = samples[i + j * 2];
+			fir_queue[fir_index - j + fir_size] = samples[i + j * 2];
+		}
+
+		for (j = 0; j + 8 <= count; j += 8)
+		{
+			store_even_sse41(samples + i + j * 2, fir_taps_x8_sse41(fir_kernel, fir_queue + fir_index - j - 7, fir_len));
+		}
+		for (; j < count; j++)
+		{
+			samples[i + j * 2] = fir_taps(fir_kernel, fir_queue + fir_index - j, fir_len) >> 15;
+		}
+
+		fir_index -= count;
+		if (fir_index < 0)
+		{
+			fir_index = fir_size - 1;
+		}
+	}
+
+	cnv->fir_index = fir_index;
+}
+
+TARGET_AVX2
+static _inline __m256i fir_taps_x16_avx2(const int16_t *kernel, const int16_t *queue, int len)
+{
+	int k;
+	int half_len = len / 2;
+	__m256i h, a, m;
+	__m256i acc_lo = _mm256_setzero_si256();
+	__m256i acc_hi = _mm256_setzero_si256();
+
+	for (k = 0; k < half_len; k++)
+	{
+		h = _mm256_set1_epi16(kernel[k]);
+		a = _mm256_loadu_si256((const __m256i *) (queue + k));
+		m = _mm256_loadu_si256((const __m256i *) (queue + len - 1 - k));
+		acc_lo = _mm256_add_epi32(acc_lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, m), h));
+		acc_hi = _mm256_add_epi32(acc_hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, m), h));
+	}
+	if (len & 1)
+	{
+		h = _mm256_set1_epi16(kernel[half_len]);
+		a = _mm256_loadu_si256((const __m256i *) (queue + half_len));
+		acc_lo = _mm256_add_epi32(acc_lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, _mm256_setzero_si256()), h));
+		acc_hi = _mm256_add_epi32(acc_hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, _mm256_setzero_si256()), h));
+	}
+
+	acc_lo = _mm256_srai_epi32(_mm256_slli_epi32(acc_lo, 1), 16);
+	acc_hi = _mm256_srai_epi32(_mm256_slli_epi32(acc_hi, 1), 16);
+
+	/* The in-lane unpacks and pack cancel out, lanes come back in queue order */
+	return _mm256_packs_epi32(acc_lo, acc_hi);
+}
+
+TARGET_AVX2
+static void fir_interleaved_avx2(iqconverter_int16_t *cnv, int16_t *samples, int len)
+{
+	int i, j;
+	int count;
+	int fir_index = cnv->fir_index;
+	int fir_len = cnv->len;
+	int fir_size = cnv->fir_size;
+	int16_t *fir_kernel = cnv->fir_kernel;
+	int16_t *fir_queue = cnv->fir_queue;
+	__m256i y;
+
+	for (i = 0; i < len; i += count * 2)
+	{
+		/*
+		 * Outputs left before the queue wraps. Longer runs would overwrite
+		 * the mirrored history their first outputs still need.
+		 */
+		count = (len - i + 1) / 2;
+		if (count > fir_index + 1)
+		{
+			count = fir_index + 1;
+		}
+		if (count > FIR_RUN_SIZE)
+		{
+			count = FIR_RUN_SIZE;
+		}
+
+		/* Queue the whole run first, reading right behind the stores would stall */
+		for (j = 0; j + 8 <= count; j += 8)
+		{
+			load_even_sse41(fir_queue + fir_index - j - 7, fir_queue + fir_index - j - 7 + fir_size, samples + i + j * 2);
+		}
+		for (; j < count; j++)
+		{
+			fir_queue[fir_index - j] = samples[i + j * 2];
+			fir_queue[fir_index - j + fir_size] = samples[i + j * 2];
+		}
+
+		for (j = 0; j + 16 <= count; j += 16)
+		{
+			y = fir_taps_x16_avx2(fir_kernel, fir_queue + fir_index - j - 15, fir_len);
+			store_even_sse41(samples + i + j * 2, _mm256_extracti128_si256(y, 1));
+			store_even_sse41(samples + i + j * 2 + 16, _mm256_castsi256_si128(y));
+		}
+		for (; j + 8 <= count; j += 8)
+		{
+			store_even_sse41(samples + i + j * 2, fir_taps_x8_sse41(fir_kernel, fir_queue + fir_index - j - 7, fir_len));
+		}
+		for (; j < count; j++)
+		{
+			samples[i + j * 2] = fir_taps(fir_kernel, fir_queue + fir_index - j, fir_len) >> 15;
+		}
+
+		fir_index -= count;
+		if (fir_index < 0)
+		{
+			fir_index = fir_size - 1;
+		}
+	}
+
+	cnv->fir_index = fir_index;
+}
+
+TARGET_SSE2
+static _inline __m128i dc_output_sse2(__m128 y)
+{
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	return _mm_cvttps_epi32(_mm_add_ps(y, _mm_or_ps(_mm_and_ps(y, sign), half)));
+}
+
+TARGET_SSE2
+static _inline __m128 remove_dc_x4_sse2(__m128 x, __m128 *carry)
+{
+	const float b = 1.0f - HPF_COEFF;
+	const __m128 a1 = _mm_set1_ps(HPF_COEFF);
+	const __m128 b1 = _mm_set1_ps(b);
+	const __m128 b2 = _mm_set1_ps(b * b);
+	const __m128 bn = _mm_setr_ps(b, b * b, b * b * b, b * b * b * b);
+	__m128 p, acc, prev;
+
+	p = _mm_mul_ps(x, a1);
+	p = _mm_add_ps(p, _mm_mul_ps(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(p), 4)), b1));
+	p = _mm_add_ps(p, _mm_mul_ps(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(p), 8)), b2));
+	acc = _mm_add_ps(p, _mm_mul_ps(*carry, bn));
+
+	prev = _mm_move_ss(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(acc), 4)), *carry);
+	*carry = _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(3, 3, 3, 3));
+
+	return _mm_sub_ps(x, prev);
+}
+
+TARGET_SSE2
+static float remove_dc_sse2(int16_t *samples, int len, float avg)
+{
+	int i;
+	__m128i x, lo, hi;
+	__m128 carry = _mm_set1_ps(avg);
+
+	for (i = 0; i + 8 <= len; i += 8)
+	{
+		x = _mm_loadu_si128((const __m128i *) (samples + i));
+		lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+		hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+
+		lo = dc_output_sse2(remove_dc_x4_sse2(_mm_cvtepi32_ps(lo), &carry));
+		hi = dc_output_sse2(remove_dc_x4_sse2(_mm_cvtepi32_ps(hi), &carry));
+		_mm_storeu_si128((__m128i *) (samples + i), _mm_packs_epi32(lo, hi));
+	}
+
+	return remove_dc_scalar(samples + i, len - i, _mm_cvtss_f32(carry));
+}
+
+TARGET_SSE2
+static void rotate_fs_4_sse2(int16_t *samples, int len)
+{
+	int i;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16((short) 0x8000);
+	const __m128i flip = _mm_set1_epi16(0x7fff);
+	const __m128i m0 = _mm_setr_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+	const __m128i m1 = _mm_setr_epi16(0, -1, 0, 0, 0, -1, 0, 0);
+	const __m128i m2 = _mm_setr_epi16(0, 0, -1, 0, 0, 0, -1, 0);
+	const __m128i m3 = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+	__m128i x, neg, neg_half, half;
+
+	for (i = 0; i + 8 <= len; i += 8)
+	{
+		x = _mm_loadu_si128((const __m128i *) (samples + i));
+		neg = _mm_sub_epi16(zero, x);
+		neg_half = _mm_xor_si128(_mm_avg_epu16(_mm_xor_si128(x, flip), bias), bias);
+		half = _mm_srai_epi16(x, 1);
+
+		x = _mm_or_si128(
+			_mm_or_si128(_mm_and_si128(neg, m0), _mm_and_si128(neg_half, m1)),
+			_mm_or_si128(_mm_and_si128(x, m2), _mm_and_si128(half, m3)));
+		_mm_storeu_si128((__m128i *) (samples + i), x);
+	}
+
+	rotate_fs_4_scalar(samples + i, len - i);
+}
+
+TARGET_AVX2
+static void rotate_fs_4_avx2(int16_t *samples, int len)
+{
+	int i;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i bias = _mm256_set1_epi16((short) 0x8000);
+	const __m256i flip = _mm256_set1_epi16(0x7fff);
+	const __m256i m0 = _mm256_setr_epi16(-1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0);
+	const __m256i m1 = _mm256_setr_epi16(0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0);
+	const __m256i m2 = _mm256_setr_epi16(0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0);
+	const __m256i m3 = _mm256_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+	__m256i x, neg, neg_half, half;
+
+	for (i = 0; i + 16 <= len; i += 16)
+	{
+		x = _mm256_loadu_si256((const __m256i *) (samples + i));
+		neg = _mm256_sub_epi16(zero, x);
+		neg_half = _mm256_xor_si256(_mm256_avg_epu16(_mm256_xor_si256(x, flip), bias), bias);
+		half = _mm256_srai_epi16(x, 1);
+
+		x = _mm256_or_si256(
+			_mm256_or_si256(_mm256_and_si256(neg, m0), _mm256_and_si256(neg_half, m1)),
+			_mm256_or_si256(_mm256_and_si256(x, m2), _mm256_and_si256(half, m3)));
+		_mm256_storeu_si256((__m256i *) (samples + i), x);
+	}
+
+	rotate_fs_4_scalar(samples + i, len - i);
+}
+
+#elif defined(CPU_NEON)
+
+static _inline int16x8_t reverse_s16_neon(int16x8_t v)
+{
+	v = vrev64q_s16(v);
+	return vcombine_s16(vget_high_s16(v), vget_low_s16(v));
+}
+
+static _inline int16x8_t fir_taps_x8_neon(const int16_t *kernel, const int16_t *queue, int len)
+{
+	int k;
+	int half_len = len / 2;
+	int16x8_t a, m;
+	int32x4_t acc_lo = vdupq_n_s32(0);
+	int32x4_t acc_hi = vdupq_n_s32(0);
+
+	for (k = 0; k < half_len; k++)
+	{
+		a = vld1q_s16(queue + k);
+		m = vld1q_s16(queue + len - 1 - k);
+		acc_lo = vmlaq_n_s32(acc_lo, vaddl_s16(vget_low_s16(a), vget_low_s16(m)), kernel[k]);
+		acc_hi = vmlaq_n_s32(acc_hi, vaddl_s16(vget_high_s16(a), vget_high_s16(m)), kernel[k]);
+	}
+	if (len & 1)
+	{
+		a = vld1q_s16(queue + half_len);
+		acc_lo = vmlal_n_s16(acc_lo, vget_low_s16(a), kernel[half_len]);
+		acc_hi = vmlal_n_s16(acc_hi, vget_high_s16(a), kernel[half_len]);
+	}
+
+	/* vmovn keeps the low half, like the scalar conversion */
+	return vcombine_s16(vmovn_s32(vshrq_n_s32(acc_lo, 15)), vmovn_s32(vshrq_n_s32(acc_hi, 15)));
+}
+
+static void fir_interleaved_neon(iqconverter_int16_t *cnv, int16_t *samples, int len)
+{
+	int i, j;
+	int count;
+	int fir_index = cnv->fir_index;
+	int fir_len = cnv->len;
+	int fir_size = cnv->fir_size;
+	int16_t *fir_kernel = cnv->fir_kernel;
+	int16_t *fir_queue = cnv->fir_queue;
+	int16x8x2_t iq;
+
+	for (i = 0; i < len; i += count * 2)
+	{
+		/*
+		 * Outputs left before the queue wraps. Longer runs would overwrite
+		 * the mirrored history their first outputs still need.
+		 */
+		count = (len - i + 1) / 2;
+		if (count > fir_index + 1)
+		{
+			count = fir_index + 1;
+		}
+		if (count > FIR_RUN_SIZE)
+		{
+			count = FIR_RUN_SIZE;
+		}
+
+		for (j = 0; j + 8 <= count; j += 8)
+		{
+			iq = vld2q_s16(samples + i + j * 2);
+			iq.val[0] = reverse_s16_neon(iq.val[0]);
+			vst1q_s16(fir_queue + fir_index - j - 7, iq.val[0]);
+			vst1q_s16(fir_queue + fir_index - j - 7 + fir_size, iq.val[0]);
+		}
+		for (; j < count; j++)
+		{
+			fir_queue[fir_index - j] = samples[i + j * 2];
+			fir_queue[fir_index - j + fir_size] = samples[i + j * 2];
+		}
+
+		for (j = 0; j + 8 <= count; j += 8)
+		{
+			iq = vld2q_s16(samples + i + j * 2);
+			iq.val[0] = reverse_s16_neon(fir_taps_x8_neon(fir_kernel, fir_queue + fir_index - j - 7, fir_len));
+			vst2q_s16(samples + i + j * 2, iq);
+		}
+		for (; j < count; j++)
+		{
+			samples[i + j * 2] = fir_taps(fir_kernel, fir_queue + fir_index - j, fir_len) >> 15;
+		}
+
+		fir_index -= count;
+		if (fir_index < 0)
+		{
+			fir_index = fir_size - 1;
+		}
+	}
+
+	cnv->fir_index = fir_index;
+}
+
+static _inline int16x4_t dc_output_neon(float32x4_t y)
+{
+	const uint32x4_t sign = vdupq_n_u32(0x80000000);
+	const uint32x4_t half = vdupq_n_u32(0x3f000000);
+
+	y = vaddq_f32(y, vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(y), sign), half)));
+	return vqmovn_s32(vcvtq_s32_f32(y));
+}
+
+static _inline float32x4_t remove_dc_x4_neon(float32x4_t x, float32x4_t *carry)
+{
+	const float b = 1.0f - HPF_COEFF;
+	const float32x4_t zero = vdupq_n_f32(0.0f);
+	float32x4_t bn, p, acc, prev;
+
+	bn = vsetq_lane_f32(b, zero, 0);
+	bn = vsetq_lane_f32(b * b, bn, 1);
+	bn = vsetq_lane_f32(b * b * b, bn, 2);
+	bn = vsetq_lane_f32(b * b * b * b, bn, 3);
+
+	p = vmulq_n_f32(x, HPF_COEFF);
+	p = vmlaq_n_f32(p, vextq_f32(zero, p, 3), b);
+	p = vmlaq_n_f32(p, vextq_f32(zero, p, 2), b * b);
+	acc = vmlaq_f32(p, *carry, bn);
+
+	prev = vextq_f32(*carry, acc, 3);
+	*carry = vdupq_n_f32(vgetq_lane_f32(acc, 3));
+
+	return vsubq_f32(x, prev);
+}
+
+static float remove_dc_neon(int16_t *samples, int len, float avg)
+{
+	int i;
+	int16x8_t x;
+	int16x4_t lo, hi;
+	float32x4_t carry = vdupq_n_f32(avg);
+
+	for (i = 0; i + 8 <= len; i += 8)
+	{
+		x = vld1q_s16(samples + i);
+		lo = dc_output_neon(remove_dc_x4_neon(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), &carry));
+		hi = dc_output_neon(remove_dc_x4_neon(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), &carry));
+		vst1q_s16(samples + i, vcombine_s16(lo, hi));
+	}
+
+	return remove_dc_scalar(samples + i, len - i, vgetq_lane_f32(carry, 0));
+}
+
+static void rotate_fs_4_neon(int16_t *samples, int len)
+{
+	int i;
+	static const uint16_t mask_table[3][8] = {
+		{ 0xffff, 0, 0, 0, 0xffff, 0, 0, 0 },
+		{ 0, 0xffff, 0, 0, 0, 0xffff, 0, 0 },
+		{ 0, 0, 0, 0xffff, 0, 0, 0, 0xffff }
+	};
+	const uint16x8_t m0 = vld1q_u16(mask_table[0]);
+	const uint16x8_t m1 = vld1q_u16(mask_table[1]);
+	const uint16x8_t m3 = vld1q_u16(mask_table[2]);
+	int16x8_t x;
+
+	for (i = 0; i + 8 <= len; i += 8)
+	{
+		x = vld1q_s16(samples + i);
+		x = vbslq_s16(m3, vshrq_n_s16(x, 1), x);
+		x = vbslq_s16(m1, vrhaddq_s16(vmvnq_s16(x), vdupq_n_s16(0)), x);
+		x = vbslq_s16(m0, vnegq_s16(x), x);
+		vst1q_s16(samples + i, x);
+	}
+
+	rotate_fs_4_scalar(samples + i, len - i);
+}
+
+#endif
+
+void iqconverter_int16_init(uint32_t cpu_features)
+{
+	fir_block = NULL;
+	rotate_fs_4 = rotate_fs_4_scalar;
+	remove_dc_block = remove_dc_scalar;
+
+#if defined(CPU_X86)
+	if (cpu_features & CPU_FEATURE_AVX2)
+	{
+		fir_block = fir_interleaved_avx2;
+		rotate_fs_4 = rotate_fs_4_avx2;
+	}
+	else
+	{
+		if (cpu_features & CPU_FEATURE_SSE41)
+		{
+			fir_block = fir_interleaved_sse41;
+		}
+		if (cpu_features & CPU_FEATURE_SSE2)
+		{
+			rotate_fs_4 = rotate_fs_4_sse2;
+		}
+	}
+
+	if (cpu_features & CPU_FEATURE_SSE2)
+	{
+		remove_dc_block = remove_dc_sse2;
+	}
+#elif defined(CPU_NEON)
+	if (cpu_features & CPU_FEATURE_NEON)
+	{
+		fir_block = fir_interleaved_neon;
+		rotate_fs_4 = rotate_fs_4_neon;
+		remove_dc_block = remove_dc_neon;
+	}
+#else
+	(void) cpu_features;
+#endif
 }
 
 static void fir_interleaved(iqconverter_int16_t *cnv, int16_t *samples, int len)
 {
 	int i;
-	int j;
 	int fir_index;
 	int fir_len;
-	int32_t *queue;
+	int16_t *queue;
 	int32_t acc;
 
+	if (fir_block != NULL && cnv->fir_symmetric)
+	{
+		fir_block(cnv, samples, len);
+		return;
+	}
+
 	fir_len = cnv->len;
 	fir_index = cnv->fir_index;
 
@@ -111,19 +809,13 @@ static void fir_interleaved(iqconverter_int16_t *cnv, int16_t *samples, int len)
 		queue = cnv->fir_queue + fir_index;
 
 		queue[0] = samples[i];
+		queue[cnv->fir_size] = samples[i];
 
-		acc = 0;
-		
-		// Auto vectorization works on VS2012, VS2013 and GCC
-		for (j = 0; j < fir_len; j++)
-		{
-			acc += cnv->fir_kernel[j] * queue[j];
-		}
+		acc = fir_taps(cnv->fir_kernel, queue, fir_len);
 
 		if (--fir_index < 0)
 		{
-			fir_index = cnv->len * (SIZE_FACTOR - 1);
-			memcpy(cnv->fir_queue + fir_index + 1, cnv->fir_queue, (cnv->len - 1) * sizeof(int32_t));
+			fir_index = cnv->fir_size - 1;
 		}
 
 		samples[i] = acc >> 15;
@@ -159,50 +851,65 @@ static void delay_interleaved(iqconverter_int16_t *cnv, int16_t *samples, int le
 
 static void remove_dc(iqconverter_int16_t *cnv, int16_t *samples, int len)
 {
-	int i;
-	int32_t u, old_e;
-	int16_t x, y, w, s, old_x, old_y;
+	cnv->avg = remove_dc_block(samples, len, cnv->avg);
+}
 
-	old_x = cnv->old_x;
-	old_y = cnv->old_y;
-	old_e = cnv->old_e;
+void iqconverter_int16_prepare(iqconverter_int16_t *cnv, int16_t *samples, int len)
+{
+	remove_dc(cnv, samples, len);
+	rotate_fs_4(samples, len);
+}
 
-	for (i = 0; i < len; i++)
-	{
-		x = samples[i];
-		w = x - old_x;
-		u = old_e + (int32_t) old_y * 32100;
-		s = u >> 15;
-		y = w + s;
-		old_e = u - (s << 15);
-		old_x = x;
-		old_y = y;		
-		samples[i] = y;
-	}
+void iqconverter_int16_filter(iqconverter_int16_t *cnv, int16_t *samples, int len)
+{
+	fir_interleaved(cnv, samples, len);
+	delay_interleaved(cnv, samples + 1, len);
+}
 
-	cnv->old_x = old_x;
-	cnv->old_y = old_y;
-	cnv->old_e = old_e;
+void iqconverter_int16_process(iqconverter_int16_t *cnv, int16_t *samples, int len)
+{
+	iqconverter_int16_prepare(cnv, samples, len);
+	iqconverter_int16_filter(cnv, samples, len);
 }
 
-static void translate_fs_4(iqconverter_int16_t *cnv, int16_t *samples, int len)
+/*
+ * Outputs only depend on the history values, never on where they sit in the
+ * ring, so pushing the last samples before offset is all a seek takes.
+ */
+void iqconverter_int16_seek(iqconverter_int16_t *part, const iqconverter_int16_t *cnv, const int16_t *samples, int offset)
 {
 	int i;
+	int half_len = cnv->len >> 1;
 
-	for (i = 0; i < len; i += 4)
+	if (part != cnv)
 	{
-		samples[i + 0] = -samples[i + 0];
-		samples[i + 1] = -samples[i + 1] >> 1;
-		//samples[i + 2] = samples[i + 2];
-		samples[i + 3] = samples[i + 3] >> 1;
+		part->avg = cnv->avg;
+		part->fir_index = cnv->fir_index;
+		part->delay_index = cnv->delay_index;
+		memcpy(part->fir_queue, cnv->fir_queue, cnv->fir_size * 2 * sizeof(int16_t));
+		memcpy(part->delay_line, cnv->delay_line, half_len * sizeof(int16_t));
 	}
 
-	fir_interleaved(cnv, samples, len);
-	delay_interleaved(cnv, samples + 1, len);
-}
+	/* Anything older has left both histories */
+	i = offset - 2 * cnv->len;
+	if (i < 0)
+	{
+		i = 0;
+	}
 
-void iqconverter_int16_process(iqconverter_int16_t *cnv, int16_t *samples, int len)
-{
-	remove_dc(cnv, samples, len);
-	translate_fs_4(cnv, samples, len);
+	for (; i < offset; i += 2)
+	{
+		part->fir_queue[part->fir_index] = samples[i];
+		part->fir_queue[part->fir_index + part->fir_size] = samples[i];
+		if (--part->fir_index < 0)
+		{
+			part->fir_index = part->fir_size - 1;
+		}
+
+		part->delay_line[part->delay_index] = samples[i + 1];
+		if (++part->delay_index >= half_len)
+		{
+			part->delay_index = 0;
+		}
+	}
 }
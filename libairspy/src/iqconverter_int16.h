@@ -31,18 +31,33 @@ THE SOFTWARE, PROVIDED SUCH USE REMAINS WITHIN THE AIRSPY ECOSYSTEM.
 typedef struct {
 	int len;
 	int fir_index;
+	int fir_size;
 	int delay_index;
-	int16_t old_x;
-	int16_t old_y;
-	int32_t old_e;
-	int32_t *fir_kernel;
-	int32_t *fir_queue;
+	int fir_symmetric;
+	float avg;
+	int16_t *fir_kernel;
+	int16_t *fir_queue;
 	int16_t *delay_line;
 } iqconverter_int16_t;
 
+void iqconverter_int16_init(uint32_t cpu_features);
 iqconverter_int16_t *iqconverter_int16_create(const int16_t *hb_kernel, int len);
 void iqconverter_int16_free(iqconverter_int16_t *cnv);
 void iqconverter_int16_reset(iqconverter_int16_t *cnv);
 void iqconverter_int16_process(iqconverter_int16_t *cnv, int16_t *samples, int len);
 
+/*
+ * Split processing, bit exact with iqconverter_int16_process() for any split.
+ * iqconverter_int16_prepare() runs the sequential DC removal and fs/4 rotation
+ * on the whole buffer. iqconverter_int16_seek() then gives a part converter made
+ * by iqconverter_int16_clone() the filter history the sequential run has at an
+ * even offset, and iqconverter_int16_filter() filters each part, possibly on
+ * another thread. Seeking cnv itself to the end of the buffer, before the
+ * parts overwrite it, leaves cnv ready for the next buffer.
+ */
+iqconverter_int16_t *iqconverter_int16_clone(const iqconverter_int16_t *cnv);
+void iqconverter_int16_prepare(iqconverter_int16_t *cnv, int16_t *samples, int len);
+void iqconverter_int16_seek(iqconverter_int16_t *part, const iqconverter_int16_t *cnv, const int16_t *samples, int offset);
+void iqconverter_int16_filter(iqconverter_int16_t *cnv, int16_t *samples, int len);
+
 #endif // IQCONVERTER_INT16_H
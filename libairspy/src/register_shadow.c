@@ -0,0 +1,82 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string.h>
+
+#include "register_shadow.h"
+
+#define REGISTER_BIT(reg) ((uint32_t) 1 << ((reg) & 31))
+
+void register_shadow_init(register_shadow_t *shadow, uint32_t count, const uint8_t *uncached, uint32_t uncached_count)
+{
+	uint32_t i;
+
+	memset(shadow, 0, sizeof(register_shadow_t));
+	shadow->count = count;
+
+	for (i = 0; i < uncached_count; i++)
+	{
+		shadow->uncached[uncached[i] / 32] |= REGISTER_BIT(uncached[i]);
+	}
+}
+
+int register_shadow_cacheable(const register_shadow_t *shadow, uint8_t reg)
+{
+	return reg < shadow->count && !(shadow->uncached[reg / 32] & REGISTER_BIT(reg));
+}
+
+int register_shadow_get(const register_shadow_t *shadow, uint8_t reg, uint8_t *value)
+{
+	if (!(shadow->valid[reg / 32] & REGISTER_BIT(reg)))
+	{
+		return -1;
+	}
+
+	*value = shadow->values[reg];
+
+	return 0;
+}
+
+int register_shadow_matches(const register_shadow_t *shadow, uint8_t reg, uint8_t value)
+{
+	uint8_t current;
+
+	return register_shadow_get(shadow, reg, &current) == 0 && current == value;
+}
+
+void register_shadow_set(register_shadow_t *shadow, uint8_t reg, uint8_t value)
+{
+	if (register_shadow_cacheable(shadow, reg))
+	{
+		shadow->values[reg] = value;
+		shadow->valid[reg / 32] |= REGISTER_BIT(reg);
+	}
+}
+
+void register_shadow_invalidate(register_shadow_t *shadow, uint8_t reg)
+{
+	shadow->valid[reg / 32] &= ~REGISTER_BIT(reg);
+}
+
+void register_shadow_invalidate_all(register_shadow_t *shadow)
+{
+	memset(shadow->valid, 0, sizeof(shadow->valid));
+}
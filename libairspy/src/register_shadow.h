@@ -0,0 +1,58 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef REGISTER_SHADOW_H
+#define REGISTER_SHADOW_H
+
+#include <stdint.h>
+
+#define REGISTER_SHADOW_SIZE 256
+
+/*
+ * Host copy of the registers of an I2C chip behind the firmware. A register
+ * is valid once read or written; uncached registers (status bits, self
+ * clearing commands) are never valid. Not thread safe, the caller locks.
+ */
+typedef struct register_shadow
+{
+	uint8_t values[REGISTER_SHADOW_SIZE];
+	uint32_t valid[REGISTER_SHADOW_SIZE / 32];
+	uint32_t uncached[REGISTER_SHADOW_SIZE / 32];
+	uint32_t count;
+} register_shadow_t;
+
+void register_shadow_init(register_shadow_t *shadow, uint32_t count, const uint8_t *uncached, uint32_t uncached_count);
+
+int register_shadow_cacheable(const register_shadow_t *shadow, uint8_t reg);
+
+/* 0 with *value set when the register is valid, -1 otherwise */
+int register_shadow_get(const register_shadow_t *shadow, uint8_t reg, uint8_t *value);
+
+/* Whether the register is known to hold value already */
+int register_shadow_matches(const register_shadow_t *shadow, uint8_t reg, uint8_t value);
+
+/* Ignored for uncached registers */
+void register_shadow_set(register_shadow_t *shadow, uint8_t reg, uint8_t value);
+
+void register_shadow_invalidate(register_shadow_t *shadow, uint8_t reg);
+void register_shadow_invalidate_all(register_shadow_t *shadow);
+
+#endif // REGISTER_SHADOW_H
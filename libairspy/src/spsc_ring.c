@@ -0,0 +1,197 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "spsc_ring.h"
+#include "atomics.h"
+
+#if defined(_WIN32)
+  #include <sys/timeb.h>
+#else
+  #include <sys/time.h>
+#endif
+
+int spsc_ring_init(spsc_ring_t *ring, uint32_t size)
+{
+	if (spsc_ring_resize(ring, size) != 0)
+	{
+		return -1;
+	}
+
+	if (pthread_mutex_init(&ring->mutex, NULL) != 0)
+	{
+		return -1;
+	}
+
+	if (pthread_cond_init(&ring->cond, NULL) != 0)
+	{
+		pthread_mutex_destroy(&ring->mutex);
+		return -1;
+	}
+
+	return 0;
+}
+
+void spsc_ring_destroy(spsc_ring_t *ring)
+{
+	pthread_cond_destroy(&ring->cond);
+	pthread_mutex_destroy(&ring->mutex);
+}
+
+/* Only valid while neither side is running */
+int spsc_ring_resize(spsc_ring_t *ring, uint32_t size)
+{
+	if (size == 0 || (size & (size - 1)) != 0)
+	{
+		return -1;
+	}
+
+	ring->size = size;
+	spsc_ring_reset(ring);
+
+	return 0;
+}
+
+/* Only valid while neither side is running */
+void spsc_ring_reset(spsc_ring_t *ring)
+{
+	ring->head = 0;
+	ring->tail = 0;
+	ring->parked = 0;
+	ring->closed = 0;
+}
+
+int spsc_ring_acquire(spsc_ring_t *ring)
+{
+	uint32_t head = ring->head;
+
+	if (head - atomic_load_acquire(&ring->tail) >= ring->size)
+	{
+		return -1;
+	}
+
+	return (int) (head & (ring->size - 1));
+}
+
+void spsc_ring_publish(spsc_ring_t *ring)
+{
+	/*
+	 * Pairs with the parked store / head load in spsc_ring_wait(): either the
+	 * consumer sees the new head or we see it parked, never neither.
+	 */
+	atomic_store_seq_cst(&ring->head, ring->head + 1);
+
+	if (atomic_load_seq_cst(&ring->parked))
+	{
+		pthread_mutex_lock(&ring->mutex);
+		pthread_cond_signal(&ring->cond);
+		pthread_mutex_unlock(&ring->mutex);
+	}
+}
+
+uint32_t spsc_ring_count(spsc_ring_t *ring)
+{
+	return ring->head - atomic_load_acquire(&ring->tail);
+}
+
+int spsc_ring_peek(spsc_ring_t *ring)
+{
+	uint32_t tail = ring->tail;
+
+	if (atomic_load_acquire(&ring->head) == tail)
+	{
+		return -1;
+	}
+
+	return (int) (tail & (ring->size - 1));
+}
+
+int spsc_ring_wait(spsc_ring_t *ring, const struct timespec *deadline)
+{
+	int slot;
+	int result = 0;
+
+	if (ring->closed)
+	{
+		return -1;
+	}
+
+	slot = spsc_ring_peek(ring);
+	if (slot >= 0)
+	{
+		return slot;
+	}
+
+	pthread_mutex_lock(&ring->mutex);
+	atomic_store_seq_cst(&ring->parked, 1);
+
+	while (!ring->closed && result == 0 && atomic_load_seq_cst(&ring->head) == ring->tail)
+	{
+		if (deadline != NULL)
+		{
+			result = pthread_cond_timedwait(&ring->cond, &ring->mutex, deadline);
+		}
+		else
+		{
+			pthread_cond_wait(&ring->cond, &ring->mutex);
+		}
+	}
+
+	atomic_store_release(&ring->parked, 0);
+	pthread_mutex_unlock(&ring->mutex);
+
+	return ring->closed ? -1 : spsc_ring_peek(ring);
+}
+
+void spsc_ring_release(spsc_ring_t *ring)
+{
+	atomic_store_release(&ring->tail, ring->tail + 1);
+}
+
+void spsc_ring_deadline(struct timespec *deadline, int timeout_ms)
+{
+#if defined(_WIN32)
+	struct __timeb64 now;
+
+	_ftime64(&now);
+	deadline->tv_sec = (time_t) now.time + timeout_ms / 1000;
+	deadline->tv_nsec = ((long) now.millitm + timeout_ms % 1000) * 1000000L;
+#else
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	deadline->tv_sec = now.tv_sec + timeout_ms / 1000;
+	deadline->tv_nsec = (now.tv_usec + (long) (timeout_ms % 1000) * 1000L) * 1000L;
+#endif
+
+	if (deadline->tv_nsec >= 1000000000L)
+	{
+		deadline->tv_sec++;
+		deadline->tv_nsec -= 1000000000L;
+	}
+}
+
+void spsc_ring_close(spsc_ring_t *ring)
+{
+	pthread_mutex_lock(&ring->mutex);
+	ring->closed = 1;
+	pthread_cond_signal(&ring->cond);
+	pthread_mutex_unlock(&ring->mutex);
+}
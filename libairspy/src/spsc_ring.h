@@ -0,0 +1,85 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+
+#if _MSC_VER > 1700
+#define HAVE_STRUCT_TIMESPEC
+#endif
+
+#include <pthread.h>
+
+#define SPSC_RING_CACHE_LINE 64
+
+/*
+ * Single producer / single consumer ring of slot indices. The producer only
+ * writes head and the consumer only writes tail, both free running counters,
+ * so neither side ever takes a lock to move data. The mutex and condition
+ * variable are only used when the consumer has found the ring empty and
+ * parked itself; the producer checks the parked flag after publishing and
+ * signals only in that case.
+ */
+typedef struct spsc_ring
+{
+	volatile uint32_t head;
+	char pad0[SPSC_RING_CACHE_LINE - sizeof(uint32_t)];
+	volatile uint32_t tail;
+	char pad1[SPSC_RING_CACHE_LINE - sizeof(uint32_t)];
+	volatile uint32_t parked;
+	volatile uint32_t closed;
+	uint32_t size;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+} spsc_ring_t;
+
+/* size must be a power of two */
+int spsc_ring_init(spsc_ring_t *ring, uint32_t size);
+void spsc_ring_destroy(spsc_ring_t *ring);
+void spsc_ring_reset(spsc_ring_t *ring);
+int spsc_ring_resize(spsc_ring_t *ring, uint32_t size);
+
+/* Producer side: index of the next free slot, or -1 when the ring is full */
+int spsc_ring_acquire(spsc_ring_t *ring);
+void spsc_ring_publish(spsc_ring_t *ring);
+
+/* Producer side: filled slots not yet released by the consumer */
+uint32_t spsc_ring_count(spsc_ring_t *ring);
+
+/*
+ * Consumer side: index of the oldest filled slot. spsc_ring_peek() returns -1
+ * when empty, spsc_ring_wait() blocks until a slot is available and returns
+ * -1 once the ring is closed or the deadline (NULL waits forever) has passed.
+ * The slot stays owned by the consumer until spsc_ring_release().
+ */
+int spsc_ring_peek(spsc_ring_t *ring);
+int spsc_ring_wait(spsc_ring_t *ring, const struct timespec *deadline);
+void spsc_ring_release(spsc_ring_t *ring);
+
+/* Wakes a parked consumer and makes every further wait return -1 */
+void spsc_ring_close(spsc_ring_t *ring);
+
+/* Absolute deadline timeout_ms from now, for spsc_ring_wait() */
+void spsc_ring_deadline(struct timespec *deadline, int timeout_ms);
+
+#endif // SPSC_RING_H
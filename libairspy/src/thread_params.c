@@ -0,0 +1,160 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* pthread_setaffinity_np() and pthread_setname_np() */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+  #define _GNU_SOURCE
+#endif
+
+#include "thread_params.h"
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <stdio.h>
+  #include <sched.h>
+#endif
+
+#if !defined(_WIN32)
+static int native_policy(int policy)
+{
+	switch (policy)
+	{
+	case THREAD_POLICY_FIFO:
+		return SCHED_FIFO;
+	case THREAD_POLICY_RR:
+		return SCHED_RR;
+	default:
+		return SCHED_OTHER;
+	}
+}
+#endif
+
+int thread_params_check(const thread_params_t *params)
+{
+	if (params->policy == THREAD_POLICY_DEFAULT)
+	{
+		return params->priority == 0 ? 0 : -1;
+	}
+
+	if (params->policy != THREAD_POLICY_FIFO && params->policy != THREAD_POLICY_RR)
+	{
+		return -1;
+	}
+
+#if defined(_WIN32)
+	/* Realtime policies map to THREAD_PRIORITY_TIME_CRITICAL, there is no level to pick */
+	return params->priority == 0 ? 0 : -1;
+#else
+	if (params->priority < sched_get_priority_min(native_policy(params->policy)) ||
+		params->priority > sched_get_priority_max(native_policy(params->policy)))
+	{
+		return -1;
+	}
+
+	return 0;
+#endif
+}
+
+/* Elsewhere a thread can only name itself, or not at all */
+static void set_name(pthread_t thread, const thread_params_t *params, const char *fallback, int index)
+{
+#if defined(__linux__)
+	char name[THREAD_NAME_SIZE];
+	const char *base = params->name[0] != '\0' ? params->name : fallback;
+
+	if (index >= 0)
+	{
+		snprintf(name, sizeof(name), "%.*s%d", THREAD_NAME_SIZE - 4, base, index % 1000);
+	}
+	else
+	{
+		snprintf(name, sizeof(name), "%s", base);
+	}
+
+	pthread_setname_np(thread, name);
+#else
+	(void) thread;
+	(void) params;
+	(void) fallback;
+	(void) index;
+#endif
+}
+
+int thread_params_apply(pthread_t thread, const thread_params_t *params, const char *fallback, int index)
+{
+	int result = 0;
+#if defined(_WIN32)
+	HANDLE handle = pthread_getw32threadhandle_np(thread);
+#elif defined(__linux__)
+	cpu_set_t cpu_set;
+	int cpu;
+#endif
+#if !defined(_WIN32)
+	struct sched_param sched;
+#endif
+
+	set_name(thread, params, fallback, index);
+
+	if (params->cpu_mask != 0)
+	{
+#if defined(_WIN32)
+		if (SetThreadAffinityMask(handle, (DWORD_PTR) params->cpu_mask) == 0)
+		{
+			result = -1;
+		}
+#elif defined(__linux__)
+		CPU_ZERO(&cpu_set);
+		for (cpu = 0; cpu < 64; cpu++)
+		{
+			if (params->cpu_mask & ((uint64_t) 1 << cpu))
+			{
+				CPU_SET(cpu, &cpu_set);
+			}
+		}
+		if (pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set) != 0)
+		{
+			result = -1;
+		}
+#else
+		result = -1;
+#endif
+	}
+
+	if (params->policy != THREAD_POLICY_DEFAULT)
+	{
+#if defined(_WIN32)
+		if (!SetThreadPriority(handle, THREAD_PRIORITY_TIME_CRITICAL))
+		{
+			result = -1;
+		}
+#else
+		/* Fails with EPERM without CAP_SYS_NICE or an RLIMIT_RTPRIO allowance */
+		sched.sched_priority = params->priority;
+		if (pthread_setschedparam(thread, native_policy(params->policy), &sched) != 0)
+		{
+			result = -1;
+		}
+#endif
+	}
+
+	return result;
+}
@@ -0,0 +1,64 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef THREAD_PARAMS_H
+#define THREAD_PARAMS_H
+
+#include <stdint.h>
+
+#if _MSC_VER > 1700
+#define HAVE_STRUCT_TIMESPEC
+#endif
+
+#include <pthread.h>
+
+/* Same values as enum airspy_sched_policy */
+#define THREAD_POLICY_DEFAULT 0
+#define THREAD_POLICY_FIFO 1
+#define THREAD_POLICY_RR 2
+
+/* Linux limit, terminator included */
+#define THREAD_NAME_SIZE 16
+
+/*
+ * Placement, scheduling and name of a library thread. A zero cpu_mask leaves
+ * the affinity alone and THREAD_POLICY_DEFAULT the scheduling; an empty name
+ * keeps the library default.
+ */
+typedef struct thread_params
+{
+	uint64_t cpu_mask;
+	int policy;
+	int priority;
+	char name[THREAD_NAME_SIZE];
+} thread_params_t;
+
+/* 0 when the policy and priority are valid on this platform */
+int thread_params_check(const thread_params_t *params);
+
+/*
+ * Applies params to a running thread, named params->name or else fallback,
+ * followed by index when index >= 0. Returns 0 when everything requested took
+ * effect; naming is best effort and never fails the call.
+ */
+int thread_params_apply(pthread_t thread, const thread_params_t *params, const char *fallback, int index);
+
+#endif // THREAD_PARAMS_H
@@ -0,0 +1,143 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "time_filter.h"
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <time.h>
+#endif
+
+/*
+ * Loop bandwidth in Hz: wide while locking, then narrowed as 1 / elapsed
+ * seconds down to a floor that still follows the crystal drift
+ */
+#define LOCK_BANDWIDTH (5.0)
+#define TRACK_BANDWIDTH (0.02)
+
+/* A completion this many periods off (stall, dropped events) restarts the loop */
+#define RESYNC_PERIODS (8.0)
+
+#define TWO_PI (6.283185307179586)
+#define SQRT_2 (1.4142135623730951)
+
+void time_filter_reset(time_filter_t *filter, double nominal_period)
+{
+	filter->t0 = 0.0;
+	filter->t1 = 0.0;
+	filter->period = nominal_period;
+	filter->start = 0.0;
+	filter->state = 0;
+}
+
+double time_filter_update(time_filter_t *filter, double t)
+{
+	double e;
+	double w;
+	double bandwidth;
+
+	if (filter->state == 0 || (filter->state == 1 && filter->period <= 0.0))
+	{
+		/* Without a nominal rate the first interval seeds the period */
+		if (filter->state == 1)
+		{
+			filter->period = t - filter->t0;
+		}
+		filter->t0 = t;
+		filter->t1 = t + filter->period;
+		filter->start = t;
+		filter->state++;
+		return filter->period > 0.0 ? t - filter->period : t;
+	}
+
+	e = t - filter->t1;
+	if (e > RESYNC_PERIODS * filter->period || e < -RESYNC_PERIODS * filter->period)
+	{
+		filter->t0 = t;
+		filter->t1 = t + filter->period;
+		filter->start = t;
+		return t - filter->period;
+	}
+
+	bandwidth = LOCK_BANDWIDTH / (1.0 + t - filter->start);
+	if (bandwidth < TRACK_BANDWIDTH)
+	{
+		bandwidth = TRACK_BANDWIDTH;
+	}
+
+	w = TWO_PI * filter->period * bandwidth;
+
+	filter->t0 = filter->t1;
+	filter->t1 += SQRT_2 * w * e + filter->period;
+	filter->period += w * w * e;
+
+	return filter->t0 - filter->period;
+}
+
+#if defined(_WIN32)
+
+uint64_t time_monotonic_ns(void)
+{
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+
+	return (uint64_t) (counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+		(uint64_t) (counter.QuadPart % frequency.QuadPart) * 1000000000ULL / (uint64_t) frequency.QuadPart;
+}
+
+int64_t time_realtime_offset_ns(void)
+{
+	FILETIME now;
+	uint64_t ticks;
+
+	GetSystemTimeAsFileTime(&now);
+	ticks = ((uint64_t) now.dwHighDateTime << 32) | now.dwLowDateTime;
+
+	/* 100 ns ticks since 1601 to ns since 1970 */
+	return (int64_t) ((ticks - 116444736000000000ULL) * 100ULL) - (int64_t) time_monotonic_ns();
+}
+
+#else
+
+static uint64_t clock_ns(clockid_t clock)
+{
+	struct timespec now;
+
+	clock_gettime(clock, &now);
+
+	return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+uint64_t time_monotonic_ns(void)
+{
+	return clock_ns(CLOCK_MONOTONIC);
+}
+
+int64_t time_realtime_offset_ns(void)
+{
+	return (int64_t) clock_ns(CLOCK_REALTIME) - (int64_t) clock_ns(CLOCK_MONOTONIC);
+}
+
+#endif
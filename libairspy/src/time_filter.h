@@ -0,0 +1,55 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TIME_FILTER_H
+#define TIME_FILTER_H
+
+#include <stdint.h>
+
+/*
+ * Second order delay locked loop (F. Adriaensen, "Using a DLL to filter
+ * time") fed with the host time of each USB completion. Completions arrive
+ * with scheduling jitter of up to milliseconds, but the buffers behind them
+ * are filled at the exact ADC rate, so the loop tracks the true period and
+ * phase and returns a time whose jitter is reduced by roughly the ratio of
+ * its bandwidth to the completion rate. Times are in seconds since any
+ * origin close enough to keep double precision at the nanosecond level.
+ */
+typedef struct time_filter
+{
+	double t0;
+	double t1;
+	double period;
+	double start;
+	uint32_t state;
+} time_filter_t;
+
+/* nominal_period is the expected time between events, 0 when unknown */
+void time_filter_reset(time_filter_t *filter, double nominal_period);
+
+/* Feeds the time of one completion, returns the filtered time of the first sample it carries */
+double time_filter_update(time_filter_t *filter, double t);
+
+/* Host clocks in nanoseconds: CLOCK_MONOTONIC, and the CLOCK_REALTIME minus CLOCK_MONOTONIC offset */
+uint64_t time_monotonic_ns(void);
+int64_t time_realtime_offset_ns(void);
+
+#endif // TIME_FILTER_H
@@ -0,0 +1,590 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "unpacker.h"
+
+#if defined(CPU_X86)
+  #include <immintrin.h>
+#endif
+
+#if defined(CPU_NEON)
+  #include <arm_neon.h>
+#endif
+
+#if !defined(_MSC_VER)
+  #define _inline inline
+#endif
+
+/*
+ * A group is 3 words (12 bytes) holding 8 samples, MSB first:
+ *
+ *   word 0: s0[11:0] s1[11:0] s2[11:4]
+ *   word 1: s2[3:0] s3[11:0] s4[11:0] s5[11:8]
+ *   word 2: s5[7:0] s6[11:0] s7[11:0]
+ *
+ * Viewed as little endian bytes b0..b11, every sample is made of a high byte H
+ * and a low byte L. Even samples are (H << 4) | (L >> 4) and odd samples are
+ * ((H & 0xf) << 8) | L. The SIMD kernels gather (L, H) into 16 bit lanes with
+ * a byte shuffle, multiply odd lanes by 16 to drop the extra nibble of H and
+ * shift every lane right by 4.
+ */
+#define GROUP_BYTES (12)
+#define GROUP_SAMPLES (8)
+
+unpack_samples_fn unpack_samples = unpack_samples_scalar;
+convert_samples_float_fn convert_samples_float = convert_samples_float_scalar;
+convert_samples_int16_fn convert_samples_int16 = convert_samples_int16_scalar;
+unpack_samples_float_fn unpack_samples_float = unpack_samples_float_scalar;
+unpack_samples_int16_fn unpack_samples_int16 = unpack_samples_int16_scalar;
+
+static _inline void unpack_group(const uint32_t *input, uint16_t *output)
+{
+	output[0] = (input[0] >> 20) & 0xfff;
+	output[1] = (input[0] >> 8) & 0xfff;
+	output[2] = ((input[0] & 0xff) << 4) | ((input[1] >> 28) & 0xf);
+	output[3] = ((input[1] & 0xfff0000) >> 16);
+	output[4] = ((input[1] & 0xfff0) >> 4);
+	output[5] = ((input[1] & 0xf) << 8) | ((input[2] & 0xff000000) >> 24);
+	output[6] = ((input[2] >> 12) & 0xfff);
+	output[7] = ((input[2] & 0xfff));
+}
+
+static _inline void unpack_group_float(const uint32_t *input, float *dest)
+{
+	uint16_t samples[GROUP_SAMPLES];
+
+	unpack_group(input, samples);
+	convert_samples_float_scalar(samples, dest, GROUP_SAMPLES);
+}
+
+static _inline void unpack_group_int16(const uint32_t *input, int16_t *dest)
+{
+	uint16_t samples[GROUP_SAMPLES];
+
+	unpack_group(input, samples);
+	convert_samples_int16_scalar(samples, dest, GROUP_SAMPLES);
+}
+
+void unpack_samples_scalar(const uint32_t *input, uint16_t *output, int length)
+{
+	int i, j;
+
+	for (i = 0, j = 0; j < length; i += 3, j += 8)
+	{
+		unpack_group(input + i, output + j);
+	}
+}
+
+void convert_samples_int16_scalar(const uint16_t *src, int16_t *dest, int count)
+{
+	int i;
+	for (i = 0; i < count; i += 4)
+	{
+		dest[i + 0] = (src[i + 0] - 2048) << SAMPLE_SHIFT;
+		dest[i + 1] = (src[i + 1] - 2048) << SAMPLE_SHIFT;
+		dest[i + 2] = (src[i + 2] - 2048) << SAMPLE_SHIFT;
+		dest[i + 3] = (src[i + 3] - 2048) << SAMPLE_SHIFT;
+	}
+}
+
+void convert_samples_float_scalar(const uint16_t *src, float *dest, int count)
+{
+	int i;
+	for (i = 0; i < count; i += 4)
+	{
+		dest[i + 0] = (src[i + 0] - 2048) * SAMPLE_SCALE;
+		dest[i + 1] = (src[i + 1] - 2048) * SAMPLE_SCALE;
+		dest[i + 2] = (src[i + 2] - 2048) * SAMPLE_SCALE;
+		dest[i + 3] = (src[i + 3] - 2048) * SAMPLE_SCALE;
+	}
+}
+
+void unpack_samples_float_scalar(const uint32_t *input, float *dest, int length)
+{
+	int i, j;
+
+	for (i = 0, j = 0; j < length; i += 3, j += 8)
+	{
+		unpack_group_float(input + i, dest + j);
+	}
+}
+
+void unpack_samples_int16_scalar(const uint32_t *input, int16_t *dest, int length)
+{
+	int i, j;
+
+	for (i = 0, j = 0; j < length; i += 3, j += 8)
+	{
+		unpack_group_int16(input + i, dest + j);
+	}
+}
+
+/*
+ * For the fused kernels the shuffled and multiplied lanes hold the sample in
+ * bits 15..4 (plus garbage in bits 3..0 of even lanes), so the signed 16 bit
+ * value (s - 2048) << 4 is just (t & 0xfff0) ^ 0x8000. The float outputs are
+ * that value times 2^-15, which is exact.
+ */
+#define FUSED_FLOAT_SCALE (SAMPLE_SCALE / (1 << SAMPLE_SHIFT))
+
+#if defined(CPU_X86)
+
+TARGET_SSSE3
+static _inline __m128i unpack_group_pair_ssse3(const uint8_t *src)
+{
+	const __m128i shuffle = _mm_setr_epi8(2, 3, 1, 2, 7, 0, 6, 7, 4, 5, 11, 4, 9, 10, 8, 9);
+	const __m128i scale = _mm_setr_epi16(1, 16, 1, 16, 1, 16, 1, 16);
+
+	return _mm_mullo_epi16(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) src), shuffle), scale);
+}
+
+TARGET_SSSE3
+void unpack_samples_ssse3(const uint32_t *input, uint16_t *output, int length)
+{
+	int g;
+	int groups = length / GROUP_SAMPLES;
+	const uint8_t *src = (const uint8_t *) input;
+	__m128i v0, v1;
+
+	/* Each 16 byte load over-reads 4 bytes, so the last groups go through the scalar path */
+	for (g = 0; g + 3 <= groups; g += 2)
+	{
+		v0 = _mm_srli_epi16(unpack_group_pair_ssse3(src + g * GROUP_BYTES), 4);
+		v1 = _mm_srli_epi16(unpack_group_pair_ssse3(src + g * GROUP_BYTES + GROUP_BYTES), 4);
+
+		_mm_storeu_si128((__m128i *) (output + g * GROUP_SAMPLES), v0);
+		_mm_storeu_si128((__m128i *) (output + g * GROUP_SAMPLES + GROUP_SAMPLES), v1);
+	}
+
+	for (; g < groups; g++)
+	{
+		unpack_group(input + g * 3, output + g * GROUP_SAMPLES);
+	}
+}
+
+TARGET_SSE2
+static _inline __m128i signed_sample_sse2(__m128i v)
+{
+	return _mm_xor_si128(_mm_and_si128(v, _mm_set1_epi16((short) 0xfff0)), _mm_set1_epi16((short) 0x8000));
+}
+
+TARGET_SSE2
+static _inline void store_int16_as_float_sse2(float *dest, __m128i v, __m128 scale)
+{
+	/* Sign extend by placing each sample in the high half of a 32 bit lane */
+	__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+	__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+
+	_mm_storeu_ps(dest, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+	_mm_storeu_ps(dest + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+}
+
+TARGET_SSSE3
+void unpack_samples_float_ssse3(const uint32_t *input, float *dest, int length)
+{
+	int g;
+	int groups = length / GROUP_SAMPLES;
+	const uint8_t *src = (const uint8_t *) input;
+	const __m128 scale = _mm_set1_ps(FUSED_FLOAT_SCALE);
+	__m128i v0, v1;
+
+	for (g = 0; g + 3 <= groups; g += 2)
+	{
+		v0 = signed_sample_sse2(unpack_group_pair_ssse3(src + g * GROUP_BYTES));
+		v1 = signed_sample_sse2(unpack_group_pair_ssse3(src + g * GROUP_BYTES + GROUP_BYTES));
+
+		store_int16_as_float_sse2(dest + g * GROUP_SAMPLES, v0, scale);
+		store_int16_as_float_sse2(dest + g * GROUP_SAMPLES + GROUP_SAMPLES, v1, scale);
+	}
+
+	for (; g < groups; g++)
+	{
+		unpack_group_float(input + g * 3, dest + g * GROUP_SAMPLES);
+	}
+}
+
+TARGET_SSSE3
+void unpack_samples_int16_ssse3(const uint32_t *input, int16_t *dest, int length)
+{
+	int g;
+	int groups = length / GROUP_SAMPLES;
+	const uint8_t *src = (const uint8_t *) input;
+	__m128i v0, v1;
+
+	for (g = 0; g + 3 <= groups; g += 2)
+	{
+		v0 = signed_sample_sse2(unpack_group_pair_ssse3(src + g * GROUP_BYTES));
+		v1 = signed_sample_sse2(unpack_group_pair_ssse3(src + g * GROUP_BYTES + GROUP_BYTES));
+
+		_mm_storeu_si128((__m128i *) (dest + g * GROUP_SAMPLES), v0);
+		_mm_storeu_si128((__m128i *) (dest + g * GROUP_SAMPLES + GROUP_SAMPLES), v1);
+	}
+
+	for (; g < groups; g++)
+	{
+		unpack_group_int16(input + g * 3, dest + g * GROUP_SAMPLES);
+	}
+}
+
+TARGET_SSE2
+void convert_samples_float_sse2(const uint16_t *src, float *dest, int count)
+{
+	int i;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i offset = _mm_set1_epi32(2048);
+	const __m128 scale = _mm_set1_ps(SAMPLE_SCALE);
+	__m128i v, lo, hi;
+
+	for (i = 0; i + 8 <= count; i += 8)
+	{
+		v = _mm_loadu_si128((const __m128i *) (src + i));
+		lo = _mm_sub_epi32(_mm_unpacklo_epi16(v, zero), offset);
+		hi = _mm_sub_epi32(_mm_unpackhi_epi16(v, zero), offset);
+
+		_mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(dest + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+
+	convert_samples_float_scalar(src + i, dest + i, count - i);
+}
+
+TARGET_SSE2
+void convert_samples_int16_sse2(const uint16_t *src, int16_t *dest, int count)
+{
+	int i;
+	const __m128i offset = _mm_set1_epi16(2048);
+	__m128i v;
+
+	for (i = 0; i + 8 <= count; i += 8)
+	{
+		v = _mm_loadu_si128((const __m128i *) (src + i));
+		v = _mm_slli_epi16(_mm_sub_epi16(v, offset), SAMPLE_SHIFT);
+		_mm_storeu_si128((__m128i *) (dest + i), v);
+	}
+
+	convert_samples_int16_scalar(src + i, dest + i, count - i);
+}
+
+TARGET_AVX2
+static _inline __m256i unpack_group_quad_avx2(const uint8_t *src)
+{
+	const __m256i shuffle = _mm256_setr_epi8(
+		2, 3, 1, 2, 7, 0, 6, 7, 4, 5, 11, 4, 9, 10, 8, 9,
+		2, 3, 1, 2, 7, 0, 6, 7, 4, 5, 11, 4, 9, 10, 8, 9);
+	const __m256i scale = _mm256_setr_epi16(1, 16, 1, 16, 1, 16, 1, 16, 1, 16, 1, 16, 1, 16, 1, 16);
+	__m256i v;
+
+	/* vpshufb works within 128 bit lanes, so each lane gets one group */
+	v = _mm256_inserti128_si256(
+		_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) src)),
+		_mm_loadu_si128((const __m128i *) (src + GROUP_BYTES)),
+		1);
+
+	return _mm256_mullo_epi16(_mm256_shuffle_epi8(v, shuffle), scale);
+}
+
+TARGET_AVX2
+static _inline __m256i signed_sample_avx2(__m256i v)
+{
+	return _mm256_xor_si256(_mm256_and_si256(v, _mm256_set1_epi16((short) 0xfff0)), _mm256_set1_epi16((short) 0x8000));
+}
+
+TARGET_AVX2
+static _inline void store_int16_as_float_avx2(float *dest, __m256i v, __m256 scale)
+{
+	__m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v));
+	__m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1));
+
+	_mm256_storeu_ps(dest, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+	_mm256_storeu_ps(dest + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+}
+
+TARGET_AVX2
+void unpack_samples_avx2(const uint32_t *input, uint16_t *output, int length)
+{
+	int g;
+	int groups = length / GROUP_SAMPLES;
+	const uint8_t *src = (const uint8_t *) input;
+	__m256i v0, v1;
+
+	for (g = 0; g + 5 <= groups; g += 4)
+	{
+		v0 = _mm256_srli_epi16(unpack_group_quad_avx2(src + g * GROUP_BYTES), 4);
+		v1 = _mm256_srli_epi16(unpack_group_quad_avx2(src + (g + 2) * GROUP_BYTES), 4);
+
+		_mm256_storeu_si256((__m256i *) (output + g * GROUP_SAMPLES), v0);
+		_mm256_storeu_si256((__m256i *) (output + (g + 2) * GROUP_SAMPLES), v1);
+	}
+
+	for (; g < groups; g++)
+	{
+		unpack_group(input + g * 3, output + g * GROUP_SAMPLES);
+	}
+}
+
+TARGET_AVX2
+void unpack_samples_float_avx2(const uint32_t *input, float *dest, int length)
+{
+	int g;
+	int groups = length / GROUP_SAMPLES;
+	const uint8_t *src = (const uint8_t *) input;
+	const __m256 scale = _mm256_set1_ps(FUSED_FLOAT_SCALE);
+	__m256i v0, v1;
+
+	for (g = 0; g + 5 <= groups; g += 4)
+	{
+		v0 = signed_sample_avx2(unpack_group_quad_avx2(src + g * GROUP_BYTES));
+		v1 = signed_sample_avx2(unpack_group_quad_avx2(src + (g + 2) * GROUP_BYTES));
+
+		store_int16_as_float_avx2(dest + g * GROUP_SAMPLES, v0, scale);
+		store_int16_as_float_avx2(dest + (g + 2) * GROUP_SAMPLES, v1, scale);
+	}
+
+	for (; g < groups; g++)
+	{
+		unpack_group_float(input + g * 3, dest + g * GROUP_SAMPLES);
+	}
+}
+
+TARGET_AVX2
+void unpack_samples_int16_avx2(const uint32_t *input, int16_t *dest, int length)
+{
+	int g;
+	int groups = length / GROUP_SAMPLES;
+	const uint8_t *src = (const uint8_t *) input;
+	__m256i v0, v1;
+
+	for (g = 0; g + 5 <= groups; g += 4)
+	{
+		v0 = signed_sample_avx2(unpack_group_quad_avx2(src + g * GROUP_BYTES));
+		v1 = signed_sample_avx2(unpack_group_quad_avx2(src + (g + 2) * GROUP_BYTES));
+
+		_mm256_storeu_si256((__m256i *) (dest + g * GROUP_SAMPLES), v0);
+		_mm256_storeu_si256((__m256i *) (dest + (g + 2) * GROUP_SAMPLES), v1);
+	}
+
+	for (; g < groups; g++)
+	{
+		unpack_group_int16(input + g * 3, dest + g * GROUP_SAMPLES);
+	}
+}
+
+TARGET_AVX2
+void convert_samples_float_avx2(const uint16_t *src, float *dest, int count)
+{
+	int i;
+	const __m256i offset = _mm256_set1_epi32(2048);
+	const __m256 scale = _mm256_set1_ps(SAMPLE_SCALE);
+	__m256i lo, hi;
+
+	for (i = 0; i + 16 <= count; i += 16)
+	{
+		lo = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) (src + i)));
+		hi = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) (src + i + 8)));
+
+		_mm256_storeu_ps(dest + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(lo, offset)), scale));
+		_mm256_storeu_ps(dest + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(hi, offset)), scale));
+	}
+
+	convert_samples_float_scalar(src + i, dest + i, count - i);
+}
+
+TARGET_AVX2
+void convert_samples_int16_avx2(const uint16_t *src, int16_t *dest, int count)
+{
+	int i;
+	const __m256i offset = _mm256_set1_epi16(2048);
+	__m256i v;
+
+	for (i = 0; i + 16 <= count; i += 16)
+	{
+		v = _mm256_loadu_si256((const __m256i *) (src + i));
+		v = _mm256_slli_epi16(_mm256_sub_epi16(v, offset), SAMPLE_SHIFT);
+		_mm256_storeu_si256((__m256i *) (dest + i), v);
+	}
+
+	convert_samples_int16_scalar(src + i, dest + i, count - i);
+}
+
+#endif
+
+#if defined(CPU_NEON)
+
+static _inline uint8x16_t shuffle_bytes_neon(uint8x16_t v, uint8x16_t idx)
+{
+#if defined(__aarch64__) || defined(_M_ARM64)
+	return vqtbl1q_u8(v, idx);
+#else
+	uint8x8x2_t table;
+	table.val[0] = vget_low_u8(v);
+	table.val[1] = vget_high_u8(v);
+	return vcombine_u8(vtbl2_u8(table, vget_low_u8(idx)), vtbl2_u8(table, vget_high_u8(idx)));
+#endif
+}
+
+static _inline uint16x8_t unpack_group_pair_neon(const uint8_t *src)
+{
+	static const uint8_t shuffle_table[16] = { 2, 3, 1, 2, 7, 0, 6, 7, 4, 5, 11, 4, 9, 10, 8, 9 };
+	static const uint16_t scale_table[8] = { 1, 16, 1, 16, 1, 16, 1, 16 };
+
+	return vmulq_u16(vreinterpretq_u16_u8(shuffle_bytes_neon(vld1q_u8(src), vld1q_u8(shuffle_table))), vld1q_u16(scale_table));
+}
+
+static _inline int16x8_t signed_sample_neon(uint16x8_t v)
+{
+	return vreinterpretq_s16_u16(vsubq_u16(vandq_u16(v, vdupq_n_u16(0xfff0)), vdupq_n_u16(0x8000)));
+}
+
+static _inline void store_int16_as_float_neon(float *dest, int16x8_t v, float scale)
+{
+	vst1q_f32(dest, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+	vst1q_f32(dest + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+}
+
+void unpack_samples_neon(const uint32_t *input, uint16_t *output, int length)
+{
+	int g;
+	int groups = length / GROUP_SAMPLES;
+	const uint8_t *src = (const uint8_t *) input;
+
+	for (g = 0; g + 3 <= groups; g += 2)
+	{
+		vst1q_u16(output + g * GROUP_SAMPLES, vshrq_n_u16(unpack_group_pair_neon(src + g * GROUP_BYTES), 4));
+		vst1q_u16(output + g * GROUP_SAMPLES + GROUP_SAMPLES, vshrq_n_u16(unpack_group_pair_neon(src + g * GROUP_BYTES + GROUP_BYTES), 4));
+	}
+
+	for (; g < groups; g++)
+	{
+		unpack_group(input + g * 3, output + g * GROUP_SAMPLES);
+	}
+}
+
+void unpack_samples_float_neon(const uint32_t *input, float *dest, int length)
+{
+	int g;
+	int groups = length / GROUP_SAMPLES;
+	const uint8_t *src = (const uint8_t *) input;
+
+	for (g = 0; g + 3 <= groups; g += 2)
+	{
+		store_int16_as_float_neon(dest + g * GROUP_SAMPLES, signed_sample_neon(unpack_group_pair_neon(src + g * GROUP_BYTES)), FUSED_FLOAT_SCALE);
+		store_int16_as_float_neon(dest + g * GROUP_SAMPLES + GROUP_SAMPLES, signed_sample_neon(unpack_group_pair_neon(src + g * GROUP_BYTES + GROUP_BYTES)), FUSED_FLOAT_SCALE);
+	}
+
+	for (; g < groups; g++)
+	{
+		unpack_group_float(input + g * 3, dest + g * GROUP_SAMPLES);
+	}
+}
+
+void unpack_samples_int16_neon(const uint32_t *input, int16_t *dest, int length)
+{
+	int g;
+	int groups = length / GROUP_SAMPLES;
+	const uint8_t *src = (const uint8_t *) input;
+
+	for (g = 0; g + 3 <= groups; g += 2)
+	{
+		vst1q_s16(dest + g * GROUP_SAMPLES, signed_sample_neon(unpack_group_pair_neon(src + g * GROUP_BYTES)));
+		vst1q_s16(dest + g * GROUP_SAMPLES + GROUP_SAMPLES, signed_sample_neon(unpack_group_pair_neon(src + g * GROUP_BYTES + GROUP_BYTES)));
+	}
+
+	for (; g < groups; g++)
+	{
+		unpack_group_int16(input + g * 3, dest + g * GROUP_SAMPLES);
+	}
+}
+
+void convert_samples_float_neon(const uint16_t *src, float *dest, int count)
+{
+	int i;
+	const int32x4_t offset = vdupq_n_s32(-2048);
+	uint16x8_t v;
+
+	for (i = 0; i + 8 <= count; i += 8)
+	{
+		v = vld1q_u16(src + i);
+		vst1q_f32(dest + i, vmulq_n_f32(vcvtq_f32_s32(vaddq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(v))), offset)), SAMPLE_SCALE));
+		vst1q_f32(dest + i + 4, vmulq_n_f32(vcvtq_f32_s32(vaddq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(v))), offset)), SAMPLE_SCALE));
+	}
+
+	convert_samples_float_scalar(src + i, dest + i, count - i);
+}
+
+void convert_samples_int16_neon(const uint16_t *src, int16_t *dest, int count)
+{
+	int i;
+	const int16x8_t offset = vdupq_n_s16(2048);
+
+	for (i = 0; i + 8 <= count; i += 8)
+	{
+		vst1q_s16(dest + i, vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vld1q_u16(src + i)), offset), SAMPLE_SHIFT));
+	}
+
+	convert_samples_int16_scalar(src + i, dest + i, count - i);
+}
+
+#endif
+
+void unpacker_init(uint32_t cpu_features)
+{
+	unpack_samples = unpack_samples_scalar;
+	convert_samples_float = convert_samples_float_scalar;
+	convert_samples_int16 = convert_samples_int16_scalar;
+	unpack_samples_float = unpack_samples_float_scalar;
+	unpack_samples_int16 = unpack_samples_int16_scalar;
+
+#if defined(CPU_X86)
+	if (cpu_features & CPU_FEATURE_AVX2)
+	{
+		unpack_samples = unpack_samples_avx2;
+		convert_samples_float = convert_samples_float_avx2;
+		convert_samples_int16 = convert_samples_int16_avx2;
+		unpack_samples_float = unpack_samples_float_avx2;
+		unpack_samples_int16 = unpack_samples_int16_avx2;
+	}
+	else
+	{
+		if (cpu_features & CPU_FEATURE_SSE2)
+		{
+			convert_samples_float = convert_samples_float_sse2;
+			convert_samples_int16 = convert_samples_int16_sse2;
+		}
+		if (cpu_features & CPU_FEATURE_SSSE3)
+		{
+			unpack_samples = unpack_samples_ssse3;
+			unpack_samples_float = unpack_samples_float_ssse3;
+			unpack_samples_int16 = unpack_samples_int16_ssse3;
+		}
+	}
+#endif
+
+#if defined(CPU_NEON)
+	if (cpu_features & CPU_FEATURE_NEON)
+	{
+		unpack_samples = unpack_samples_neon;
+		convert_samples_float = convert_samples_float_neon;
+		convert_samples_int16 = convert_samples_int16_neon;
+		unpack_samples_float = unpack_samples_float_neon;
+		unpack_samples_int16 = unpack_samples_int16_neon;
+	}
+#endif
+}
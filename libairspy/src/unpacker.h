@@ -0,0 +1,84 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef UNPACKER_H
+#define UNPACKER_H
+
+#include <stdint.h>
+#include "cpu_features.h"
+
+#define SAMPLE_RESOLUTION 12
+#define SAMPLE_ENCAPSULATION 16
+
+#define SAMPLE_SHIFT (SAMPLE_ENCAPSULATION - SAMPLE_RESOLUTION)
+#define SAMPLE_SCALE (1.0f / (1 << (15 - SAMPLE_SHIFT)))
+
+/*
+ * Packed mode carries 8 samples of 12 bits in every 3 little endian words.
+ * length is the number of output samples and must be a multiple of 8.
+ */
+typedef void (*unpack_samples_fn)(const uint32_t *input, uint16_t *output, int length);
+
+/*
+ * The fused kernels go straight from the USB words to signed samples, removing
+ * the 2048 offset and scaling in the same pass. convert_* take one sample per
+ * 16 bit word (count multiple of 4), unpack_* take packed words (multiple of 8).
+ */
+typedef void (*convert_samples_float_fn)(const uint16_t *src, float *dest, int count);
+typedef void (*convert_samples_int16_fn)(const uint16_t *src, int16_t *dest, int count);
+typedef void (*unpack_samples_float_fn)(const uint32_t *input, float *dest, int length);
+typedef void (*unpack_samples_int16_fn)(const uint32_t *input, int16_t *dest, int length);
+
+void unpack_samples_scalar(const uint32_t *input, uint16_t *output, int length);
+void convert_samples_float_scalar(const uint16_t *src, float *dest, int count);
+void convert_samples_int16_scalar(const uint16_t *src, int16_t *dest, int count);
+void unpack_samples_float_scalar(const uint32_t *input, float *dest, int length);
+void unpack_samples_int16_scalar(const uint32_t *input, int16_t *dest, int length);
+#if defined(CPU_X86)
+void unpack_samples_ssse3(const uint32_t *input, uint16_t *output, int length);
+void convert_samples_float_sse2(const uint16_t *src, float *dest, int count);
+void convert_samples_int16_sse2(const uint16_t *src, int16_t *dest, int count);
+void unpack_samples_float_ssse3(const uint32_t *input, float *dest, int length);
+void unpack_samples_int16_ssse3(const uint32_t *input, int16_t *dest, int length);
+void unpack_samples_avx2(const uint32_t *input, uint16_t *output, int length);
+void convert_samples_float_avx2(const uint16_t *src, float *dest, int count);
+void convert_samples_int16_avx2(const uint16_t *src, int16_t *dest, int count);
+void unpack_samples_float_avx2(const uint32_t *input, float *dest, int length);
+void unpack_samples_int16_avx2(const uint32_t *input, int16_t *dest, int length);
+#endif
+#if defined(CPU_NEON)
+void unpack_samples_neon(const uint32_t *input, uint16_t *output, int length);
+void convert_samples_float_neon(const uint16_t *src, float *dest, int count);
+void convert_samples_int16_neon(const uint16_t *src, int16_t *dest, int count);
+void unpack_samples_float_neon(const uint32_t *input, float *dest, int length);
+void unpack_samples_int16_neon(const uint32_t *input, int16_t *dest, int length);
+#endif
+
+/* Binds the kernels below to the fastest variants for the given CPU_FEATURE_* mask */
+void unpacker_init(uint32_t cpu_features);
+
+extern unpack_samples_fn unpack_samples;
+extern convert_samples_float_fn convert_samples_float;
+extern convert_samples_int16_fn convert_samples_int16;
+extern unpack_samples_float_fn unpack_samples_float;
+extern unpack_samples_int16_fn unpack_samples_int16;
+
+#endif // UNPACKER_H
@@ -0,0 +1,220 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+
+#include "work_pool.h"
+#include "atomics.h"
+
+static void* worker_threadproc(void *arg)
+{
+	work_item_t *item;
+	work_pool_t *pool = (work_pool_t *) arg;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	while (!pool->stopping)
+	{
+		item = pool->head;
+		if (item == NULL)
+		{
+			pthread_cond_wait(&pool->work_cond, &pool->mutex);
+			continue;
+		}
+
+		pool->head = item->next;
+		if (pool->head == NULL)
+		{
+			pool->tail = NULL;
+		}
+		item->next = NULL;
+		item->running = 1;
+
+		pthread_mutex_unlock(&pool->mutex);
+		item->run(item->arg);
+		pthread_mutex_lock(&pool->mutex);
+
+		item->running = 0;
+		if (item->cancelled)
+		{
+			pthread_cond_broadcast(&pool->idle_cond);
+			continue;
+		}
+
+		/*
+		 * Pairs with the producer queueing work before it tries to set the
+		 * flag: either it sees the flag cleared or we see its work here. The
+		 * exchange is a full barrier, which a plain store would not be.
+		 */
+		atomic_compare_exchange(&item->scheduled, 1, 0);
+		if (item->pending(item->arg) && atomic_compare_exchange(&item->scheduled, 0, 1))
+		{
+			item->next = NULL;
+			if (pool->tail != NULL)
+			{
+				pool->tail->next = item;
+			}
+			else
+			{
+				pool->head = item;
+			}
+			pool->tail = item;
+		}
+	}
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	return NULL;
+}
+
+int work_pool_init(work_pool_t *pool, uint32_t thread_count)
+{
+	uint32_t i;
+
+	pool->threads = (pthread_t *) calloc(thread_count, sizeof(pthread_t));
+	if (pool->threads == NULL)
+	{
+		return -1;
+	}
+
+	pool->thread_count = 0;
+	pool->stopping = 0;
+	pool->head = NULL;
+	pool->tail = NULL;
+
+	if (pthread_mutex_init(&pool->mutex, NULL) != 0)
+	{
+		free(pool->threads);
+		return -1;
+	}
+	pthread_cond_init(&pool->work_cond, NULL);
+	pthread_cond_init(&pool->idle_cond, NULL);
+
+	for (i = 0; i < thread_count; i++)
+	{
+		if (pthread_create(&pool->threads[i], NULL, worker_threadproc, pool) != 0)
+		{
+			work_pool_destroy(pool);
+			return -1;
+		}
+		pool->thread_count++;
+	}
+
+	return 0;
+}
+
+void work_pool_destroy(work_pool_t *pool)
+{
+	uint32_t i;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->stopping = 1;
+	pthread_cond_broadcast(&pool->work_cond);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (i = 0; i < pool->thread_count; i++)
+	{
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&pool->idle_cond);
+	pthread_cond_destroy(&pool->work_cond);
+	pthread_mutex_destroy(&pool->mutex);
+	free(pool->threads);
+	pool->threads = NULL;
+	pool->thread_count = 0;
+}
+
+void work_item_init(work_item_t *item, void (*run)(void *arg), int (*pending)(void *arg), void *arg)
+{
+	item->next = NULL;
+	item->scheduled = 0;
+	item->running = 0;
+	item->cancelled = 0;
+	item->run = run;
+	item->pending = pending;
+	item->arg = arg;
+}
+
+void work_pool_schedule(work_pool_t *pool, work_item_t *item)
+{
+	if (!atomic_compare_exchange(&item->scheduled, 0, 1))
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	if (!item->cancelled)
+	{
+		item->next = NULL;
+		if (pool->tail != NULL)
+		{
+			pool->tail->next = item;
+		}
+		else
+		{
+			pool->head = item;
+		}
+		pool->tail = item;
+		pthread_cond_signal(&pool->work_cond);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+void work_pool_cancel(work_pool_t *pool, work_item_t *item)
+{
+	work_item_t **link;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	item->cancelled = 1;
+	atomic_store_seq_cst(&item->scheduled, 1);
+
+	pool->tail = NULL;
+	for (link = &pool->head; *link != NULL; )
+	{
+		if (*link == item)
+		{
+			*link = item->next;
+			item->next = NULL;
+		}
+		else
+		{
+			pool->tail = *link;
+			link = &(*link)->next;
+		}
+	}
+
+	while (item->running)
+	{
+		pthread_cond_wait(&pool->idle_cond, &pool->mutex);
+	}
+
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+void work_pool_resume(work_pool_t *pool, work_item_t *item)
+{
+	pthread_mutex_lock(&pool->mutex);
+	item->cancelled = 0;
+	atomic_store_seq_cst(&item->scheduled, 0);
+	pthread_mutex_unlock(&pool->mutex);
+}
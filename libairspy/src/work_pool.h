@@ -0,0 +1,77 @@
+/*
+Copyright (c) 2026, AirSpy project
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of AirSpy nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stdint.h>
+
+#if _MSC_VER > 1700
+#define HAVE_STRUCT_TIMESPEC
+#endif
+
+#include <pthread.h>
+
+/*
+ * A work item is a source of jobs that must run one at a time and in order,
+ * such as a device whose converter keeps state from one buffer to the next.
+ * Producers schedule the item after queueing work; the scheduled flag keeps
+ * it at most once in the run queue and on at most one worker, so any number
+ * of items share a fixed number of threads without locking each other out.
+ */
+typedef struct work_item
+{
+	struct work_item *next;
+	volatile uint32_t scheduled;
+	uint32_t running;
+	uint32_t cancelled;
+	/* Runs a bounded batch of work on a worker thread */
+	void (*run)(void *arg);
+	/* Whether more work is queued, checked after each batch */
+	int (*pending)(void *arg);
+	void *arg;
+} work_item_t;
+
+typedef struct work_pool
+{
+	pthread_t *threads;
+	uint32_t thread_count;
+	volatile uint32_t stopping;
+	work_item_t *head;
+	work_item_t *tail;
+	pthread_mutex_t mutex;
+	pthread_cond_t work_cond;
+	pthread_cond_t idle_cond;
+} work_pool_t;
+
+int work_pool_init(work_pool_t *pool, uint32_t thread_count);
+void work_pool_destroy(work_pool_t *pool);
+
+void work_item_init(work_item_t *item, void (*run)(void *arg), int (*pending)(void *arg), void *arg);
+
+/* Lock free when the item is already queued or running */
+void work_pool_schedule(work_pool_t *pool, work_item_t *item);
+
+/* Unqueues the item, waits for a running batch to finish, and ignores it until work_pool_resume() */
+void work_pool_cancel(work_pool_t *pool, work_item_t *item);
+void work_pool_resume(work_pool_t *pool, work_item_t *item);
+
+#endif // WORK_POOL_H